@@ -0,0 +1,188 @@
+#include "mbed.h"
+#include "LinkSupervisor.h"
+
+LinkSupervisor::LinkSupervisor(MDMParser* mdm)
+{
+    _mdm = mdm;
+    _apn = _username = _password = _simpin = NULL;
+    _state = LINK_DOWN;
+    _pdpLost = false;
+    _checkNow = false;
+    _closed = 0;
+    _attempts = 0;
+    _wait_ms = 0;
+    _reset = false;
+    _sessionAttempts = 0;
+    _sessionWait_ms = 0;
+    memset(_subs, 0, sizeof(_subs));
+}
+
+LinkSupervisor::~LinkSupervisor(void)
+{
+    _mdm->setLinkCallback(NULL);
+}
+
+void LinkSupervisor::begin(const char* apn /*= NULL*/, const char* username /*= NULL*/,
+                           const char* password /*= NULL*/, const char* simpin /*= NULL*/)
+{
+    _apn = apn;
+    _username = username;
+    _password = password;
+    _simpin = simpin;
+    // the back-off must differ between the devices, else a fleet 
+    // reconnects in lockstep after a shared outage
+    srand(_mdm->entropy());
+    _state = (_mdm->getIpAddress() != NOIP) ? LINK_CONNECTED : LINK_DOWN;
+    _mdm->setLinkCallback(_onLink, this);
+    _timer.start();
+    _resetTimer.start();
+    _sessionTimer.start();
+    // verify the state with the first poll
+    _checkNow = true;
+}
+
+bool LinkSupervisor::subscribe(_LINKCB cb, void* param /*= NULL*/)
+{
+    for (int i = 0; i < MAX_SUBS; i ++) {
+        if (!_subs[i].cb) {
+            _subs[i].cb = cb;
+            _subs[i].param = param;
+            return true;
+        }
+    }
+    return false;
+}
+
+void LinkSupervisor::poll(void)
+{
+    _mdm->processUrc();
+    _sessionExpire();
+    // sockets closed by the peer are passed on as they come
+    unsigned int closed = _closed;
+    _closed &= ~closed;
+    for (int socket = 0; closed; socket ++, closed >>= 1) {
+        if (closed & 1)
+            _notify(LINK_SOCKET_CLOSED, socket);
+    }
+    if (_pdpLost) {
+        _pdpLost = false;
+        if (_state == LINK_CONNECTED)
+            _setState(LINK_REGISTERED);
+        _checkNow = true;
+    }
+    // repair when the back-off expired, else check periodically
+    if (_state != LINK_CONNECTED) {
+        if (_timer.read_ms() < _wait_ms)
+            return;
+    } else if (!_checkNow && (_timer.read_ms() < CHECK_MS))
+        return;
+    _checkNow = false;
+    _step();
+    _timer.reset();
+}
+
+bool LinkSupervisor::pollStep(LinkSupervisor* sup, MDMParser* mdm)
+{
+    sup->poll();
+    return false;
+}
+
+bool LinkSupervisor::sessionReady(void)
+{
+    _sessionExpire();
+    return (_state == LINK_CONNECTED) && !_sessionWait_ms;
+}
+
+void LinkSupervisor::sessionFailed(void)
+{
+    if (_sessionAttempts < MAX_ATTEMPTS)
+        _sessionAttempts ++;
+    _sessionWait_ms = _backoff(_sessionAttempts);
+    _sessionTimer.reset();
+    // the session may have failed because of the link
+    _checkNow = true;
+}
+
+void LinkSupervisor::_sessionExpire(void)
+{
+    // forget the wait once it expired, the timer wraps after 35 minutes
+    if (_sessionWait_ms && (_sessionTimer.read_ms() >= _sessionWait_ms))
+        _sessionWait_ms = 0;
+}
+
+// ----------------------------------------------------------------
+
+void LinkSupervisor::_onLink(void* param, MDMParser::LinkEvent event, int arg)
+{
+    LinkSupervisor* sup = (LinkSupervisor*)param;
+    if (event == MDMParser::LINK_PDP_LOST)
+        sup->_pdpLost = true;
+    else if (event == MDMParser::LINK_REG_CHANGED)
+        sup->_checkNow = true;
+    else if ((event == MDMParser::LINK_SOCKET_CLOSED) && (arg >= 0) && (arg < 32))
+        sup->_closed |= 1u << arg;
+}
+
+void LinkSupervisor::_step(void)
+{
+    // forget the last restart before the timer wraps
+    if (_reset && (_resetTimer.read_ms() >= RESET_MIN_MS))
+        _reset = false;
+    // the small steps did not help, restart the modem, but rarely
+    if ((_attempts >= MAX_ATTEMPTS) && !_reset) {
+        _setState(LINK_DOWN);
+        _reset = true;
+        _resetTimer.reset();
+        _mdm->powerOff();
+        bool ok = _mdm->init(_simpin);
+        _attempts = ok ? 0 : _attempts + 1;
+        _wait_ms = ok ? 0 : _backoff(_attempts);
+        return;
+    }
+    // the module registers by itself, just follow it
+    if (!_mdm->checkNetStatus()) {
+        _setState(LINK_DOWN);
+        _wait_ms = _backoff(++ _attempts);
+        return;
+    }
+    if (_state == LINK_DOWN)
+        _setState(LINK_REGISTERED);
+    if (_mdm->getIpAddress() == NOIP) {
+        if (_state == LINK_CONNECTED)
+            _setState(LINK_REGISTERED);
+        if (_mdm->join(_apn, _username, _password) == NOIP) {
+            _wait_ms = _backoff(++ _attempts);
+            return;
+        }
+    }
+    _attempts = 0;
+    _wait_ms = 0;
+    _setState(LINK_CONNECTED);
+}
+
+void LinkSupervisor::_setState(State state)
+{
+    if (_state != state) {
+        _state = state;
+        _notify(state, -1);
+    }
+}
+
+void LinkSupervisor::_notify(State state, int socket)
+{
+    for (int i = 0; i < MAX_SUBS; i ++) {
+        if (_subs[i].cb)
+            _subs[i].cb(_subs[i].param, state, socket);
+    }
+}
+
+int LinkSupervisor::_backoff(int attempts)
+{
+    int ms = BACKOFF_MIN_MS;
+    for (int i = 1; (i < attempts) && (ms < BACKOFF_MAX_MS); i ++)
+        ms *= 2;
+    if (ms > BACKOFF_MAX_MS)
+        ms = BACKOFF_MAX_MS;
+    // half fixed, half random, spreads the reconnects of a fleet
+    return ms / 2 + rand() % (ms / 2 + 1);
+}
@@ -0,0 +1,156 @@
+#pragma once
+
+#include "mbed.h"
+#include "MDM.h"
+
+/** Supervisor of the data link, to be polled from the main loop.
+
+    The supervisor follows the link events of the modem (lost context,
+    registration changes, sockets closed by the peer) and checks the link
+    periodically. A broken link is repaired from the lowest layer that is
+    down with the smallest step: wait for the registration, then activate
+    the context again. Failed steps are retried with a jittered exponential
+    back-off so that a fleet does not reconnect all at once, only when the
+    small steps keep failing the modem is restarted, at most once per
+    #RESET_MIN_MS. Subscribers are notified about every state change, the
+    application sessions use #sessionReady and #sessionFailed to get the
+    same back-off for their reconnects.
+    When the modem is shared with a #MDMArbiter, post #pollStep as a job
+    instead of calling #poll from the main loop, the checks and repairs
+    then run between the steps of the other jobs. A repair step (waiting
+    for the registration, activating the context, restarting the modem)
+    is still one long transaction, post the job with PRIO_LOW so that it
+    only runs when no job waited longer.
+*/
+class LinkSupervisor
+{
+public:
+    enum {
+        MAX_SUBS       = 4,       //!< number of subscribers
+        CHECK_MS       = 60000,   //!< interval of the link check while connected
+        BACKOFF_MIN_MS = 2000,    //!< delay after the first failure
+        BACKOFF_MAX_MS = 300000,  //!< upper limit of the delay
+        MAX_ATTEMPTS   = 6,       //!< failed steps before the modem is restarted
+        RESET_MIN_MS   = 900000   //!< minimum time between two restarts
+    };
+
+    //! the state of the link, also the events passed to the subscribers
+    typedef enum {
+        LINK_DOWN,          //!< not registered to the network
+        LINK_REGISTERED,    //!< registered, no data connection
+        LINK_CONNECTED,     //!< the data connection is up, sessions can be opened
+        LINK_SOCKET_CLOSED  //!< event only, a socket was closed by the peer
+    } State;
+
+    /** callback for the subscribers
+        \param param the argument passed to #subscribe
+        \param state the new state or LINK_SOCKET_CLOSED
+        \param socket the closed socket, -1 for state changes
+    */
+    typedef void (*_LINKCB)(void* param, State state, int socket);
+
+    /** Constructor
+        \param mdm the modem to supervise
+    */
+    LinkSupervisor(MDMParser* mdm);
+
+    //! Destructor
+    ~LinkSupervisor(void);
+
+    /** Start the supervision, the modem should be initialised. The
+        random number generator is seeded from #MDMParser::entropy. The
+        strings must remain valid while supervised.
+        \param apn the apn passed to join
+        \param username the user name passed to join
+        \param password the password passed to join
+        \param simpin the pin used when the modem is restarted
+    */
+    void begin(const char* apn = NULL, const char* username = NULL,
+               const char* password = NULL, const char* simpin = NULL);
+
+    /** Add a subscriber, it is called from #poll
+        \param cb the callback
+        \param param the argument passed to the callback
+        \return true if successful, false if there is no free slot
+    */
+    bool subscribe(_LINKCB cb, void* param = NULL);
+
+    /** template version of #subscribe, this allows the compiler to do
+        type cheking of the callback argument.
+        \sa subscribe
+    */
+    template<class T>
+    inline bool subscribe(void (*cb)(T* param, State state, int socket), T* param)
+    {
+        return subscribe((_LINKCB)cb, (void*)param);
+    }
+
+    /** Do the pending work: handle the link events, check and repair
+        the link when due. Call this frequently from the main loop.
+    */
+    void poll(void);
+
+    /** Step function for #MDMArbiter::post, it calls #poll and stays queued
+        \param sup the supervisor
+        \param mdm the supervised modem
+        \return false, the job is never done
+    */
+    static bool pollStep(LinkSupervisor* sup, MDMParser* mdm);
+
+    /** Request a link check with the next #poll, e.g. when a session
+        timed out without a link event
+    */
+    void check(void) { _checkNow = true; }
+
+    /** Get the state of the link
+        \return the state
+    */
+    State getState(void) { return _state; }
+
+    /** Check if an application session may be (re)opened now
+        \return true if connected and the session back-off has expired
+    */
+    bool sessionReady(void);
+
+    /** Report that opening or using a session failed, the next attempt
+        is delayed with the back-off and the link is checked
+    */
+    void sessionFailed(void);
+
+    /** Report that a session was opened, this resets its back-off
+    */
+    void sessionOk(void) { _sessionAttempts = 0; _sessionWait_ms = 0; }
+
+protected:
+    //! the link event callback of the modem
+    static void _onLink(void* param, MDMParser::LinkEvent event, int arg);
+    //! check the layers and repair the lowest one that is down
+    void _step(void);
+    //! change the state and notify the subscribers
+    void _setState(State state);
+    //! notify the subscribers
+    void _notify(State state, int socket);
+    //! clear the session back-off once it expired
+    void _sessionExpire(void);
+    //! get the jittered back-off delay after a number of failures
+    static int _backoff(int attempts);
+
+    MDMParser* _mdm;                //!< the supervised modem
+    const char* _apn;               //!< the apn
+    const char* _username;          //!< the user name
+    const char* _password;          //!< the password
+    const char* _simpin;            //!< the sim pin
+    State _state;                   //!< the state of the link
+    volatile bool _pdpLost;         //!< the context was deactivated
+    volatile bool _checkNow;        //!< check the link with the next poll
+    volatile unsigned int _closed;  //!< sockets closed by the peer, one bit each
+    int _attempts;                  //!< failed repair steps in a row
+    int _wait_ms;                   //!< delay before the next repair step
+    Timer _timer;                   //!< time since the last check or step
+    bool _reset;                    //!< the modem was restarted before
+    Timer _resetTimer;              //!< time since the last restart
+    int _sessionAttempts;           //!< failed session attempts in a row
+    int _sessionWait_ms;            //!< delay before the next session attempt, 0 if none
+    Timer _sessionTimer;            //!< time since the last session failure
+    struct { _LINKCB cb; void* param; } _subs[MAX_SUBS]; //!< the subscribers
+};
@@ -6,6 +6,19 @@
 #include "MDMAPN.h"
                 
 #define PROFILE         "0"   //!< this is the psd profile used
+#define APN_LKG_FILE    "apn.lkg" //!< file to remember the last working apn settings
+#define HTTP_REQ_FILE   "http.req" //!< file used to post buffers
+#define FILE_MAX_WRITE  1024  //!< maximum number of bytes written with one AT+UDWNFILE
+//! idle time after which the module is assumed to sleep (UPSV timeout is 2000 frames ~9.2s)
+#define PSV_IDLE_US     6000000
+//! time the module needs to wake up after the preamble or dtr 
+#define PSV_WAKE_US       20000
+//! preamble used to wake up the module, it is lost but an empty line is ignored anyway
+#define PSV_PREAMBLE       '\r'
+//! typical current of the module while awake and idle in uA
+#define PSV_AWAKE_UA      15000
+//! typical current of the module in power saving (paging) in uA
+#define PSV_SLEEP_UA       1000
 #define MAX_SIZE        128   //!< max expected messages
 //! test if it is a socket
 #define ISSOCKET(s)     (((s) >= 0) && ((s) < (sizeof(_sockets)/sizeof(*_sockets))))
@@ -15,51 +28,37 @@
 #define REG_OK(r)       ((r == REG_HOME) || (r == REG_ROAMING)) 
 //! registration done check helper (no need to poll further)
 #define REG_DONE(r)     ((r == REG_HOME) || (r == REG_ROAMING) || (r == REG_DENIED)) 
+//! interval to query the registration while waiting for the URCs
+#define REG_RECHECK_MS  30000
+//! longest wait for the URCs with the lock held, other users get the modem in between
+#define REG_SLICE_MS     1000
+//! interval of the AT probes while the module boots
+#define BOOT_PROBE_MS   100
+//! probing time after a power on pulse before the next one
+#define BOOT_WAIT_MS    1500
+//! give up when the module did not answer by then
+#define BOOT_MAX_MS     13000
 //! helper to make sure that lock unlock pair is always balaced 
 #define LOCK()         { lock() 
 //! helper to make sure that lock unlock pair is always balaced 
 #define UNLOCK()       } unlock()
 
+#if 1 // colored terminal output using ANSI escape sequences
+ #define COL(c) "\033[" c
+#else
+ #define COL(c) 
+#endif
+#define DEF COL("39m")
+#define BLA COL("30m")
+#define RED COL("31m")
+#define GRE COL("32m")
+#define YEL COL("33m")
+#define BLU COL("34m")
+#define MAG COL("35m")
+#define CYA COL("36m")
+#define WHY COL("37m")
+
 #ifdef MDM_DEBUG
- #if 1 // colored terminal output using ANSI escape sequences
-  #define COL(c) "\033[" c
- #else
-  #define COL(c) 
- #endif
- #define DEF COL("39m")
- #define BLA COL("30m")
- #define RED COL("31m")
- #define GRE COL("32m")
- #define YEL COL("33m")
- #define BLU COL("34m")
- #define MAG COL("35m")
- #define CYA COL("36m")
- #define WHY COL("37m")
- 
-void dumpAtCmd(const char* buf, int len)
-{
-    ::printf(" %3d \"", len);
-    while (len --) {
-        char ch = *buf++;
-        if ((ch > 0x1F) && (ch != 0x7F)) { // is printable
-            if      (ch == '%')  ::printf("%%");
-            else if (ch == '"')  ::printf("\\\"");
-            else if (ch == '\\') ::printf("\\\\");
-            else putchar(ch);
-        } else {
-            if      (ch == '\a') ::printf("\\a"); // BEL (0x07)
-            else if (ch == '\b') ::printf("\\b"); // Backspace (0x08)
-            else if (ch == '\t') ::printf("\\t"); // Horizontal Tab (0x09)
-            else if (ch == '\n') ::printf("\\n"); // Linefeed (0x0A)
-            else if (ch == '\v') ::printf("\\v"); // Vertical Tab (0x0B)
-            else if (ch == '\f') ::printf("\\f"); // Formfeed (0x0C)
-            else if (ch == '\r') ::printf("\\r"); // Carriage Return (0x0D)
-            else                 ::printf("\\x%02x", (unsigned char)ch);
-        }
-    }
-    ::printf("\"\r\n");
-}
- 
  #define ERROR(...)     (_debugLevel < 0) ? : ::printf(RED), ::printf(__VA_ARGS__), ::printf(DEF) 
  #define TEST(...)                            ::printf(CYA), ::printf(__VA_ARGS__), ::printf(DEF)  
  #define INFO(...)      (_debugLevel < 1) ? : ::printf(GRE), ::printf(__VA_ARGS__), ::printf(DEF) 
@@ -85,6 +84,25 @@ MDMParser::MDMParser(void)
     _net.ci = 0xFFFFFFFF;
     _ip        = NOIP;
     _init      = false;
+    _linkBaud  = 115200;
+    _lastDev   = DEV_UNKNOWN;
+    memset(&_boot, 0, sizeof(_boot));
+    _psv       = PSV_OFF;
+    _smsRef    = 0;
+    for (int i = 0; i < NUM_HTTP; i ++)
+        _http[i] = HTTP_IDLE;
+    _script    = NULL;
+    _scriptCap = 0;
+    _scriptLost = 0;
+    memset(&_loc, 0, sizeof(_loc));
+    _locDone   = false;
+    memset(&_cells, 0, sizeof(_cells));
+    _cellsValid = false;
+    memset(&_metrics, 0, sizeof(_metrics));
+    _cmdClass  = -1;
+    _cmdStart  = 0;
+    _linkCb    = NULL;
+    _linkParam = NULL;
     memset(_sockets, 0, sizeof(_sockets));
 #ifdef MDM_DEBUG
     _debugLevel = 1;
@@ -94,12 +112,8 @@ MDMParser::MDMParser(void)
 
 int MDMParser::send(const char* buf, int len)
 {
-#ifdef MDM_DEBUG
-    if (_debugLevel >= 3) {
-        ::printf("%10.3f AT send    ", _debugTime.read_ms()*0.001);
-        dumpAtCmd(buf,len);
-    }
-#endif
+    if (_script)
+        _transcript('>', 0, buf, len);
     return _send(buf, len);
 }
 
@@ -109,9 +123,51 @@ int MDMParser::sendFormated(const char* format, ...) {
     va_start(args, format);
     int len = vsnprintf(buf,sizeof(buf), format, args);
     va_end(args);
+    _metricsStart(buf);
     return send(buf, len);
 }
 
+int MDMParser::sendCmd(const AtCmd& cmd)
+{
+    _metricsStart(cmd.buf());
+    return send(cmd.buf(), cmd.len());
+}
+
+MDMParser::AtCmd& MDMParser::AtCmd::raw(const char* buf, int len)
+{
+    if (len > SIZE - _len)
+        len = SIZE - _len;
+    memcpy(&_buf[_len], buf, len);
+    _len += len;
+    _buf[_len] = '\0';
+    return *this;
+}
+
+MDMParser::AtCmd& MDMParser::AtCmd::num(int val)
+{
+    char tmp[11]; // 10 digits and a sign
+    int ix = sizeof(tmp);
+    unsigned int u = (val < 0) ? -(unsigned int)val : (unsigned int)val;
+    do {
+        tmp[--ix] = '0' + (u % 10);
+        u /= 10;
+    } while (u);
+    if (val < 0) 
+        tmp[--ix] = '-';
+    return raw(&tmp[ix], sizeof(tmp) - ix);
+}
+
+MDMParser::AtCmd& MDMParser::AtCmd::ip(IP ip)
+{
+    num((ip>>24)&0xff).str(".").num((ip>>16)&0xff).str(".");
+    return num((ip>>8)&0xff).str(".").num(ip&0xff);
+}
+
+MDMParser::AtCmd& MDMParser::AtCmd::quoted(const char* str)
+{
+    return raw("\"", 1).raw(str, strlen(str)).raw("\"", 1);
+}
+
 int MDMParser::waitFinalResp(_CALLBACKPTR cb /* = NULL*/, 
                              void* param /* = NULL*/, 
                              int timeout_ms /*= 5000*/)
@@ -121,22 +177,8 @@ int MDMParser::waitFinalResp(_CALLBACKPTR cb /* = NULL*/,
     timer.start();
     do {
         int ret = getLine(buf, sizeof(buf));
-#ifdef MDM_DEBUG
-        if ((_debugLevel >= 3) && (ret != WAIT) && (ret != NOT_FOUND))
-        {
-            int len = LENGTH(ret);
-            int type = TYPE(ret);
-            const char* s = (type == TYPE_UNKNOWN)? YEL "UNK" DEF : 
-                            (type == TYPE_TEXT)   ? MAG "TXT" DEF : 
-                            (type == TYPE_OK   )  ? GRE "OK " DEF : 
-                            (type == TYPE_ERROR)  ? RED "ERR" DEF : 
-                            (type == TYPE_PLUS)   ? CYA " + " DEF : 
-                            (type == TYPE_PROMPT) ? BLU " > " DEF : 
-                                                        "..." ;
-            ::printf("%10.3f AT read %s", _debugTime.read_ms()*0.001, s);
-            dumpAtCmd(buf, len);
-        }
-#endif        
+        if (_script && (ret != WAIT) && (ret != NOT_FOUND))
+            _transcript('<', TYPE(ret) >> 16, buf, LENGTH(ret));
         if ((ret != WAIT) && (ret != NOT_FOUND))
         {
             int type = TYPE(ret);
@@ -145,6 +187,8 @@ int MDMParser::waitFinalResp(_CALLBACKPTR cb /* = NULL*/,
                 const char* cmd = buf+3;
                 int a, b, c, d, r;
                 char s[32];
+                if ((_cmdClass < 0) || ((cmd[0] == 'U') && (cmd[1] == 'U')))
+                    _metrics.urcs ++;
 
                 // SMS Command ---------------------------------
                 // +CNMI: <mem>,<index>
@@ -166,6 +210,32 @@ int MDMParser::waitFinalResp(_CALLBACKPTR cb /* = NULL*/,
                     ISSOCKET(a) && (_sockets[a].state == SOCK_CONNECTED)) {
                     TRACE("Socket %d: closed by remote host\r\n", a);
                     _sockets[a].state = SOCK_CREATED/*=CLOSED*/;
+                    if (_linkCb) _linkCb(_linkParam, LINK_SOCKET_CLOSED, a);
+                // +UUHTTPCR: <profile>,<http_command>,<http_result>
+                } else if ((sscanf(cmd, "UUHTTPCR: %d,%d,%d", &a, &b, &c) == 3) && 
+                    (a >= 0) && (a < NUM_HTTP)) {
+                    TRACE("HTTP %d: command %d %s\r\n", a, b, c ? "done" : "failed");
+                    _http[a] = c ? HTTP_DONE : HTTP_FAILED;
+                // +UULOC: <date>,<time>,<lat>,<long>,<alt>,<uncertainty>[,<speed>,
+                //         <direction>,<vertical_acc>,<sensor_used>,<SV_used>,...]
+                } else if (0 == strncmp(cmd, "UULOC: ", 7)) {
+                    CellLocData loc;
+                    char la[16], lo[16];
+                    memset(&loc, 0, sizeof(loc));
+                    a = CELL_LAST;
+                    r = sscanf(cmd, "UULOC: %d/%d/%d,%d:%d:%d.%*d,%15[^,],%15[^,],%d,%d,%d,%d,%d,%d,%d", 
+                               &loc.day, &loc.month, &loc.year, &loc.hour, &loc.minute, &loc.second, 
+                               la, lo, &loc.altitude, &loc.uncertainty, &loc.speed, &loc.direction, 
+                               &loc.verticalAcc, &a, &loc.svUsed);
+                    if (r >= 10) {
+                        loc.latitude = atof(la);
+                        loc.longitude = atof(lo);
+                        loc.sensor = (CellSensType)a;
+                        loc.ttf_ms = _locTimer.read_ms();
+                        _loc = loc;
+                        _locDone = true;
+                        TRACE("CellLocate: %s %s +/-%dm\r\n", la, lo, loc.uncertainty);
+                    }
                 }                
                 if (_dev.dev == DEV_LISA_C200) {
                     // CDMA Specific -------------------------------------------
@@ -188,18 +258,23 @@ int MDMParser::waitFinalResp(_CALLBACKPTR cb /* = NULL*/,
                     // GSM/UMTS Specific -------------------------------------------
                     // +UUPSDD: <profile_id> 
                     if (sscanf(cmd, "UUPSDD: %d",&a) == 1) {
-                        if (*PROFILE == a) _ip = NOIP;
+                        if (atoi(PROFILE) == a) {
+                            _ip = NOIP;
+                            if (_linkCb) _linkCb(_linkParam, LINK_PDP_LOST, a);
+                        }
                     } else {
                         // +CREG|CGREG: <n>,<stat>[,<lac>,<ci>[,AcT[,<rac>]]] // reply to AT+CREG|AT+CGREG
                         // +CREG|CGREG: <stat>[,<lac>,<ci>[,AcT[,<rac>]]]     // URC
                         b = 0xFFFF; c = 0xFFFFFFFF; d = -1;
                         r = sscanf(cmd, "%s %*d,%d,\"%X\",\"%X\",%d",s,&a,&b,&c,&d);
-                        if (r <= 1)
+                        bool urc = (r <= 1);
+                        if (urc)
                             r = sscanf(cmd, "%s %d,\"%X\",\"%X\",%d",s,&a,&b,&c,&d);
                         if (r >= 2) {
                             Reg *reg = !strcmp(s, "CREG:")  ? &_net.csd : 
                                        !strcmp(s, "CGREG:") ? &_net.psd : NULL;
                             if (reg) {
+                                Reg old = *reg;
                                 // network status
                                 if      (a == 0) *reg = REG_NONE;     // 0: not registered, home network
                                 else if (a == 1) *reg = REG_HOME;     // 1: registered, home network
@@ -219,6 +294,8 @@ int MDMParser::waitFinalResp(_CALLBACKPTR cb /* = NULL*/,
                                     else if (d == 5) _net.act = ACT_UTRAN;    // 5: UTRAN with HSUPA availability
                                     else if (d == 6) _net.act = ACT_UTRAN;    // 6: UTRAN with HSDPA and HSUPA availability
                                 }
+                                // only the URCs, the replies follow a reset of _net
+                                if (urc && (*reg != old) && _linkCb) _linkCb(_linkParam, LINK_REG_CHANGED, *reg);
                             }
                         }
                     }
@@ -227,13 +304,19 @@ int MDMParser::waitFinalResp(_CALLBACKPTR cb /* = NULL*/,
             if (cb) {
                 int len = LENGTH(ret);
                 int ret = cb(type, buf, len, param);
-                if (WAIT != ret)
+                if (WAIT != ret) {
+                    _metricsStop(ret);
                     return ret; 
+                }
             }
-            if (type == TYPE_OK)
+            if (type == TYPE_OK) {
+                _metricsStop(RESP_OK);
                 return RESP_OK;
-            if (type == TYPE_ERROR)
+            }
+            if (type == TYPE_ERROR) {
+                _metricsStop(RESP_ERROR);
                 return RESP_ERROR;
+            }
             if (type == TYPE_PROMPT)    
                 return RESP_PROMPT;
         }
@@ -241,6 +324,8 @@ int MDMParser::waitFinalResp(_CALLBACKPTR cb /* = NULL*/,
         wait_ms(10); 
     }
     while (!TIMEOUT(timer, timeout_ms));
+    if (timeout_ms)
+        _metricsStop(WAIT);
     return WAIT;
 }
 
@@ -262,6 +347,82 @@ int MDMParser::_cbInt(int type, const char* buf, int len, int* val)
     return WAIT;
 }
 
+int MDMParser::sendBatch(const BatchCmd* cmds, int num, int timeout_ms /*= 10000*/)
+{
+    char buf[MAX_SIZE];
+    int len = 0;
+    buf[len++] = 'A';
+    buf[len++] = 'T';
+    for (int i = 0; i < num; i ++) {
+        int n = strlen(cmds[i].cmd);
+        if (len + 1 + n + 2 > (int)sizeof(buf))
+            return RESP_ERROR; // does not fit on a single command line
+        if (i > 0)
+            buf[len++] = ';';
+        memcpy(&buf[len], cmds[i].cmd, n);
+        len += n;
+    }
+    buf[len++] = '\r';
+    buf[len++] = '\n';
+    _metricsStart(buf);
+    send(buf, len);
+    BATCHparam param;
+    param.cmds = cmds;
+    param.num = num;
+    param.ix = 0;
+    return waitFinalResp(_cbBatch, &param, timeout_ms);
+}
+
+int MDMParser::_cbBatch(int type, const char* buf, int len, BATCHparam* param)
+{
+    if (param && (type == TYPE_PLUS)) {
+        // +<name>: ... belongs to the command with the same name
+        for (int i = 0; i < param->num; i ++) {
+            const char* cmd = param->cmds[i].cmd;
+            int n = strcspn(cmd, "?=");
+            if ((len > n + 2) && (0 == memcmp(buf+2, cmd, n)) && (buf[2+n] == ':')) {
+                if (param->cmds[i].cb)
+                    param->cmds[i].cb(type, buf, len, param->cmds[i].param);
+                param->ix = i + 1;
+                break;
+            }
+        }
+    } else if (param && (type == TYPE_UNKNOWN)) {
+        // consecutive text lines are reported as a single block,
+        // split them and pass each framed line to the next command
+        // that answers with text, set and read commands don't
+        const char* end = buf + len;
+        while (param->ix < param->num) {
+            const BatchCmd* cmd = &param->cmds[param->ix];
+            if (!cmd->cb || strpbrk(cmd->cmd, "=?")) {
+                param->ix ++;
+                continue;
+            }
+            while ((buf < end) && ((*buf == '\r') || (*buf == '\n')))
+                buf ++;
+            const char* eol = buf;
+            while ((eol < end) && (*eol != '\r') && (*eol != '\n'))
+                eol ++;
+            if (eol == buf)
+                break;
+            char line[MAX_SIZE];
+            int n = eol - buf;
+            if (n > (int)sizeof(line) - 5)
+                n = sizeof(line) - 5;
+            line[0] = '\r';
+            line[1] = '\n';
+            memcpy(&line[2], buf, n);
+            line[n+2] = '\r';
+            line[n+3] = '\n';
+            line[n+4] = '\0';
+            param->ix ++;
+            cmd->cb(type, line, n + 4, cmd->param);
+            buf = eol;
+        }
+    }
+    return WAIT;
+}
+
 // ----------------------------------------------------------------
 
 bool MDMParser::connect(
@@ -291,37 +452,63 @@ bool MDMParser::connect(
     return true;
 }
 
-bool MDMParser::init(const char* simpin, DevStatus* status, PinName pn, PinName r_pn)
+bool MDMParser::_powerOn(PinName pn, PinName r_pn, Timer& timer)
 {
-    int i = 10;
-    LOCK();
-    memset(&_dev, 0, sizeof(_dev));
-    if (pn != NC) {
-        INFO("Modem::wakeup\r\n");
-        DigitalOut pin(pn, 0);
-        DigitalOut r_pin(r_pn, 0);
-        while (i--) {
+    DigitalOut pin(pn, 0);
+    DigitalOut r_pin(r_pn, 0);
+    // a module that is still on needs no pulse, the probes also let 
+    // the autobauding lock on the rate
+    for (int i = 0; i < 2; i ++) {
+        purge();
+        sendFormated("AT\r\n");
+        if (RESP_OK == waitFinalResp(NULL,NULL,BOOT_PROBE_MS))
+            return true;
+    }
+    while (timer.read_ms() < BOOT_MAX_MS) {
+        // the pulse of the module found the last time, all pulses if unknown
+        Dev dev = _lastDev;
+        bool u = (dev == DEV_LISA_U200) || (dev == DEV_SARA_U260) || (dev == DEV_SARA_U270);
+        if (u || (dev == DEV_UNKNOWN)) {
             // SARA-U2/LISA-U2 50..80us
             pin = 1; ::wait_us(50);
             pin = 0; ::wait_ms(10); 
-            
+        }
+        if (!u) {
             // SARA-G35 >5ms, LISA-C2 > 150ms, LEON-G2 >5ms
-            pin = 1; ::wait_ms(150);
-            pin = 0; ::wait_ms(100);
-            
-            // purge any messages 
+            bool g = (dev == DEV_SARA_G350) || (dev == DEV_LEON_G200);
+            pin = 1; ::wait_ms(g ? 10 : 150);
+            pin = 0; ::wait_ms(g ? 10 : 100);
+        }
+        _boot.pulses ++;
+        // check the interface until the module answers
+        Timer wait;
+        wait.start();
+        while (wait.read_ms() < BOOT_WAIT_MS) {
             purge();
-            
-            // check interface
             sendFormated("AT\r\n");
-            int r = waitFinalResp(NULL,NULL,1000);
-            if(RESP_OK == r) break;
+            if (RESP_OK == waitFinalResp(NULL,NULL,BOOT_PROBE_MS))
+                return true;
         }
-        if (i < 0) {
+    }
+    return false;
+}
+
+bool MDMParser::init(const char* simpin, DevStatus* status, PinName pn, PinName r_pn)
+{
+    Timer timer;
+    timer.start();
+    LOCK();
+    memset(&_dev, 0, sizeof(_dev));
+    _boot.pulses = 0;
+    _boot.onMs = _boot.idMs = _boot.simMs = _boot.readyMs = -1;
+    if (pn != NC) {
+        INFO("Modem::wakeup\r\n");
+        if (!_powerOn(pn, r_pn, timer)) {
             ERROR("No Reply from Modem\r\n");
             goto failure;
         }
     }
+    _boot.onMs = timer.read_ms();
     _init = true;
     
     INFO("Modem::init\r\n");
@@ -338,29 +525,28 @@ bool MDMParser::init(const char* simpin, DevStatus* status, PinName pn, PinName
     if (RESP_OK != waitFinalResp())
         goto failure;
     wait_ms(40);
+    // follow the modem if the link was raised before
+    if (_linkBaud != 115200) {
+        _setBaudrate(115200);
+        _linkBaud = 115200;
+    }
     // identify the module 
     sendFormated("ATI\r\n");
     if (RESP_OK != waitFinalResp(_cbATI, &_dev.dev))
         goto failure;
     if (_dev.dev == DEV_UNKNOWN)
         goto failure;
+    _lastDev = _dev.dev;
+    _boot.idMs = timer.read_ms();
     // device specific init
     if (_dev.dev == DEV_LISA_C200) {
-        // get the manufacturer
-        sendFormated("AT+GMI\r\n");
-        if (RESP_OK != waitFinalResp(_cbString, _dev.manu))
-            goto failure;
-        // get the model identification
-        sendFormated("AT+GMM\r\n");
-        if (RESP_OK != waitFinalResp(_cbString, _dev.model))
-            goto failure;
-        // get the sw version
-        sendFormated("AT+GMR\r\n");
-        if (RESP_OK != waitFinalResp(_cbString, _dev.ver))
-            goto failure;
-        // get the pseudo ESN or MEID
-        sendFormated("AT+GSN\r\n");
-        if (RESP_OK != waitFinalResp(_cbString, _dev.meid))
+        BatchCmd cmds[] = {
+            _BATCH("+GMI", _cbString, _dev.manu),   // get the manufacturer
+            _BATCH("+GMM", _cbString, _dev.model),  // get the model identification
+            _BATCH("+GMR", _cbString, _dev.ver),    // get the sw version
+            _BATCH("+GSN", _cbString, _dev.meid),   // get the pseudo ESN or MEID
+        };
+        if (RESP_OK != sendBatch(cmds, sizeof(cmds)/sizeof(*cmds)))
             goto failure;
 #if 0
         // enable power saving
@@ -410,65 +596,71 @@ bool MDMParser::init(const char* simpin, DevStatus* status, PinName pn, PinName
                 ERROR("SIM not inserted\r\n");
             goto failure;
         }
-        // get the manufacturer
-        sendFormated("AT+CGMI\r\n");
-        if (RESP_OK != waitFinalResp(_cbString, _dev.manu))
-            goto failure;
-        // get the model identification
-        sendFormated("AT+CGMM\r\n");
-        if (RESP_OK != waitFinalResp(_cbString, _dev.model))
-            goto failure;
-        // get the 
-        sendFormated("AT+CGMR\r\n");
-        if (RESP_OK != waitFinalResp(_cbString, _dev.ver))
-            goto failure;            
-        // Returns the ICCID (Integrated Circuit Card ID) of the SIM-card. 
-        // ICCID is a serial number identifying the SIM.
-        sendFormated("AT+CCID\r\n");
-        if (RESP_OK != waitFinalResp(_cbCCID, _dev.ccid))
-            goto failure;
-        // Returns the product serial number, IMEI (International Mobile Equipment Identity)
-        sendFormated("AT+CGSN\r\n");
-        if (RESP_OK != waitFinalResp(_cbString, _dev.imei))
-            goto failure;
-        // enable power saving
-        if (_dev.lpm != LPM_DISABLED) {
-             // enable power saving (requires flow control, cts at least)
-            sendFormated("AT+UPSV=1\r\n");
-            if (RESP_OK != waitFinalResp())
-                goto failure;  
-            _dev.lpm = LPM_ACTIVE;
+        _boot.simMs = timer.read_ms();
+        {
+            BatchCmd cmds[] = {
+                // get the manufacturer
+                _BATCH("+CGMI", _cbString, _dev.manu),
+                // get the model identification
+                _BATCH("+CGMM", _cbString, _dev.model),
+                // get the sw version
+                _BATCH("+CGMR", _cbString, _dev.ver),
+                // Returns the ICCID (Integrated Circuit Card ID) of the SIM-card.
+                // ICCID is a serial number identifying the SIM.
+                _BATCH("+CCID", _cbCCID,   _dev.ccid),
+                // Returns the product serial number, IMEI (International Mobile Equipment Identity)
+                _BATCH("+CGSN", _cbString, _dev.imei),
+                // enable the psd registration unsolicited result code
+                _BATCH("+CGREG=2", NULL,   NULL),
+            };
+            if (RESP_OK != sendBatch(cmds, sizeof(cmds)/sizeof(*cmds)))
+                goto failure;
         }
-        // enable the psd registration unsolicited result code
-        sendFormated("AT+CGREG=2\r\n");
-        if (RESP_OK != waitFinalResp())
+        // power saving is possible, the application enables it with setPowerSaving
+        _dev.lpm = LPM_ENABLED;
+    }
+    {
+        BatchCmd cmds[] = {
+            // enable the network registration unsolicited result code
+            _BATCH((_dev.dev == DEV_LISA_C200) ? "+CREG=1" : "+CREG=2", NULL, NULL),
+            // Setup SMS in text mode
+            _BATCH("+CMGF=1",   NULL,      NULL),
+            // setup new message indication
+            _BATCH("+CNMI=2,1", NULL,      NULL),
+            // Request IMSI (International Mobile Subscriber Identification)
+            _BATCH("+CIMI",     _cbString, _dev.imsi),
+        };
+        if (RESP_OK != sendBatch(cmds, sizeof(cmds)/sizeof(*cmds)))
             goto failure;
-    } 
-    // enable the network registration unsolicited result code
-    sendFormated("AT+CREG=%d\r\n", (_dev.dev == DEV_LISA_C200) ? 1 : 2);
-    if (RESP_OK != waitFinalResp())
-        goto failure;
-    // Setup SMS in text mode 
-    sendFormated("AT+CMGF=1\r\n");
-    if (RESP_OK != waitFinalResp())
-        goto failure;
-    // setup new message indication
-    sendFormated("AT+CNMI=2,1\r\n");
-    if (RESP_OK != waitFinalResp())
-        goto failure;
-    // Request IMSI (International Mobile Subscriber Identification)
-    sendFormated("AT+CIMI\r\n");
-    if (RESP_OK != waitFinalResp(_cbString, _dev.imsi))
-        goto failure;
+    }
     if (status)
         memcpy(status, &_dev, sizeof(DevStatus));
+    _boot.readyMs = timer.read_ms();
+    INFO("Modem::init %d pulses, on %d ms, id %d ms, sim %d ms, ready %d ms\r\n",
+         _boot.pulses, _boot.onMs, _boot.idMs, _boot.simMs, _boot.readyMs);
     UNLOCK();
     return true; 
 failure:
+    INFO("Modem::init failed %d pulses, on %d ms, id %d ms, sim %d ms\r\n",
+         _boot.pulses, _boot.onMs, _boot.idMs, _boot.simMs);
     unlock();
     return false; 
 }
 
+unsigned int MDMParser::entropy(void)
+{
+    // FNV-1a of the identities, differs between the devices
+    const char* ids[] = { _dev.imei, _dev.meid, _dev.imsi, _dev.ccid };
+    unsigned int h = 2166136261u;
+    for (int i = 0; i < (int)(sizeof(ids)/sizeof(*ids)); i ++) {
+        for (const char* p = ids[i]; *p; p ++)
+            h = (h ^ (unsigned char)*p) * 16777619u;
+    }
+    // the timer differs between the boots
+    unsigned int t = us_ticker_read();
+    return h ^ (t * 2654435761u) ^ (t >> 16);
+}
+
 bool MDMParser::powerOff(void)
 {
     bool ok = false;
@@ -480,11 +672,98 @@ bool MDMParser::powerOff(void)
             _init = false;
             ok = true;
         }
+        if (_psv != PSV_OFF) {
+            _powerSaving(PSV_OFF, NC);
+            _psv = PSV_OFF;
+            _dev.lpm = LPM_ENABLED;
+        }
         UNLOCK();
     }
     return ok;
 }
 
+int MDMParser::raiseBaudrate(int baudrate /*= 921600*/)
+{
+    static const int rates[] = { 230400, 460800, 921600 };
+    LOCK();
+    if (!_init)
+        goto failure;
+    for (int i = 0; (i < (int)(sizeof(rates)/sizeof(*rates))) && (rates[i] <= baudrate); i ++) {
+        if (rates[i] <= _linkBaud)
+            continue;
+        INFO("Modem::raiseBaudrate %d\r\n", rates[i]);
+        // the modem answers at the old rate and switches afterwards
+        sendFormated("AT+IPR=%d\r\n", rates[i]);
+        if (RESP_OK != waitFinalResp())
+            break;
+        wait_ms(40);
+        _setBaudrate(rates[i]);
+        purge();
+        sendFormated("AT\r\n");
+        if (RESP_OK == waitFinalResp(NULL,NULL,1000)) {
+            _linkBaud = rates[i];
+            continue;
+        }
+        // not working, fall back to the last rate 
+        ERROR("Modem::raiseBaudrate %d failed\r\n", rates[i]);
+        sendFormated("AT+IPR=%d\r\n", _linkBaud);
+        waitFinalResp(NULL,NULL,1000);
+        wait_ms(40);
+        _setBaudrate(_linkBaud);
+        purge();
+        sendFormated("AT\r\n");
+        if (RESP_OK != waitFinalResp(NULL,NULL,1000))
+            ERROR("Modem::raiseBaudrate lost the link\r\n");
+        break;
+    }
+    UNLOCK();
+    return _linkBaud;
+failure:
+    unlock();
+    return _linkBaud;
+}
+
+bool MDMParser::setPowerSaving(Psv psv, PinName dtr /*= NC*/)
+{
+    bool ok = false;
+    LOCK();
+    if (_init && (_dev.dev != DEV_LISA_C200))
+        ok = _setPowerSaving(psv, dtr);
+    UNLOCK();
+    return ok;
+}
+
+bool MDMParser::_setPowerSaving(Psv psv, PinName dtr)
+{
+    INFO("Modem::setPowerSaving %d\r\n", psv);
+    // gate the transmission before the module may fall asleep
+    if ((psv != PSV_OFF) && !_powerSaving(psv, dtr))
+        return false;
+    sendFormated("AT+UPSV=%d\r\n", psv);
+    if (RESP_OK != waitFinalResp()) {
+        _powerSaving(_psv, NC);
+        return false;
+    }
+    if (psv == PSV_OFF)
+        _powerSaving(PSV_OFF, NC);
+    _psv = psv;
+    _dev.lpm = (psv != PSV_OFF) ? LPM_ACTIVE : LPM_ENABLED;
+    return true;
+}
+
+void MDMParser::getPowerStats(PowerStats* stats)
+{
+    memset(stats, 0, sizeof(*stats));
+    LOCK();
+    _powerStats(stats);
+    stats->psv = _psv;
+    UNLOCK();
+    // estimate the charge from typical currents of the module
+    unsigned long long uAms = (unsigned long long)stats->awakeMs * PSV_AWAKE_UA 
+                            + (unsigned long long)stats->sleepMs * PSV_SLEEP_UA;
+    stats->chargeUAh = (unsigned int)(uAms / (3600ULL * 1000ULL));
+}
+
 int MDMParser::_cbATI(int type, const char* buf, int len, Dev* dev)
 {
     if ((type == TYPE_UNKNOWN) && dev) {
@@ -527,8 +806,39 @@ bool MDMParser::registerNet(NetStatus* status /*= NULL*/, int timeout_ms /*= 180
     Timer timer;
     timer.start();
     INFO("Modem::register\r\n");
-    while (!checkNetStatus(status) && !TIMEOUT(timer, timeout_ms))
-        wait_ms(1000);
+    bool done = false;
+    LOCK();
+    memset(&_net, 0, sizeof(_net));
+    _net.lac = 0xFFFF;
+    _net.ci = 0xFFFFFFFF;
+    UNLOCK();
+    // changes of the registration are reported by the +CREG/+CGREG URCs 
+    // enabled in init, so we only query the state now and then and wait 
+    // for the URCs in between
+    Timer recheck;
+    bool query = true;
+    while (!done && !TIMEOUT(timer, timeout_ms)) {
+        int ms = REG_SLICE_MS;
+        if ((timeout_ms != TIMEOUT_BLOCKING) && (timeout_ms - timer.read_ms() < ms))
+            ms = timeout_ms - timer.read_ms();
+        LOCK();
+        if (query) {
+            BatchCmd cmds[] = {
+                _BATCH("+CREG?",  NULL, NULL),
+                _BATCH("+CGREG?", NULL, NULL),
+            };
+            sendBatch(cmds, (_dev.dev != DEV_LISA_C200) ? 2 : 1);
+            recheck.reset();
+            recheck.start();
+        }
+        if (!REG_DONE(_net.csd) || !REG_DONE(_net.psd))
+            waitFinalResp(_cbCREG, &_net, ms);
+        done = REG_DONE(_net.csd) && REG_DONE(_net.psd);
+        UNLOCK();
+        query = (recheck.read_ms() >= REG_RECHECK_MS);
+    }
+    // get the operator, number and signal strength once we are done
+    checkNetStatus(status);
     if (_net.csd == REG_DENIED) ERROR("CSD Registration Denied\r\n");
     if (_net.psd == REG_DENIED) ERROR("PSD Registration Denied\r\n");
     return REG_OK(_net.csd) || REG_OK(_net.psd);
@@ -541,13 +851,14 @@ bool MDMParser::checkNetStatus(NetStatus* status /*= NULL*/)
     memset(&_net, 0, sizeof(_net));
     _net.lac = 0xFFFF;
     _net.ci = 0xFFFFFFFF;
-    // check registration
-    sendFormated("AT+CREG?\r\n");
-    waitFinalResp();     // don't fail as service could be not subscribed 
-    if (_dev.dev != DEV_LISA_C200) {
-        // check PSD registration
-        sendFormated("AT+CGREG?\r\n");
-        waitFinalResp(); // don't fail as service could be not subscribed 
+    {
+        // check registration and PSD registration (not on CDMA)
+        BatchCmd cmds[] = {
+            _BATCH("+CREG?",  NULL, NULL),
+            _BATCH("+CGREG?", NULL, NULL),
+        };
+        // don't fail as service could be not subscribed
+        sendBatch(cmds, (_dev.dev != DEV_LISA_C200) ? 2 : 1);
     }
     if (REG_OK(_net.csd) || REG_OK(_net.psd))
     {
@@ -601,19 +912,22 @@ bool MDMParser::checkNetStatus(NetStatus* status /*= NULL*/)
             sendFormated("AT$QCMIPNAI?\r\n");
             if (RESP_OK != waitFinalResp(_cbString, nai))
                 goto failure;
-        } else {
-            sendFormated("AT+COPS?\r\n");
-            if (RESP_OK != waitFinalResp(_cbCOPS, &_net))
+            // get the signal strength indication
+            sendFormated("AT+CSQ\r\n");
+            if (RESP_OK != waitFinalResp(_cbCSQ, &_net))
                 goto failure;
-            // get the MSISDNs related to this subscriber
-            sendFormated("AT+CNUM\r\n");
-            if (RESP_OK != waitFinalResp(_cbCNUM, _net.num))
+        } else {
+            BatchCmd cmds[] = {
+                // get the operator
+                _BATCH("+COPS?", _cbCOPS, &_net),
+                // get the MSISDNs related to this subscriber
+                _BATCH("+CNUM",  _cbCNUM, _net.num),
+                // get the signal strength indication
+                _BATCH("+CSQ",   _cbCSQ,  &_net),
+            };
+            if (RESP_OK != sendBatch(cmds, sizeof(cmds)/sizeof(*cmds)))
                 goto failure;
-        }  
-        // get the signal strength indication
-        sendFormated("AT+CSQ\r\n");
-        if (RESP_OK != waitFinalResp(_cbCSQ, &_net))
-            goto failure;
+        }
     }
     if (status) {
         memcpy(status, &_net, sizeof(NetStatus));
@@ -650,6 +964,128 @@ int MDMParser::_cbCNUM(int type, const char* buf, int len, char* num)
     return WAIT;
 }
                     
+int MDMParser::_cbUCELLINFO(int type, const char* buf, int len, CellSnapshot* snap)
+{
+    if ((type == TYPE_PLUS) && snap && (snap->num < NUM_CELLS)) {
+        int m, t, n = 0;
+        // +UCELLINFO: <mode>,<type>,...
+        if (sscanf(buf, "\r\n+UCELLINFO: %d,%d,%n", &m, &t, &n) == 2) {
+            const char* p = buf + n;
+            CellInfo* cell = &snap->cell[snap->num];
+            int a, b, c, d, e, f, g, h;
+            cell->mcc = cell->mnc = cell->lac = cell->ci = -1;
+            cell->psc = cell->freq = -1;
+            cell->ecno = 0;
+            if (((t == 0) || (t == 1) || (t == 5)) && 
+                (sscanf(p, "%d,%d,%X,%X,%d", &a, &b, &c, &d, &e) == 5)) {
+                // GSM: <MCC>,<MNC>,<LAC>,<CI>,<RxLev>
+                cell->serving = (t == 0);
+                cell->act = ACT_GSM;
+                cell->mcc = a; cell->mnc = b; cell->lac = c; cell->ci = d;
+                cell->dbm = -110 + e; // 0: -110 .. 63: -48 dBm
+                snap->num ++;
+            } else if ((t == 2) && 
+                (sscanf(p, "%d,%d,%X,%X,%d,%d,%d,%d", &a, &b, &c, &d, &e, &f, &g, &h) == 8)) {
+                // UTRAN: <MCC>,<MNC>,<LAC>,<CI>,<scrambling_code>,<dl_frequency>,<rscp_lev>,<ecn0_lev>
+                cell->serving = true;
+                cell->act = ACT_UTRAN;
+                cell->mcc = a; cell->mnc = b; cell->lac = c; cell->ci = d;
+                cell->psc = e; cell->freq = f;
+                cell->dbm = -116 + g;  // 0: -116 .. 91: -25 dBm
+                cell->ecno = (h - 49) / 2; // 0: -24.5 .. 49: 0 dB
+                snap->num ++;
+            } else if (((t == 3) || (t == 4)) && 
+                (sscanf(p, "%d,%d,%d,%d", &e, &f, &g, &h) == 4)) {
+                // UTRAN neighbour: <scrambling_code>,<dl_frequency>,<rscp_lev>,<ecn0_lev>
+                cell->serving = false;
+                cell->act = ACT_UTRAN;
+                cell->psc = e; cell->freq = f;
+                cell->dbm = -116 + g;
+                cell->ecno = (h - 49) / 2;
+                snap->num ++;
+            }
+        }
+    }
+    return WAIT;
+}
+
+int MDMParser::_cellQuality(const CellInfo* cell)
+{
+    // signal level -110 (none) .. -60 dBm (excellent)
+    int q = (cell->dbm + 110) * 2;
+    if (cell->act == ACT_UTRAN) {
+        // the interference counts as much, -20 (none) .. -6 dB (excellent)
+        int e = (cell->ecno + 20) * 100 / 14;
+        if (e < 0)   e = 0;
+        if (e > 100) e = 100;
+        if (q > 100) q = 100;
+        q = (q + e) / 2;
+    }
+    if (q < 0)   q = 0;
+    if (q > 100) q = 100;
+    return q;
+}
+
+bool MDMParser::cellInfo(CellSnapshot* snap, int maxAge_ms /*= 0*/)
+{
+    LOCK();
+    int age = _cellsTimer.read_ms();
+    // the timer wraps after half an hour, negative ages are stale
+    if (!_cellsValid || (age < 0) || (age > maxAge_ms)) {
+        CellSnapshot cells;
+        cells.num = 0;
+        sendFormated("AT+UCELLINFO?\r\n");
+        if ((RESP_OK != waitFinalResp(_cbUCELLINFO, &cells)) || (cells.num == 0)) {
+            // fall back to the signal strength of the serving cell
+            NetStatus net = _net;
+            net.rssi = 0;
+            sendFormated("AT+CSQ\r\n");
+            if ((RESP_OK != waitFinalResp(_cbCSQ, &net)) || (net.rssi == 0))
+                goto failure;
+            CellInfo* cell = &cells.cell[0];
+            cell->serving = true;
+            // without Ec/No only the level counts, as for GSM
+            cell->act = ACT_GSM;
+            cell->mcc = cell->mnc = -1;
+            cell->lac = (_net.lac != 0xFFFF) ? _net.lac : -1;
+            cell->ci = (_net.ci != 0xFFFFFFFF) ? (int)_net.ci : -1;
+            cell->psc = cell->freq = -1;
+            cell->dbm = net.rssi;
+            cell->ecno = 0;
+            cells.num = 1;
+        }
+        cells.quality = 0;
+        for (int i = 0; i < cells.num; i ++) {
+            if (cells.cell[i].serving) {
+                cells.quality = _cellQuality(&cells.cell[i]);
+                break;
+            }
+        }
+        _cells = cells;
+        _cellsValid = true;
+        _cellsTimer.reset();
+        _cellsTimer.start();
+        age = 0;
+    }
+    if (snap) {
+        *snap = _cells;
+        snap->age_ms = age;
+    }
+    UNLOCK();
+    return true;
+failure:
+    unlock();
+    return false;
+}
+
+int MDMParser::linkQuality(int maxAge_ms /*= 60000*/)
+{
+    CellSnapshot snap;
+    if (!cellInfo(&snap, maxAge_ms))
+        return -1;
+    return snap.quality;
+}
+
 int MDMParser::_cbCSQ(int type, const char* buf, int len, NetStatus* status)
 {
     if ((type == TYPE_PLUS) && status){
@@ -664,6 +1100,14 @@ int MDMParser::_cbCSQ(int type, const char* buf, int len, NetStatus* status)
     return WAIT;
 }
 
+int MDMParser::_cbCREG(int type, const char* buf, int len, NetStatus* status)
+{
+    // the registration URCs are already parsed by waitFinalResp
+    if (status && REG_DONE(status->csd) && REG_DONE(status->psd))
+        return RESP_OK;
+    return WAIT;
+}
+
 int MDMParser::_cbUACTIND(int type, const char* buf, int len, int* i)
 {
     if ((type == TYPE_PLUS) && i){
@@ -703,11 +1147,29 @@ MDMParser::IP MDMParser::join(const char* apn /*= NULL*/, const char* username /
         
         // Check the profile
         int a = 0;
-        bool force = true;
         sendFormated("AT+UPSND=" PROFILE ",8\r\n");
         if (RESP_OK != waitFinalResp(_cbUPSND, &a))
             goto failure;
-        if (a == 1 && force) {
+        if (a == 1) {
+            // keep an active context of the same apn that still has an ip, 
+            // without an apn any context set up by a previous join will do
+            char used[64] = "";
+            if (apn) {
+                sendFormated("AT+UPSD=" PROFILE ",1\r\n");
+                if (RESP_OK != waitFinalResp(_cbUPSD, used))
+                    *used = '\0';
+            }
+            if (!apn || (0 == strcmp(apn, used))) {
+                sendFormated("AT+UPSND=" PROFILE ",0\r\n");
+                if ((RESP_OK == waitFinalResp(_cbUPSND, &_ip)) && (_ip != NOIP)) {
+                    INFO("Modem::join reusing the active context\r\n");
+                    unlock();
+                    return _ip;
+                }
+                _ip = NOIP;
+            }
+        }
+        if (a == 1) {
             // disconnect the profile already if it is connected 
             sendFormated("AT+UPSDA=" PROFILE ",4\r\n");
             if (RESP_OK != waitFinalResp(NULL,NULL,40*1000))
@@ -725,51 +1187,83 @@ MDMParser::IP MDMParser::join(const char* apn /*= NULL*/, const char* username /
             sendFormated("AT+UPSD=" PROFILE ",7,\"0.0.0.0\"\r\n");
             if (RESP_OK != waitFinalResp())
                 goto failure;
- 
-            do {
+            
+            // the settings that worked the last time with this SIM are tried first
+            // the record is: imsi "\0" apn "\0" username "\0" password "\0" auth "\0"
+            // without an imsi the record could belong to any SIM, it is not used
+            char lkg[128];
+            URDFILEparam file = { APN_LKG_FILE, lkg, sizeof(lkg), 0 };
+            const char* last = NULL;
+            bool kept = false;
+            if (config && *_dev.imsi) {
+                sendFormated("AT+URDFILE=\"" APN_LKG_FILE "\"\r\n");
+                if ((RESP_OK == waitFinalResp(_cbURDFILE, &file)) && (file.len > 0) && 
+                    (lkg[file.len-1] == '\0') && (0 == strcmp(lkg, _dev.imsi))) {
+                    int n = 0;
+                    for (int i = 0; i < file.len; i ++)
+                        n += (lkg[i] == '\0');
+                    if (n == 5) {
+                        last = lkg + strlen(lkg) + 1;
+                        const char* p = last;
+                        apn      = _APN_GET(p);
+                        username = _APN_GET(p);
+                        password = _APN_GET(p);
+                        Auth la = (Auth)(*p - '0');
+                        ok = kept = _activateProfile(apn, username, password, &la);
+                    }
+                }
+            }
+            
+            Auth used = auth;
+            while (!ok) {
                 if (config) {
                     apn      = _APN_GET(config);
                     username = _APN_GET(config);
                     password = _APN_GET(config);
-                    TRACE("Testing APN Settings(\"%s\",\"%s\",\"%s\")\r\n", apn, username, password);
-                }
-                // Set up the APN
-                if (apn && *apn) {
-                    sendFormated("AT+UPSD=" PROFILE ",1,\"%s\"\r\n", apn);
-                    if (RESP_OK != waitFinalResp())
-                        goto failure;
-                }
-                if (username && *username) {
-                    sendFormated("AT+UPSD=" PROFILE ",2,\"%s\"\r\n", username);
-                    if (RESP_OK != waitFinalResp())
-                        goto failure;
-                }
-                if (password && *password) {
-                    sendFormated("AT+UPSD=" PROFILE ",3,\"%s\"\r\n", password);
-                    if (RESP_OK != waitFinalResp())
-                        goto failure;
-                }
-                // try different Authentication Protocols
-                // 0 = none 
-                // 1 = PAP (Password Authentication Protocol)
-                // 2 = CHAP (Challenge Handshake Authentication Protocol)
-                for (int i = AUTH_NONE; i <= AUTH_CHAP && !ok; i ++) {
-                    if ((auth == AUTH_DETECT) || (auth == i)) {
-                        // Set up the Authentication Protocol
-                        sendFormated("AT+UPSD=" PROFILE ",6,%d\r\n", i);
-                        if (RESP_OK != waitFinalResp())
-                            goto failure;
-                        // Activate the profile and make connection
-                        sendFormated("AT+UPSDA=" PROFILE ",3\r\n");
-                        if (RESP_OK == waitFinalResp(NULL,NULL,150*1000))
-                            ok = true;
+                    // the remembered settings just failed, don't wait for them again
+                    if (last && (0 == strcmp(apn, last))) {
+                        const char* p = last + strlen(last) + 1;
+                        if ((0 == strcmp(username, p)) && 
+                            (0 == strcmp(password, p + strlen(p) + 1))) {
+                            if (!*config)
+                                break; // no more settings to try
+                            continue;
+                        }
                     }
                 }
-            } while (!ok && config && *config); // maybe use next setting ? 
+                used = auth;
+                ok = _activateProfile(apn, username, password, &used);
+                if (!config || !*config)
+                    break; // no more settings to try
+            }
             if (!ok) {
                 ERROR("Your modem APN/password/username may be wrong\r\n");
                 goto failure;
             }
+            
+            // remember the settings from our database that worked, unless 
+            // they were the remembered ones
+            if (config && !kept && *_dev.imsi) {
+                const char* f[] = { _dev.imsi, apn, username, password };
+                int n = 0;
+                for (int i = 0; i < (int)(sizeof(f)/sizeof(*f)); i ++) {
+                    int l = strlen(f[i]);
+                    if (n + l + 1 + 2 > (int)sizeof(lkg)) 
+                        break;
+                    memcpy(&lkg[n], f[i], l + 1);
+                    n += l + 1;
+                }
+                lkg[n++] = '0' + used;
+                lkg[n++] = '\0';
+                // delete it first as writing would append to an existing file
+                sendFormated("AT+UDELFILE=\"" APN_LKG_FILE "\"\r\n");
+                waitFinalResp();
+                sendFormated("AT+UDWNFILE=\"" APN_LKG_FILE "\",%d\r\n", n);
+                if (RESP_PROMPT == waitFinalResp()) {
+                    send(lkg, n);
+                    waitFinalResp();
+                }
+            }
         }
         //Get local IP address
         sendFormated("AT+UPSND=" PROFILE ",0\r\n");
@@ -783,6 +1277,41 @@ failure:
     return NOIP;
 }
 
+bool MDMParser::_activateProfile(const char* apn, const char* username, 
+                                 const char* password, Auth* auth)
+{
+    TRACE("Testing APN Settings(\"%s\",\"%s\",\"%s\")\r\n", apn, username, password);
+    // Set up the APN, username and password, empty values clear previous settings
+    sendFormated("AT+UPSD=" PROFILE ",1,\"%s\"\r\n", apn ? apn : "");
+    if (RESP_OK != waitFinalResp())
+        return false;
+    sendFormated("AT+UPSD=" PROFILE ",2,\"%s\"\r\n", username ? username : "");
+    if (RESP_OK != waitFinalResp())
+        return false;
+    sendFormated("AT+UPSD=" PROFILE ",3,\"%s\"\r\n", password ? password : "");
+    if (RESP_OK != waitFinalResp())
+        return false;
+    // try different Authentication Protocols
+    // 0 = none 
+    // 1 = PAP (Password Authentication Protocol)
+    // 2 = CHAP (Challenge Handshake Authentication Protocol)
+    for (int i = AUTH_NONE; i <= AUTH_CHAP; i ++) {
+        if ((*auth == AUTH_DETECT) || (*auth == i)) {
+            // Set up the Authentication Protocol
+            sendFormated("AT+UPSD=" PROFILE ",6,%d\r\n", i);
+            if (RESP_OK != waitFinalResp())
+                return false;
+            // Activate the profile and make connection
+            sendFormated("AT+UPSDA=" PROFILE ",3\r\n");
+            if (RESP_OK == waitFinalResp(NULL,NULL,150*1000)) {
+                *auth = (Auth)i;
+                return true;
+            }
+        }
+    }
+    return false;
+}
+
 int MDMParser::_cbUDOPN(int type, const char* buf, int len, char* mccmnc)
 {
     if ((type == TYPE_PLUS) && mccmnc) {
@@ -822,6 +1351,16 @@ int MDMParser::_cbUPSND(int type, const char* buf, int len, IP* ip)
     return WAIT;
 }
 
+int MDMParser::_cbUPSD(int type, const char* buf, int len, char* apn)
+{
+    if ((type == TYPE_PLUS) && apn) {
+        // +UPSD: <profile_id>,1,"<apn>"
+        if (sscanf(buf, "\r\n+UPSD: " PROFILE ",1,\"%63[^\"]\"", apn) == 1)
+            /*nothing*/;
+    }
+    return WAIT;
+}
+
 int MDMParser::_cbUDNSRN(int type, const char* buf, int len, IP* ip)
 {
     if ((type == TYPE_PLUS) && ip) {
@@ -844,7 +1383,7 @@ bool MDMParser::disconnect(void)
             ok = true;
         } else { 
             sendFormated("AT+UPSDA=" PROFILE ",4\r\n");
-            if (RESP_OK != waitFinalResp()) {
+            if (RESP_OK == waitFinalResp()) {
                 _ip = NOIP;
                 ok = true;
             }
@@ -862,7 +1401,7 @@ MDMParser::IP MDMParser::gethostbyname(const char* host)
         ip = IPADR(a,b,c,d);
     else {
         LOCK();
-        sendFormated("AT+UDNSRN=0,\"%s\"\r\n", host);
+        sendCmd(AtCmd("AT+UDNSRN=0,").quoted(host).end());
         if (RESP_OK != waitFinalResp(_cbUDNSRN, &ip))
             ip = NOIP;
         UNLOCK();
@@ -870,6 +1409,21 @@ MDMParser::IP MDMParser::gethostbyname(const char* host)
     return ip;
 }
 
+void MDMParser::setLinkCallback(_LINKCB cb, void* param /*= NULL*/)
+{
+    LOCK();
+    _linkCb = cb;
+    _linkParam = param;
+    UNLOCK();
+}
+
+void MDMParser::processUrc(void)
+{
+    LOCK();
+    waitFinalResp(NULL, NULL, 0);
+    UNLOCK();
+}
+
 // ----------------------------------------------------------------
 // sockets
 
@@ -904,6 +1458,10 @@ int MDMParser::socketSocket(IpProtocol ipproto, int port)
         _sockets[socket].state = SOCK_CREATED;
         _sockets[socket].pending = 0;
         _sockets[socket].timeout_ms = TIMEOUT_BLOCKING;
+        _sockets[socket].txBlk = 0;
+        _sockets[socket].txFix = -1;
+        _sockets[socket].rxFix = -1;
+        _sockets[socket].paceFix = -1;
     }
     UNLOCK();
     return socket;
@@ -919,7 +1477,8 @@ bool MDMParser::socketConnect(int socket, const char * host, int port)
     LOCK();
     if (ISSOCKET(socket) && (_sockets[socket].state == SOCK_CREATED)) {
         TRACE("socketConnect(%d,%s,%d)\r\n", socket,host,port);
-        sendFormated("AT+USOCO=%d,\"" IPSTR "\",%d\r\n", socket, IPNUM(ip), port);
+        sendCmd(AtCmd("AT+USOCO=").num(socket).str(",\"").ip(ip).str("\",")
+                    .num(port).end());
         if (RESP_OK == waitFinalResp())
             ok = _sockets[socket].state = SOCK_CONNECTED;
     }
@@ -927,6 +1486,19 @@ bool MDMParser::socketConnect(int socket, const char * host, int port)
     return ok;
 }
 
+bool MDMParser::socketSecure(int socket, int profile /*= 0*/)
+{
+    bool ok = false;
+    LOCK();
+    if (ISSOCKET(socket) && (_sockets[socket].state == SOCK_CREATED)) {
+        TRACE("socketSecure(%d,%d)\r\n", socket, profile);
+        sendFormated("AT+USOSEC=%d,1,%d\r\n", socket, profile);
+        ok = (RESP_OK == waitFinalResp());
+    }
+    UNLOCK();
+    return ok;
+}
+
 bool MDMParser::socketIsConnected(int socket)
 {
     bool ok = false;
@@ -951,11 +1523,28 @@ bool MDMParser::socketSetBlocking(int socket, int timeout_ms)
     return ok;
 }
 
-bool  MDMParser::socketClose(int socket)
+bool MDMParser::socketSetChunking(int socket, int txBlock /*= -1*/, 
+                                  int rxBlock /*= -1*/, int pace_ms /*= -1*/)
 {
     bool ok = false;
     LOCK();
-    if (ISSOCKET(socket) && (_sockets[socket].state == SOCK_CONNECTED)) {
+    TRACE("socketSetChunking(%d,%d,%d,%d)\r\n", socket, txBlock, rxBlock, pace_ms);
+    if (ISSOCKET(socket)) {
+        _sockets[socket].txFix = (txBlock > 0) ? txBlock : -1;
+        _sockets[socket].rxFix = (rxBlock > 0) ? rxBlock : -1;
+        _sockets[socket].paceFix = (pace_ms >= 0) ? pace_ms : -1;
+        _sockets[socket].txBlk = 0;
+        ok = true;
+    }
+    UNLOCK();
+    return ok;
+}
+
+bool  MDMParser::socketClose(int socket)
+{
+    bool ok = false;
+    LOCK();
+    if (ISSOCKET(socket) && (_sockets[socket].state == SOCK_CONNECTED)) {
         TRACE("socketClose(%d)\r\n", socket);
         sendFormated("AT+USOCL=%d\r\n", socket);
         if (RESP_OK == waitFinalResp()) {
@@ -983,29 +1572,120 @@ bool  MDMParser::socketFree(int socket)
 }
 
 #define USO_MAX_WRITE 1024 //!< maximum number of bytes to write to socket
+#define USO_MIN_WRITE   64 //!< the adapted write block does not go below this
+#define USO_SLOW_MS   1500 //!< a write taking longer halves the block 
+#define USO_FAST_MS    250 //!< a write taking less doubles the block
+#define USO_FRESH_MS 60000 //!< age up to which the cell snapshot is used
+
+void MDMParser::_chunkLimits(int* tx, int* rx, int* pace)
+{
+    // the cached cell snapshot knows the Ec/No, else the last rssi counts
+    int q = -1;
+    int age = _cellsTimer.read_ms();
+    if (_cellsValid && (age >= 0) && (age < USO_FRESH_MS))
+        q = _cells.quality;
+    else if (_net.rssi < 0) {
+        q = (_net.rssi + 110) * 2; // -110 (none) .. -60 dBm (excellent)
+        if (q < 0) q = 0;
+    }
+    // bit errors cost retransmissions whatever the level, RXQUAL 5 and 6
+    // (ber 13 and 7) count as weak, 3 and 4 (25 and 19) as moderate,
+    // 0 is unknown or RXQUAL 7 which is not told apart
+    if ((_net.ber > 0) && (_net.ber <= 25)) {
+        int max = (_net.ber <= 13) ? 0 : 20;
+        if ((q < 0) || (q > max))
+            q = max;
+    }
+    // the read block only shrinks, a whole +USORD line plus headers and
+    // unsolicited commands must fit the line buffer of waitFinalResp
+    *tx = USO_MAX_WRITE;
+    *rx = MAX_SIZE;
+    *pace = 0;
+    if (q < 0) {
+        // unknown link, no limits
+    } else if (q < 20) {
+        // weak link, small chunks are lost less and repeated faster
+        *tx = 128;
+        *rx = 64;
+        *pace = 200;
+    } else if (q < 50) {
+        *tx = (_net.act == ACT_UTRAN) ? 512 : 256;
+        *pace = 50;
+    }
+}
+
+int MDMParser::_chunkTx(int socket, int* pace)
+{
+    int tx, rx, p;
+    _chunkLimits(&tx, &rx, &p);
+    if (!ISSOCKET(socket)) {
+        *pace = p;
+        return tx;
+    }
+    SockCtrl* sock = &_sockets[socket];
+    *pace = (sock->paceFix >= 0) ? sock->paceFix : p;
+    if (sock->txFix > 0)
+        return (sock->txFix < USO_MAX_WRITE) ? sock->txFix : USO_MAX_WRITE;
+    if ((sock->txBlk <= 0) || (sock->txBlk > tx))
+        sock->txBlk = tx;
+    return sock->txBlk;
+}
+
+int MDMParser::_chunkRx(int socket)
+{
+    int tx, rx, p;
+    _chunkLimits(&tx, &rx, &p);
+    if (ISSOCKET(socket) && (_sockets[socket].rxFix > 0))
+        rx = (_sockets[socket].rxFix < MAX_SIZE) ? _sockets[socket].rxFix : MAX_SIZE;
+    return rx;
+}
+
+void MDMParser::_chunkDone(int socket, bool ok, int ms)
+{
+    if (!ISSOCKET(socket) || (_sockets[socket].txFix > 0))
+        return;
+    SockCtrl* sock = &_sockets[socket];
+    if (!ok || (ms > USO_SLOW_MS)) {
+        if (sock->txBlk / 2 >= USO_MIN_WRITE)
+            sock->txBlk /= 2;
+    } else if (ms < USO_FAST_MS) {
+        // the limit of the link is applied with the next chunk
+        sock->txBlk *= 2;
+    }
+}
 
 int MDMParser::socketSend(int socket, const char * buf, int len)
 {
     TRACE("socketSend(%d,,%d)\r\n", socket,len);
     int cnt = len;
+    Timer timer;
+    timer.start();
     while (cnt > 0) {
-        int blk = USO_MAX_WRITE;
-        if (cnt < blk) 
-            blk = cnt;
+        int pace = 0;
+        int blk = 0;
         bool ok = false;
         LOCK();
-        sendFormated("AT+USOWR=%d,%d\r\n",socket,blk);
+        blk = _chunkTx(socket, &pace);
+        if (cnt < blk) 
+            blk = cnt;
+        timer.reset();
+        sendCmd(AtCmd("AT+USOWR=").num(socket).str(",").num(blk).end());
         if (RESP_PROMPT == waitFinalResp()) {
             wait_ms(50);
             send(buf, blk);
-            if (RESP_OK == waitFinalResp()) 
+            if (RESP_OK == waitFinalResp()) {
+                if (ISSOCKET(socket)) _metrics.txBytes[socket] += blk;
                 ok = true;
+            }
         }
+        _chunkDone(socket, ok, timer.read_ms());
         UNLOCK();
         if (!ok) 
             return SOCKET_ERROR;
         buf += blk;
         cnt -= blk;
+        if ((cnt > 0) && (pace > 0))
+            wait_ms(pace);
     }
     return (len - cnt);
 }
@@ -1014,24 +1694,35 @@ int MDMParser::socketSendTo(int socket, IP ip, int port, const char * buf, int l
 {
     TRACE("socketSendTo(%d," IPSTR ",%d,,%d)\r\n", socket, IPNUM(ip),port,len);
     int cnt = len;
+    Timer timer;
+    timer.start();
     while (cnt > 0) {
-        int blk = USO_MAX_WRITE;
-        if (cnt < blk) 
-            blk = cnt;
+        int pace = 0;
+        int blk = 0;
         bool ok = false;
         LOCK();
-        sendFormated("AT+USOST=%d,\"" IPSTR "\",%d,%d\r\n",socket,IPNUM(ip),port,blk);
+        blk = _chunkTx(socket, &pace);
+        if (cnt < blk) 
+            blk = cnt;
+        timer.reset();
+        sendCmd(AtCmd("AT+USOST=").num(socket).str(",\"").ip(ip).str("\",")
+                    .num(port).str(",").num(blk).end());
         if (RESP_PROMPT == waitFinalResp()) {
             wait_ms(50);
             send(buf, blk);
-            if (RESP_OK == waitFinalResp())
+            if (RESP_OK == waitFinalResp()) {
+                if (ISSOCKET(socket)) _metrics.txBytes[socket] += blk;
                 ok = true;
+            }
         }
+        _chunkDone(socket, ok, timer.read_ms());
         UNLOCK();
         if (!ok)
             return SOCKET_ERROR;
         buf += blk;
         cnt -= blk;
+        if ((cnt > 0) && (pace > 0))
+            wait_ms(pace);
     }
     return (len - cnt);
 }
@@ -1073,18 +1764,20 @@ int MDMParser::socketRecv(int socket, char* buf, int len)
     Timer timer;
     timer.start();
     while (len) {
-        int blk = MAX_SIZE; // still need space for headers and unsolicited  commands 
-        if (len < blk) blk = len;
+        int blk = 0;
         bool ok = false;        
         LOCK();
+        blk = _chunkRx(socket);
+        if (len < blk) blk = len;
         if (ISSOCKET(socket)) {
             if (_sockets[socket].state == SOCK_CONNECTED) {
                 if (_sockets[socket].pending < blk)
                     blk = _sockets[socket].pending;
                 if (blk > 0) {
-                    sendFormated("AT+USORD=%d,%d\r\n",socket, blk);
+                    sendCmd(AtCmd("AT+USORD=").num(socket).str(",").num(blk).end());
                     if (RESP_OK == waitFinalResp(_cbUSORD, buf)) {
                         _sockets[socket].pending -= blk;
+                        _metrics.rxBytes[socket] += blk;
                         len -= blk;
                         cnt += blk;
                         buf += blk;
@@ -1133,6 +1826,7 @@ int MDMParser::socketRecvFrom(int socket, IP* ip, int* port, char* buf, int len)
     Timer timer;
     timer.start();
     while (len) {
+        // a datagram is read at once, it is not chunked
         int blk = MAX_SIZE; // still need space for headers and unsolicited commands 
         if (len < blk) blk = len;
         bool ok = false;        
@@ -1141,11 +1835,12 @@ int MDMParser::socketRecvFrom(int socket, IP* ip, int* port, char* buf, int len)
             if (_sockets[socket].pending < blk)
                 blk = _sockets[socket].pending;
             if (blk > 0) {
-                sendFormated("AT+USORF=%d,%d\r\n",socket, blk);
+                sendCmd(AtCmd("AT+USORF=").num(socket).str(",").num(blk).end());
                 USORFparam param;
                 param.buf = buf;
                 if (RESP_OK == waitFinalResp(_cbUSORF, &param)) {
                     _sockets[socket].pending -= blk;
+                    _metrics.rxBytes[socket] += blk;
                     *ip = param.ip;
                     *port = param.port;
                     len -= blk;
@@ -1172,6 +1867,61 @@ int MDMParser::socketRecvFrom(int socket, IP* ip, int* port, char* buf, int len)
 
 // ----------------------------------------------------------------
 
+bool MDMParser::secImportCert(SecCert type, const char* name, const char* buf, int len)
+{
+    bool ok = false;
+    LOCK();
+    sendFormated("AT+USECMNG=0,%d,\"%s\",%d\r\n", type, name, len);
+    if (RESP_PROMPT == waitFinalResp()) {
+        send(buf, len);
+        ok = (RESP_OK == waitFinalResp());
+    }
+    UNLOCK();
+    return ok;
+}
+
+bool MDMParser::secRemoveCert(SecCert type, const char* name)
+{
+    bool ok = false;
+    LOCK();
+    sendFormated("AT+USECMNG=2,%d,\"%s\"\r\n", type, name);
+    ok = (RESP_OK == waitFinalResp());
+    UNLOCK();
+    return ok;
+}
+
+bool MDMParser::secSetProfile(int profile, SecVerify verify /*= SEC_VERIFY_NONE*/, 
+                              const char* rootCa /*= NULL*/, const char* clientCert /*= NULL*/, 
+                              const char* clientKey /*= NULL*/, const char* sni /*= NULL*/)
+{
+    // USECPRF string operations: 3 root ca, 5 client cert, 6 client key, 10 sni 
+    const struct { int op; const char* str; } ops[] = {
+        { 3, rootCa }, { 5, clientCert }, { 6, clientKey }, { 10, sni } 
+    };
+    LOCK();
+    // reset the profile
+    sendFormated("AT+USECPRF=%d\r\n", profile);
+    if (RESP_OK != waitFinalResp())
+        goto failure;
+    sendFormated("AT+USECPRF=%d,0,%d\r\n", profile, verify);
+    if (RESP_OK != waitFinalResp())
+        goto failure;
+    for (int i = 0; i < (int)(sizeof(ops)/sizeof(*ops)); i ++) {
+        if (!ops[i].str)
+            continue;
+        sendFormated("AT+USECPRF=%d,%d,\"%s\"\r\n", profile, ops[i].op, ops[i].str);
+        if (RESP_OK != waitFinalResp())
+            goto failure;
+    }
+    UNLOCK();
+    return true;
+failure:
+    unlock();
+    return false;
+}
+
+// ----------------------------------------------------------------
+
 int MDMParser::_cbCMGL(int type, const char* buf, int len, CMGLparam* param)
 { 
     if ((type == TYPE_PLUS) && param && param->num) {
@@ -1199,6 +1949,56 @@ int MDMParser::smsList(const char* stat /*= "ALL"*/, int* ix /*=NULL*/, int num
     return ret;
 }
 
+int MDMParser::_cbCMGLALL(int type, const char* buf, int len, CMGLALLparam* param)
+{
+    // deliver a pending message without content first 
+    if ((param->ix >= 0) && (type != TYPE_UNKNOWN)) {
+        param->cb(param->param, param->ix, param->num, param->time, "", 0);
+        param->ix = -1;
+    }
+    if (type == TYPE_PLUS) {
+        // +CMGL: <ix>,<stat>,<oa>,[<alpha>],[<scts>]
+        int ix;
+        if (sscanf(buf, "\r\n+CMGL: %d,\"%*[^\"]\",\"%31[^\"]\"", &ix, param->num) == 2) {
+            // the time stamp is the last quoted field, the alpha may be empty
+            const char* e = buf + len;
+            while ((e > buf) && (e[-1] != '\"')) e --;
+            const char* b = (e > buf) ? e - 1 : buf;
+            while ((b > buf) && (b[-1] != '\"')) b --;
+            int n = (e > b) ? e - 1 - b : 0;
+            if ((n < 8) || (n >= (int)sizeof(param->time)) || (b[2] != '/'))
+                n = 0; // no time stamp 
+            memcpy(param->time, b, n);
+            param->time[n] = '\0';
+            param->ix = ix;
+            param->cnt ++;
+        }
+    } else if ((type == TYPE_UNKNOWN) && (param->ix >= 0)) {
+        // the content, without the trailing line feed 
+        if ((len >= 2) && (buf[len-2] == '\r') && (buf[len-1] == '\n'))
+            len -= 2;
+        param->cb(param->param, param->ix, param->num, param->time, buf, len);
+        param->ix = -1;
+    }
+    return WAIT;
+}
+
+int MDMParser::smsReadAll(const char* stat, _SMSCB cb, void* param /*= NULL*/)
+{
+    int ret = -1;
+    LOCK();
+    CMGLALLparam all;
+    all.cb = cb;
+    all.param = param;
+    all.ix = -1;
+    all.cnt = 0;
+    sendFormated("AT+CMGL=\"%s\"\r\n", stat);
+    if (RESP_OK == waitFinalResp(_cbCMGLALL, &all))
+        ret = all.cnt;
+    UNLOCK();
+    return ret;
+}
+
 bool MDMParser::smsSend(const char* num, const char* buf)
 {
     bool ok = false;
@@ -1214,6 +2014,102 @@ bool MDMParser::smsSend(const char* num, const char* buf)
     return ok;
 }
 
+int MDMParser::_sendHex(const void* buf, int len)
+{
+    static const char hex[] = "0123456789ABCDEF";
+    const unsigned char* p = (const unsigned char*)buf;
+    char tmp[64];
+    int cnt = 0;
+    while (len) {
+        int n = 0;
+        for ( ; len && (n < (int)sizeof(tmp)); len --, p ++) {
+            tmp[n++] = hex[*p >> 4];
+            tmp[n++] = hex[*p & 0xF];
+        }
+        cnt += send(tmp, n);
+    }
+    return cnt;
+}
+
+int MDMParser::smsSendBinary(const char* num, const void* buf, int len)
+{
+    const int maxSingle = 140;           // user data of a single message 
+    const int maxSegment = 140 - 6;      // leave space for the concatenation header
+    const unsigned char* data = (const unsigned char*)buf;
+    int segs = (len <= maxSingle) ? 1 : (len + maxSegment - 1) / maxSegment;
+    if ((segs > 255) || (_dev.dev == DEV_LISA_C200))
+        return -1;
+    // destination address: number of digits, type and swapped bcd digits
+    unsigned char da[2 + 10];
+    int digits = 0;
+    da[1] = (*num == '+') ? 0x91/*international*/ : 0x81/*unknown*/;
+    if (*num == '+') num ++;
+    for ( ; *num && (digits < 20); num ++) {
+        if ((*num < '0') || (*num > '9'))
+            continue;
+        unsigned char d = *num - '0';
+        if (digits & 1) da[2 + digits/2] = (da[2 + digits/2] & 0x0F) | (d << 4);
+        else            da[2 + digits/2] = 0xF0 | d;
+        digits ++;
+    }
+    da[0] = digits;
+    int daLen = 2 + (digits + 1) / 2;
+    unsigned char ref = ++_smsRef;
+    int ret = -1;
+    LOCK();
+    sendFormated("AT+CMGF=0\r\n");
+    if (RESP_OK != waitFinalResp())
+        goto failure;
+    for (int seq = 1; seq <= segs; seq ++) {
+        int n = (segs == 1) ? len : ((len > maxSegment) ? maxSegment : len);
+        // SMS-SUBMIT header: first octet (UDHI if concatenated), message reference
+        unsigned char head[2 + sizeof(da) + 3 + 6];
+        int h = 0;
+        head[h++] = (segs == 1) ? 0x01 : 0x41;
+        head[h++] = 0x00;
+        memcpy(&head[h], da, daLen);
+        h += daLen;
+        head[h++] = 0x00; // protocol identifier
+        head[h++] = 0x04; // data coding scheme: 8-bit data
+        if (segs == 1) 
+            head[h++] = n;
+        else {
+            head[h++] = 6 + n;
+            // concatenation header: iei 0, length 3, reference, total, sequence
+            head[h++] = 0x05; 
+            head[h++] = 0x00; 
+            head[h++] = 0x03; 
+            head[h++] = ref; 
+            head[h++] = segs; 
+            head[h++] = seq;
+        }
+        // the length excludes the (empty) service centre address 
+        sendFormated("AT+CMGS=%d\r\n", h + n);
+        if (RESP_PROMPT != waitFinalResp(NULL,NULL,150*1000))
+            break;
+        send("00", 2);
+        _sendHex(head, h);
+        _sendHex(data, n);
+        const char ctrlZ = 0x1A;
+        send(&ctrlZ, sizeof(ctrlZ));
+        if (RESP_OK != waitFinalResp(NULL,NULL,150*1000))
+            break;
+        data += n;
+        len -= n;
+        ret = seq;
+    }
+    // back to text mode
+    sendFormated("AT+CMGF=1\r\n");
+    waitFinalResp();
+    if (ret != segs)
+        ret = -1;
+    UNLOCK();
+    return ret;
+failure:
+    unlock();
+    return -1;
+}
+
 bool MDMParser::smsDelete(int ix)
 {
     bool ok = false;
@@ -1224,6 +2120,16 @@ bool MDMParser::smsDelete(int ix)
     return ok;
 }
 
+bool MDMParser::smsDeleteAll(int flag /*= 3*/)
+{
+    bool ok = false;
+    LOCK();
+    sendFormated("AT+CMGD=1,%d\r\n",flag);
+    ok = (RESP_OK == waitFinalResp(NULL,NULL,55*1000));
+    UNLOCK();
+    return ok;
+}
+
 int MDMParser::_cbCMGR(int type, const char* buf, int len, CMGRparam* param)
 {
     if (param) {
@@ -1291,15 +2197,31 @@ bool MDMParser::delFile(const char* filename)
 
 int MDMParser::writeFile(const char* filename, const char* buf, int len)
 {
-    bool ok = false;
-    LOCK();
-    sendFormated("AT+UDWNFILE=\"%s\",%d\r\n", filename, len);
-    if (RESP_PROMPT == waitFinalResp()) {
-        send(buf, len);
-        ok = (RESP_OK == waitFinalResp());
+    return appendFile(filename, buf, len);
+}
+
+int MDMParser::appendFile(const char* filename, const char* buf, int len)
+{
+    int cnt = len;
+    // the module appends if the file exists, so large data is written in chunks
+    while (cnt > 0) {
+        int blk = FILE_MAX_WRITE;
+        if (cnt < blk) 
+            blk = cnt;
+        bool ok = false;
+        LOCK();
+        sendFormated("AT+UDWNFILE=\"%s\",%d\r\n", filename, blk);
+        if (RESP_PROMPT == waitFinalResp()) {
+            send(buf, blk);
+            ok = (RESP_OK == waitFinalResp());
+        }
+        UNLOCK();
+        if (!ok) 
+            return -1;
+        buf += blk;
+        cnt -= blk;
     }
-    UNLOCK();
-    return ok ? len : -1;
+    return (len - cnt);
 }
 
 int MDMParser::readFile(const char* filename, char* buf, int len)
@@ -1311,7 +2233,7 @@ int MDMParser::readFile(const char* filename, char* buf, int len)
     param.len = 0;
     LOCK();
     sendFormated("AT+URDFILE=\"%s\"\r\n", filename, len);
-    if (RESP_OK != waitFinalResp(_cbURDFILE, &param));
+    if (RESP_OK != waitFinalResp(_cbURDFILE, &param))
         param.len = -1;
     UNLOCK();
     return param.len;
@@ -1331,6 +2253,278 @@ int MDMParser::_cbURDFILE(int type, const char* buf, int len, URDFILEparam* para
     }
     return WAIT;
 }
+
+int MDMParser::_cbURDBLOCK(int type, const char* buf, int len, URDFILEparam* param)
+{
+    if ((type == TYPE_PLUS) && param && param->filename && param->buf) {
+        char filename[48];
+        int sz;
+        if ((sscanf(buf, "\r\n+URDBLOCK: \"%47[^\"]\",%d,", filename, &sz) == 2) && 
+            (0 == strcmp(param->filename, filename)) &&
+            (buf[len-sz-2] == '\"') && (buf[len-1] == '\"')) {
+            param->len = (sz < param->sz) ? sz : param->sz;
+            memcpy(param->buf, &buf[len-1-sz], param->len);
+        }
+    }
+    return WAIT;
+}
+
+int MDMParser::readFileBlock(const char* filename, int offset, char* buf, int len)
+{
+    // the block and its framing has to fit the line buffer of waitFinalResp
+    int max = MAX_SIZE + 64 - 32 - strlen(filename);
+    if (max > MAX_SIZE) max = MAX_SIZE;
+    if (max <= 0) 
+        return -1;
+    int cnt = 0;
+    while (len) {
+        int blk = (len < max) ? len : max;
+        URDFILEparam param;
+        param.filename = filename;
+        param.buf = buf; 
+        param.sz = blk; 
+        param.len = 0;
+        bool ok = false;
+        LOCK();
+        sendFormated("AT+URDBLOCK=\"%s\",%d,%d\r\n", filename, offset, blk);
+        ok = (RESP_OK == waitFinalResp(_cbURDBLOCK, &param));
+        UNLOCK();
+        if (!ok)
+            return (cnt > 0) ? cnt : -1;
+        cnt += param.len;
+        buf += param.len;
+        offset += param.len;
+        len -= param.len;
+        // a short block is the end of the file
+        if (param.len < blk)
+            break;
+    }
+    return cnt;
+}
+
+int MDMParser::fileSize(const char* filename)
+{
+    int size = -1;
+    LOCK();
+    sendFormated("AT+ULSTFILE=2,\"%s\"\r\n", filename);
+    if (RESP_OK != waitFinalResp(_cbULSTFILE, &size))
+        size = -1;
+    UNLOCK();
+    return size;
+}
+
+int MDMParser::_cbULSTFILE(int type, const char* buf, int len, int* size)
+{
+    if ((type == TYPE_PLUS) && size) {
+        if (sscanf(buf, "\r\n+ULSTFILE: %d", size) == 1)
+            /*nothing*/;
+    }
+    return WAIT;
+}
+
+// ----------------------------------------------------------------
+
+bool MDMParser::httpSetProfile(int profile, const char* server, int port /*= 80*/, 
+                               bool secure /*= false*/, const char* username /*= NULL*/, 
+                               const char* password /*= NULL*/)
+{
+    if ((profile < 0) || (profile >= NUM_HTTP) || !server)
+        return false;
+    // a numeric server is set as ip address (op 0) otherwise as name (op 1)
+    int a, b, c, d;
+    bool isIp = (sscanf(server, IPSTR, &a, &b, &c, &d) == 4);
+    LOCK();
+    // reset the profile
+    sendFormated("AT+UHTTP=%d\r\n", profile);
+    if (RESP_OK != waitFinalResp())
+        goto failure;
+    sendFormated("AT+UHTTP=%d,%d,\"%s\"\r\n", profile, isIp ? 0 : 1, server);
+    if (RESP_OK != waitFinalResp())
+        goto failure;
+    if (username && password) {
+        sendFormated("AT+UHTTP=%d,2,\"%s\"\r\n", profile, username);
+        if (RESP_OK != waitFinalResp())
+            goto failure;
+        sendFormated("AT+UHTTP=%d,3,\"%s\"\r\n", profile, password);
+        if (RESP_OK != waitFinalResp())
+            goto failure;
+        // basic authentication
+        sendFormated("AT+UHTTP=%d,4,1\r\n", profile);
+        if (RESP_OK != waitFinalResp())
+            goto failure;
+    }
+    sendFormated("AT+UHTTP=%d,5,%d\r\n", profile, port);
+    if (RESP_OK != waitFinalResp())
+        goto failure;
+    if (secure) {
+        sendFormated("AT+UHTTP=%d,6,1\r\n", profile);
+        if (RESP_OK != waitFinalResp())
+            goto failure;
+    }
+    _http[profile] = HTTP_IDLE;
+    UNLOCK();
+    return true;
+failure:
+    unlock();
+    return false;
+}
+
+bool MDMParser::httpCommand(int profile, HttpCmd cmd, const char* path, const char* respFile, 
+                            const char* param /*= NULL*/, HttpContent content /*= HTTP_TEXT*/)
+{
+    bool ok = false;
+    if ((profile < 0) || (profile >= NUM_HTTP) || !path || !respFile)
+        return false;
+    LOCK();
+    _http[profile] = HTTP_PENDING;
+    if ((cmd == HTTP_POST_FILE) || (cmd == HTTP_POST_DATA)) {
+        sendFormated("AT+UHTTPC=%d,%d,\"%s\",\"%s\",\"%s\",%d\r\n", 
+                     profile, cmd, path, respFile, param ? param : "", content);
+    } else if (cmd == HTTP_PUT) {
+        // PUT has no content type
+        sendFormated("AT+UHTTPC=%d,%d,\"%s\",\"%s\",\"%s\"\r\n", 
+                     profile, cmd, path, respFile, param ? param : "");
+    } else {
+        sendFormated("AT+UHTTPC=%d,%d,\"%s\",\"%s\"\r\n", profile, cmd, path, respFile);
+    }
+    ok = (RESP_OK == waitFinalResp());
+    if (!ok) 
+        _http[profile] = HTTP_IDLE;
+    UNLOCK();
+    return ok;
+}
+
+MDMParser::HttpState MDMParser::httpWait(int profile, int timeout_ms /*= 0*/)
+{
+    if ((profile < 0) || (profile >= NUM_HTTP))
+        return HTTP_FAILED;
+    Timer timer;
+    timer.start();
+    for (;;) {
+        // the completion is signaled by an urc
+        LOCK();
+        waitFinalResp(NULL, NULL, 0);
+        UNLOCK();
+        if ((_http[profile] != HTTP_PENDING) || (timeout_ms == 0) || 
+            TIMEOUT(timer, timeout_ms))
+            break;
+        wait_ms(100);
+    }
+    return _http[profile];
+}
+
+int MDMParser::_httpRequest(int profile, HttpCmd cmd, const char* path, const char* respFile, 
+                            const char* param, HttpContent content, int timeout_ms)
+{
+    if (!httpCommand(profile, cmd, path, respFile, param, content))
+        return -1;
+    HttpState state = httpWait(profile, timeout_ms);
+    if (state != HTTP_DONE) {
+        if (state == HTTP_PENDING)
+            ERROR("HTTP %d: timeout\r\n", profile);
+        return -1;
+    }
+    _http[profile] = HTTP_IDLE;
+    return fileSize(respFile);
+}
+
+int MDMParser::httpGet(int profile, const char* path, const char* respFile, 
+                       int timeout_ms /*= 180000*/)
+{
+    return _httpRequest(profile, HTTP_GET, path, respFile, NULL, HTTP_TEXT, timeout_ms);
+}
+
+int MDMParser::httpPost(int profile, const char* path, const char* respFile, 
+                        const char* buf, int len, HttpContent content /*= HTTP_OCTET*/, 
+                        int timeout_ms /*= 180000*/)
+{
+    // the module appends to existing files, so start with an empty one
+    delFile(HTTP_REQ_FILE);
+    if (appendFile(HTTP_REQ_FILE, buf, len) != len)
+        return -1;
+    int ret = _httpRequest(profile, HTTP_POST_FILE, path, respFile, 
+                           HTTP_REQ_FILE, content, timeout_ms);
+    delFile(HTTP_REQ_FILE);
+    return ret;
+}
+
+// ----------------------------------------------------------------
+
+bool MDMParser::cellLocSrvHttp(const char* token, 
+                               const char* server1 /*= "cell-live1.services.u-blox.com"*/, 
+                               const char* server2 /*= "cell-live2.services.u-blox.com"*/)
+{
+    bool ok = false;
+    LOCK();
+    sendFormated("AT+UGSRV=\"%s\",\"%s\",\"%s\"\r\n", server1, server2, token);
+    ok = (RESP_OK == waitFinalResp());
+    UNLOCK();
+    return ok;
+}
+
+bool MDMParser::cellLocSrvUdp(const char* server /*= "cell-live1.services.u-blox.com"*/, 
+                              int port /*= 46434*/, int latency /*= 1000*/, int mode /*= 0*/)
+{
+    bool ok = false;
+    LOCK();
+    sendFormated("AT+UGAOP=\"%s\",%d,%d,%d\r\n", server, port, latency, mode);
+    ok = (RESP_OK == waitFinalResp());
+    UNLOCK();
+    return ok;
+}
+
+bool MDMParser::cellLocConfigSensor(int scanMode)
+{
+    bool ok = false;
+    LOCK();
+    sendFormated("AT+ULOCCELL=%d\r\n", scanMode);
+    ok = (RESP_OK == waitFinalResp());
+    UNLOCK();
+    return ok;
+}
+
+bool MDMParser::cellUnsolIndication(int mode)
+{
+    bool ok = false;
+    LOCK();
+    sendFormated("AT+ULOCIND=%d\r\n", mode);
+    ok = (RESP_OK == waitFinalResp());
+    UNLOCK();
+    return ok;
+}
+
+bool MDMParser::cellLocRequest(int sensor, int timeout_s, int accuracy_m, bool detailed /*= true*/)
+{
+    bool ok = false;
+    if (timeout_s < 1)   timeout_s = 1;
+    if (timeout_s > 999) timeout_s = 999;
+    LOCK();
+    _locDone = false;
+    // single shot (mode 2), the result follows with +UULOC
+    sendFormated("AT+ULOC=2,%d,%d,%d,%d\r\n", sensor, detailed ? 1 : 0, timeout_s, accuracy_m);
+    if (RESP_OK == waitFinalResp()) {
+        _locTimer.reset();
+        _locTimer.start();
+        ok = true;
+    }
+    UNLOCK();
+    return ok;
+}
+
+bool MDMParser::cellLocGetData(CellLocData* data)
+{
+    bool ok = false;
+    LOCK();
+    if (!_locDone)
+        waitFinalResp(NULL, NULL, 0);
+    if (_locDone) {
+        *data = _loc;
+        _locDone = false;
+        ok = true;
+    }
+    UNLOCK();
+    return ok;
+}
   
 // ----------------------------------------------------------------
 bool MDMParser::setDebug(int level) 
@@ -1338,12 +2532,176 @@ bool MDMParser::setDebug(int level)
 #ifdef MDM_DEBUG
     if ((_debugLevel >= 0) && (level >= 0)) {
         _debugLevel = level;
+        // the AT commands are traced to the ring, not printed while running
+        if ((level >= 3) && !_script)
+            setTranscript(TRACE_SIZE);
         return true;
     }
 #endif
     return false;
 }
 
+bool MDMParser::setTranscript(int size, int cap /*= TRACE_CAP*/)
+{
+    LOCK();
+    if (_script)
+        delete _script;
+    _script = (size > 0) ? new Pipe<char>(size) : NULL;
+    _scriptCap = cap;
+    _scriptLost = 0;
+    UNLOCK();
+    return true;
+}
+
+int MDMParser::getTranscript(char* buf, int len)
+{
+    int n = 0;
+    LOCK();
+    // whole records only, the ring is parsed record by record
+    while (_script && (_script->size() >= TRACE_HEAD)) {
+        char h[TRACE_HEAD];
+        _script->set(0);
+        for (int i = 0; i < (int)sizeof(h); i ++)
+            h[i] = _script->next();
+        int rec = sizeof(h) + ((h[8] & 0xFF) | ((h[9] & 0xFF) << 8));
+        if (rec > len - n)
+            break;
+        n += _script->get(buf + n, rec);
+    }
+    UNLOCK();
+    return n;
+}
+
+void MDMParser::getMetrics(Metrics* metrics, bool reset /*= false*/)
+{
+    LOCK();
+    memcpy(metrics, &_metrics, sizeof(_metrics));
+    if (reset)
+        memset(&_metrics, 0, sizeof(_metrics));
+    UNLOCK();
+}
+
+void MDMParser::_metricsStart(const char* buf)
+{
+    static const struct { const char* name; CmdClass cls; } lut[] = {
+        { "USOWR",  CMD_USOWR  }, { "USOST",   CMD_USOST  }, 
+        { "USORD",  CMD_USORD  }, { "USORF",   CMD_USORF  }, 
+        { "USOCR",  CMD_USOCR  }, { "USOCO",   CMD_USOCO  }, 
+        { "USOCL",  CMD_USOCL  }, { "UDNSRN",  CMD_UDNSRN }, 
+        { "UPSDA",  CMD_UPSDA  }, { "UPSND",   CMD_UPSND  }, 
+        { "UPSD",   CMD_UPSD   }, { "CREG",    CMD_REG    }, 
+        { "CGREG",  CMD_REG    }, { "CSQ",     CMD_CSQ    }, 
+        { "COPS",   CMD_COPS   }, { "CMG",     CMD_SMS    }, 
+        { "URDFILE",CMD_FILE   }, { "UDWNFILE",CMD_FILE   }, 
+        { "UDELFILE",CMD_FILE  }, { "URDBLOCK",CMD_FILE   }, 
+        { "ULSTFILE",CMD_FILE  }, { "UHTTP",   CMD_HTTP   }, 
+        { "USOSEC", CMD_SEC    }, { "USEC",    CMD_SEC    },
+    };
+    int cls = CMD_OTHER;
+    // AT+<name>... the first character rejects most entries
+    if ((buf[0] == 'A') && (buf[1] == 'T') && (buf[2] == '+')) {
+        const char* cmd = buf + 3;
+        for (int i = 0; i < (int)(sizeof(lut)/sizeof(*lut)); i ++) {
+            if ((lut[i].name[0] == cmd[0]) && 
+                (strncmp(lut[i].name, cmd, strlen(lut[i].name)) == 0)) {
+                cls = lut[i].cls;
+                break;
+            }
+        }
+    }
+    _cmdClass = cls;
+    _cmdStart = us_ticker_read();
+}
+
+void MDMParser::_metricsStop(int ret)
+{
+    static const unsigned int bounds[NUM_LAT-1] = { 10, 20, 50, 100, 200, 500, 1000, 2000, 5000 };
+    if (_cmdClass < 0)
+        return;
+    CmdMetrics* m = &_metrics.cmd[_cmdClass];
+    unsigned int ms = (us_ticker_read() - _cmdStart) / 1000;
+    int b = 0;
+    while ((b < NUM_LAT-1) && (ms >= bounds[b]))
+        b ++;
+    m->count ++;
+    m->hist[b] ++;
+    m->totalMs += ms;
+    if (ms > m->maxMs)
+        m->maxMs = ms;
+    if (ret == RESP_ERROR)  m->errors ++;
+    else if (ret == WAIT)   m->timeouts ++;
+    _cmdClass = -1;
+}
+
+void MDMParser::_transcript(char dir, int type, const char* buf, int len)
+{
+    uint32_t t = us_ticker_read();
+    int n = ((_scriptCap > 0) && (len > _scriptCap)) ? _scriptCap : len;
+    char head[TRACE_HEAD] = { dir, (char)type, 
+                     (char)(t >> 0), (char)(t >> 8), (char)(t >> 16), (char)(t >> 24), 
+                     (char)(len >> 0), (char)(len >> 8), (char)(n >> 0), (char)(n >> 8) };
+    int need = (int)sizeof(head) + n;
+    if (need > _script->size() + _script->free()) {
+        _scriptLost ++;
+        return;
+    }
+    // the latest records matter most after a fault, drop the oldest ones
+    while (_script->free() < need) {
+        char h[TRACE_HEAD];
+        _script->set(0);
+        for (int i = 0; i < (int)sizeof(h); i ++)
+            h[i] = _script->next();
+        _script->set(sizeof(h) + ((h[8] & 0xFF) | ((h[9] & 0xFF) << 8)));
+        _script->done();
+        _scriptLost ++;
+    }
+    _script->put(head, sizeof(head));
+    _script->put(buf, n);
+}
+
+void MDMParser::dumpTranscript(_DPRINT dprint /*= (_DPRINT)fprintf*/, void* param /*= (void*)stdout*/)
+{
+    char head[TRACE_HEAD];
+    LOCK();
+    if (_script && _scriptLost)
+        dprint(param, YEL "%d records lost" DEF "\r\n", _scriptLost);
+    _scriptLost = 0;
+    while (_script && (_script->get(head, sizeof(head)) == (int)sizeof(head))) {
+        uint32_t t = (head[2] & 0xFF) | ((head[3] & 0xFF) << 8) | 
+                     ((head[4] & 0xFF) << 16) | ((uint32_t)(head[5] & 0xFF) << 24);
+        int len = (head[6] & 0xFF) | ((head[7] & 0xFF) << 8);
+        int cap = (head[8] & 0xFF) | ((head[9] & 0xFF) << 8);
+        int type = (head[1] & 0xFF) << 16;
+        const char* s = (head[0] == '>')      ? "send    " : 
+                        (type == TYPE_UNKNOWN)? "read " YEL "UNK" DEF : 
+                        (type == TYPE_TEXT)   ? "read " MAG "TXT" DEF : 
+                        (type == TYPE_OK   )  ? "read " GRE "OK " DEF : 
+                        (type == TYPE_ERROR)  ? "read " RED "ERR" DEF : 
+                        (type == TYPE_PLUS)   ? "read " CYA " + " DEF : 
+                        (type == TYPE_PROMPT) ? "read " BLU " > " DEF : 
+                                                "read ..." ;
+        dprint(param, "%10.3f AT %s %3d \"", t * 0.000001, s, len);
+        // escape the payload, printed in pieces to keep the stack small
+        for (int n = cap; n > 0; ) {
+            char ch, out[4*16+1];
+            int o = 0;
+            for (int i = 0; (i < 16) && (n > 0); i ++, n --) {
+                _script->get(&ch, 1);
+                if      (ch == '"')  o += sprintf(&out[o], "\\\"");
+                else if (ch == '\\') o += sprintf(&out[o], "\\\\");
+                else if (ch == '\r') o += sprintf(&out[o], "\\r");
+                else if (ch == '\n') o += sprintf(&out[o], "\\n");
+                else if ((ch > 0x1F) && (ch != 0x7F)) out[o++] = ch; // is printable
+                else o += sprintf(&out[o], "\\x%02x", (unsigned char)ch);
+            }
+            out[o] = '\0';
+            dprint(param, "%s", out);
+        }
+        dprint(param, (len > cap) ? "\"...\r\n" : "\"\r\n");
+    }
+    UNLOCK();
+}
+
 void MDMParser::dumpDevStatus(MDMParser::DevStatus* status, 
             _DPRINT dprint, void* param) 
 {
@@ -1405,6 +2763,33 @@ void MDMParser::dumpIp(MDMParser::IP ip,
     if (ip != NOIP)
         dprint(param, "Modem:IP " IPSTR "\r\n", IPNUM(ip));
 }
+
+void MDMParser::dumpMetrics(MDMParser::Metrics* metrics, 
+            _DPRINT dprint, void* param) 
+{
+    const char* txtCmd[] = { "OTHER", "USOWR", "USOST", "USORD", "USORF", 
+                             "USOCR", "USOCO", "USOCL", "UDNSRN", "UPSDA", 
+                             "UPSND", "UPSD", "CREG", "CSQ", "COPS", "SMS", "FILE", 
+                             "HTTP", "SEC" };
+    dprint(param, "Modem::metrics\r\n");
+    dprint(param, "  Command   count  err  tmo  avg ms  max ms  <10 <20 <50 <100 <200 <500 <1s <2s <5s >5s\r\n");
+    for (int i = 0; i < NUM_CMD; i ++) {
+        CmdMetrics* m = &metrics->cmd[i];
+        if (m->count == 0)
+            continue;
+        dprint(param, "  %-8s %6u %4u %4u %7u %7u ", txtCmd[i], m->count, 
+            m->errors, m->timeouts, m->totalMs / m->count, m->maxMs);
+        for (int b = 0; b < NUM_LAT; b ++)
+            dprint(param, " %3u", m->hist[b]);
+        dprint(param, "\r\n");
+    }
+    dprint(param, "  URCs: %u\r\n", metrics->urcs);
+    for (int i = 0; i < NUM_SOCKETS; i ++) {
+        if (metrics->txBytes[i] || metrics->rxBytes[i])
+            dprint(param, "  Socket %d: %u bytes sent, %u bytes received\r\n", 
+                i, metrics->txBytes[i], metrics->rxBytes[i]);
+    }
+}
     
 // ----------------------------------------------------------------
 int MDMParser::_parseMatch(Pipe<char>* pipe, int len, const char* sta, const char* end)
@@ -1491,6 +2876,7 @@ int MDMParser::_getLine(Pipe<char>* pipe, char* buf, int len)
             { "\r\n+USORD: %d,%d,\"%c\"",                   TYPE_PLUS       },
             { "\r\n+USORF: %d,\"" IPSTR "\",%d,%d,\"%c\"",  TYPE_PLUS       },
             { "\r\n+URDFILE: %s,%d,\"%c\"",                 TYPE_PLUS       },
+            { "\r\n+URDBLOCK: %s,%d,\"%c\"",                TYPE_PLUS       },
         };
         static struct { 
               const char* sta;          const char* end;    int type; 
@@ -1582,13 +2968,15 @@ MDMSerial::MDMSerial(PinName tx /*= MDMTXD*/, PinName rx /*= MDMRXD*/,
        c027_mdm_powerOn(false);
 #endif
     baud(baudrate);
+    _linkBaud = baudrate;
 #if DEVICE_SERIAL_FC
+    _cts = (cts != NC);
     if ((rts != NC) || (cts != NC))
     {
         Flow flow = (cts == NC) ? RTS :
                     (rts == NC) ? CTS : RTSCTS ;
-        set_flow_control(flow, rts, cts);
-        if (cts != NC) _dev.lpm = LPM_ENABLED;
+        // for CTS only the pin is passed as the first flow pin 
+        set_flow_control(flow, (flow == CTS) ? cts : rts, cts);
     }
 #endif
 }
@@ -1612,6 +3000,41 @@ int MDMSerial::getLine(char* buffer, int length)
     return _getLine(&_pipeRx, buffer, length);
 }
 
+void MDMSerial::_setBaudrate(int baudrate)
+{
+    baud(baudrate);
+}
+
+bool MDMSerial::_powerSaving(Psv psv, PinName dtr)
+{
+    if (psv == PSV_OFF) 
+        setTxWakeup(0);
+    else if (psv == PSV_DTR) {
+        if (dtr == NC)
+            return false;
+        setTxWakeup(PSV_IDLE_US, PSV_WAKE_US, EOF, dtr);
+    }
+#if DEVICE_SERIAL_FC
+    else if (_cts)
+        // the uart holds the data back until the module is awake
+        setTxWakeup(PSV_IDLE_US);
+#endif
+    else 
+        setTxWakeup(PSV_IDLE_US, PSV_WAKE_US, PSV_PREAMBLE);
+    return true;
+}
+
+void MDMSerial::_powerStats(PowerStats* stats)
+{
+    WakeStats ws;
+    getWakeStats(&ws);
+    stats->wakeups   = ws.wakeups;
+    stats->wakeUs    = ws.wakeUs;
+    stats->maxWakeUs = ws.maxWakeUs;
+    stats->awakeMs   = ws.awakeMs;
+    stats->sleepMs   = ws.sleepMs;
+}
+
 // ----------------------------------------------------------------
 // USB Implementation 
 // ----------------------------------------------------------------
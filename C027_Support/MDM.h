@@ -37,6 +37,41 @@ public:
     typedef enum { SIM_UNKNOWN, SIM_MISSING, SIM_PIN, SIM_READY } Sim;
     //! SIM Status
     typedef enum { LPM_DISABLED, LPM_ENABLED, LPM_ACTIVE } Lpm; 
+    //! UART power saving modes (AT+UPSV)
+    typedef enum { PSV_OFF = 0, PSV_CYCLIC = 1, PSV_DTR = 3 } Psv;
+    //! Power saving statistics
+    typedef struct { 
+        Psv psv;                //!< Power saving mode in use
+        unsigned int wakeups;   //!< Number of wake ups by the driver
+        unsigned int wakeUs;    //!< Time from the last wake up to the first answer in us
+        unsigned int maxWakeUs; //!< Worst time from a wake up to the first answer in us
+        unsigned int awakeMs;   //!< Time the module was awake in ms
+        unsigned int sleepMs;   //!< Time the module was sleeping in ms
+        unsigned int chargeUAh; //!< Estimated charge drawn in uAh
+    } PowerStats;
+    //! Command classes of the metrics
+    typedef enum { CMD_OTHER, CMD_USOWR, CMD_USOST, CMD_USORD, CMD_USORF, 
+                   CMD_USOCR, CMD_USOCO, CMD_USOCL, CMD_UDNSRN, CMD_UPSDA, 
+                   CMD_UPSND, CMD_UPSD, CMD_REG, CMD_CSQ, CMD_COPS, CMD_SMS, 
+                   CMD_FILE, CMD_HTTP, CMD_SEC, NUM_CMD } CmdClass;
+    //! Latency histogram buckets: <10,<20,<50,<100,<200,<500,<1000,<2000,<5000,>=5000 ms
+    enum { NUM_LAT = 10, NUM_SOCKETS = 32 };
+    //! Metrics of a command class
+    typedef struct { 
+        unsigned int count;         //!< Number of commands 
+        unsigned int errors;        //!< Number of error responses
+        unsigned int timeouts;      //!< Number of commands without final response
+        unsigned int totalMs;       //!< Accumulated latency in ms
+        unsigned int maxMs;         //!< Worst latency in ms 
+        unsigned int hist[NUM_LAT]; //!< Latency histogram 
+    } CmdMetrics;
+    //! Modem metrics
+    typedef struct { 
+        CmdMetrics cmd[NUM_CMD];          //!< Per command class
+        unsigned int urcs;                //!< Unsolicited result codes received
+        unsigned int txBytes[NUM_SOCKETS];//!< Bytes sent per socket
+        unsigned int rxBytes[NUM_SOCKETS];//!< Bytes received per socket
+    } Metrics;
     //! Device status
     typedef struct { 
         Dev dev;            //!< Device Type
@@ -50,6 +85,14 @@ public:
         char model[16];     //!< Model Name (LISA-U200, LISA-C200 or SARA-G350)
         char ver[16];       //!< Software Version
     } DevStatus;
+    //! Timing of the last init, the phases in ms since the start, -1 if not reached
+    typedef struct { 
+        int pulses;         //!< Power on pulses given, 0 if the module was on
+        int onMs;           //!< The module answered
+        int idMs;           //!< The module was identified
+        int simMs;          //!< The SIM card was ready
+        int readyMs;        //!< The init was completed
+    } BootTiming;
     //! Registration Status
     typedef enum { REG_UNKNOWN, REG_DENIED, REG_NONE, REG_HOME, REG_ROAMING } Reg; 
     //! Access Technology
@@ -66,6 +109,28 @@ public:
         unsigned short lac;  //!< location area code in hexadecimal format (2 bytes in hex)
         unsigned int ci;     //!< Cell ID in hexadecimal format (2 to 4 bytes in hex)
     } NetStatus;
+    //! number of cells in a #CellSnapshot
+    enum { NUM_CELLS = 8 };
+    //! Serving or neighbour cell
+    typedef struct {
+        bool serving;   //!< the serving cell 
+        AcT act;        //!< Access Technology (ACT_GSM or ACT_UTRAN)
+        int mcc;        //!< mobile country code, -1 if unknown
+        int mnc;        //!< mobile network code, -1 if unknown
+        int lac;        //!< location area code, -1 if unknown
+        int ci;         //!< cell id, -1 if unknown
+        int psc;        //!< primary scrambling code (UTRAN), -1 if unknown
+        int freq;       //!< downlink frequency (UTRAN), -1 if unknown
+        int dbm;        //!< signal level in dBm (RxLev or RSCP)
+        int ecno;       //!< Ec/No in dB (UTRAN), 0 if unknown
+    } CellInfo;
+    //! Snapshot of the serving and the neighbour cells
+    typedef struct {
+        int num;                    //!< number of cells 
+        CellInfo cell[NUM_CELLS];   //!< the cells, the serving cell first
+        int age_ms;                 //!< age of the snapshot
+        int quality;                //!< link quality score 0 (none) .. 100 (excellent)
+    } CellSnapshot;
     //! An IP v4 address
     typedef uint32_t IP;
     #define NOIP ((MDMParser::IP)0) //!< No IP address
@@ -108,7 +173,28 @@ public:
     bool init(const char* simpin = NULL, DevStatus* status = NULL, 
                 PinName pn MDM_IF( = MDMPWRON, = PD_1), PinName r_pn MDM_IF( = MDMRESET, = PD_2));
 
-    /** register to the network 
+    /** Get the timing of the boot phases of the last init. The module 
+        is probed with short AT commands, so that it is used as soon as 
+        it answers. The module type is kept in RAM only: a later init of 
+        the same boot (e.g. a restart by the #LinkSupervisor) gives only 
+        the pulse of the module found before, the first init after a 
+        reset of the MCU gives all the pulses.
+        \param timing the structure to fill
+    */
+    void getBootTiming(BootTiming* timing) { *timing = _boot; }
+
+    /** Get a seed for random numbers that differs between the devices and 
+        between the boots, e.g. for srand. The identities of the module and 
+        the SIM are mixed with the microsecond timer, which depends on the 
+        varying boot and network timing. Call it after init.
+        \return the seed
+    */
+    unsigned int entropy(void);
+
+    /** register to the network, waits for the registration URCs and 
+        collects the operator, number and signal strength once done. 
+        The modem is locked for at most a second at a time while waiting,
+        so other threads can use it in between.
         \param status an optional structure to with network information 
         \param timeout_ms -1 blocking, else non blocking timeout in ms
         \return true if successful and connected to network, false otherwise
@@ -121,17 +207,64 @@ public:
     */
     bool checkNetStatus(NetStatus* status = NULL);
     
+    /** Get the serving and the neighbour cells with one request 
+        (AT+UCELLINFO?), the snapshot is cached. If the module does not 
+        report the cells only the serving cell is filled from AT+CSQ.
+        \param snap the snapshot to fill
+        \param maxAge_ms a cached snapshot up to this age is returned 
+               without asking the module
+        \return true if successful, false otherwise
+    */
+    bool cellInfo(CellSnapshot* snap, int maxAge_ms = 0);
+    
+    /** Get a link quality score of the serving cell, e.g. to defer large 
+        transfers until the signal is good. 
+        \param maxAge_ms the maximum age of the cached snapshot
+        \return the score 0 (no service) .. 100 (excellent), -1 if unknown
+    */
+    int linkQuality(int maxAge_ms = 60000);
+    
     /** Power off the MT, This function has to be called prior to 
         switching off the supply. 
         \return true if successfully, false otherwise
     */ 
     bool powerOff(void);
     
+    /** Raise the baudrate of the serial link after init. The rates up to 
+        the limit are tried in ascending order, each one is verified with 
+        an AT command and the last working rate is restored on failure. 
+        Hardware flow control (RTS/CTS) should be enabled for high rates.
+        \param baudrate the highest baudrate to try
+        \return the baudrate in use
+    */
+    int raiseBaudrate(int baudrate = 921600);
+    
+    /** Select the UART power saving mode of the module (AT+UPSV). In the 
+        cyclic mode the transmission is gated by CTS if flow control is 
+        used, otherwise the module is woken by a preamble character. In 
+        the DTR mode the module sleeps while the DTR pin is released. 
+        The wake up latency is hidden behind the transmit buffer. Power 
+        saving is not enabled by init, it is an opt-in of the application.
+        \param psv the power saving mode
+        \param dtr the DTR pin, required for PSV_DTR
+        \return true if successful, false otherwise
+    */
+    bool setPowerSaving(Psv psv, PinName dtr = NC);
+    
+    /** Get the power saving statistics with an estimate of the charge 
+        drawn by the module since power saving was enabled.
+        \param stats the statistics to fill
+    */
+    void getPowerStats(PowerStats* stats);
+    
     // ----------------------------------------------------------------
     // Data Connection (GPRS)
     // ----------------------------------------------------------------
     
-    /** register (Attach) the MT to the GPRS service. 
+    /** register (Attach) the MT to the GPRS service. If no apn, username and 
+        password is given the settings are looked up by the IMSI, the settings 
+        that worked the last time with this SIM are tried first. An active 
+        context of the same apn that still has an ip is kept.
         \param apn  the of the network provider e.g. "internet" or "apn.provider.com"
         \param username is the user name text string for the authentication phase
         \param password is the password text string for the authentication phase
@@ -146,6 +279,38 @@ public:
     */
     bool disconnect(void);
     
+    /** Get the ip address of the data connection, it is cleared when the 
+        network deactivates the context
+        \return the ip or NOIP if not connected
+    */
+    IP getIpAddress(void) { return _ip; }
+    
+    //! link events reported by the network
+    typedef enum { 
+        LINK_PDP_LOST,      //!< the context was deactivated, arg is the profile
+        LINK_REG_CHANGED,   //!< the registration changed, arg is the new Reg
+        LINK_SOCKET_CLOSED  //!< a socket was closed by the peer, arg is the socket
+    } LinkEvent;
+    
+    /** callback for link events, it is called while parsing the URCs and 
+        must not send any commands
+        \param param the argument passed to #setLinkCallback
+        \param event the event
+        \param arg the argument of the event
+    */
+    typedef void (*_LINKCB)(void* param, LinkEvent event, int arg);
+    
+    /** Set the callback for link events, only one can be installed
+        \param cb the callback or NULL to remove it
+        \param param the argument passed to the callback
+    */
+    void setLinkCallback(_LINKCB cb, void* param = NULL);
+    
+    /** Handle the pending URCs without sending a command, e.g. from the 
+        main loop while the modem is not used otherwise
+    */
+    void processUrc(void);
+    
     /** Translates a domain name to an IP address
         \param host the domain name to translate e.g. "u-blox.com"
         \return the IP if successful, 0 otherwise
@@ -177,6 +342,15 @@ public:
     */
     bool socketConnect(int socket, const char* host, int port);
         
+    /** enable TLS on a socket, the module does the encryption using one 
+        of its security profiles (see #secSetProfile). This has to be 
+        called before #socketConnect.
+        \param socket the socket handle
+        \param profile the security profile (0..4)
+        \return true if successfully, false otherwise
+    */
+    bool socketSecure(int socket, int profile = 0);
+    
     /** make a socket connection
         \param socket the socket handle
         \return true if connected, false otherwise
@@ -190,6 +364,18 @@ public:
     */
     bool socketSetBlocking(int socket, int timeout_ms);
     
+    /** Set the chunking of the socket transfers. By default the block
+        sizes and the pacing between the chunks follow the signal, the
+        access technology and the measured duration of the writes.
+        \param socket the socket handle
+        \param txBlock bytes per write command, -1 adaptive
+        \param rxBlock bytes per stream read command (at most 128), -1 adaptive, 
+               datagrams are always read at once
+        \param pace_ms delay between the chunks, -1 adaptive
+        \return true if successfully, false otherwise
+    */
+    bool socketSetChunking(int socket, int txBlock = -1, int rxBlock = -1, int pace_ms = -1);
+    
     /** Write socket data 
         \param socket the socket handle
         \param buf the buffer to write
@@ -244,6 +430,45 @@ public:
     */    
     bool socketFree(int socket);
         
+    // ----------------------------------------------------------------
+    // Security (TLS on the module)
+    // ----------------------------------------------------------------
+    
+    //! Certificate types of the module (AT+USECMNG)
+    typedef enum { SEC_ROOT_CA = 0, SEC_CLIENT_CERT = 1, SEC_CLIENT_KEY = 2 } SecCert;
+    //! Certificate validation levels (AT+USECPRF op 0)
+    typedef enum { SEC_VERIFY_NONE = 0, SEC_VERIFY_ROOT = 1, 
+                   SEC_VERIFY_URL = 2, SEC_VERIFY_DATE = 3 } SecVerify;
+    
+    /** Import a certificate or key (PEM or DER) into the module
+        \param type the type of the data
+        \param name the name of the certificate in the module 
+        \param buf the certificate data
+        \param len the size of the data
+        \return true if successful, false otherwise
+    */
+    bool secImportCert(SecCert type, const char* name, const char* buf, int len);
+    
+    /** Remove a certificate or key from the module
+        \param type the type of the data
+        \param name the name of the certificate in the module 
+        \return true if successful, false otherwise
+    */
+    bool secRemoveCert(SecCert type, const char* name);
+    
+    /** Set up a security profile of the module, the profile is reset first
+        \param profile the security profile (0..4)
+        \param verify the certificate validation level
+        \param rootCa the name of the trusted root certificate, or NULL
+        \param clientCert the name of the client certificate, or NULL
+        \param clientKey the name of the client private key, or NULL
+        \param sni the server name indication, or NULL
+        \return true if successful, false otherwise
+    */
+    bool secSetProfile(int profile, SecVerify verify = SEC_VERIFY_NONE, 
+                       const char* rootCa = NULL, const char* clientCert = NULL, 
+                       const char* clientKey = NULL, const char* sni = NULL);
+    
     // ----------------------------------------------------------------
     // SMS Short Message Service
     // ----------------------------------------------------------------
@@ -267,12 +492,51 @@ public:
     */
     bool smsRead(int ix, char* num, char* buf, int len);
     
+    /** callback function for #smsReadAll, called once per message 
+        \param param the argument passed to #smsReadAll
+        \param ix the storage position of the message
+        \param num the originator address
+        \param time the service centre time stamp ("yy/MM/dd,hh:mm:ss+zz")
+        \param buf the content of the message (not terminated)
+        \param len the length of the content
+    */
+    typedef void (*_SMSCB)(void* param, int ix, const char* num, 
+                           const char* time, const char* buf, int len);
+    
+    /** Read all messages of a type with a single AT+CMGL, each one is 
+        passed to the callback while the response is streamed in. 
+        \param stat what type of messages to read, see #smsList
+        \param cb the callback function 
+        \param param the argument passed to the callback
+        \return the number of messages, -1 on failure
+    */
+    int smsReadAll(const char* stat, _SMSCB cb, void* param = NULL);
+    
+    /** template version of #smsReadAll, this allows the compiler to do 
+        type cheking of the callback argument. 
+        \sa smsReadAll
+    */
+    template<class T>
+    inline int smsReadAll(const char* stat, 
+                    void (*cb)(T* param, int ix, const char* num, 
+                               const char* time, const char* buf, int len), 
+                    T* param)
+    {
+        return smsReadAll(stat, (_SMSCB)cb, (void*)param);
+    }
+    
     /** Send a message to a recipient 
         \param ix the storage position to delete
         \return true if successful, false otherwise
     */
     bool smsDelete(int ix);
     
+    /** Delete many messages at once with AT+CMGD=1,<flag>
+        \param flag 1: read, 2: read and sent, 3: read, sent and unsent, 4: all 
+        \return true if successful, false otherwise
+    */
+    bool smsDeleteAll(int flag = 3);
+    
     /** Send a message to a recipient 
         \param num the phone number of the recipient
         \param buf the content of the message to sent
@@ -280,6 +544,16 @@ public:
     */
     bool smsSend(const char* num, const char* buf);
     
+    /** Send binary data to a recipient using PDU mode with the 8-bit data 
+        coding scheme. Data that exceeds a single message (140 bytes) is 
+        split into concatenated messages of 134 bytes each.
+        \param num the phone number of the recipient (international with +)
+        \param buf the data to send
+        \param len the size of the data (up to 255 segments)
+        \return the number of messages sent, -1 on failure
+    */
+    int smsSendBinary(const char* num, const void* buf, int len);
+    
     // ----------------------------------------------------------------
     // USSD Unstructured Supplementary Service Data
     // ----------------------------------------------------------------
@@ -317,15 +591,222 @@ public:
     */
     int readFile(const char* filename, char* buf, int len);
     
+    /** Append data to a file in the local file system, the data is 
+        written in chunks so that large buffers can be stored.
+        \param filename the name of the file 
+        \param buf the data to write 
+        \param len the size of the data to write
+        \return the number of bytes written, -1 on failure
+    */
+    int appendFile(const char* filename, const char* buf, int len);
+    
+    /** Read a part of a file from the local file system, the data is 
+        read in blocks with AT+URDBLOCK directly into the buffer. 
+        \param filename the name of the file 
+        \param offset the position in the file to start reading
+        \param buf a buffer to hold the data 
+        \param len the size to read
+        \return the number of bytes read, less than len at the end of 
+                the file, -1 on failure
+    */
+    int readFileBlock(const char* filename, int offset, char* buf, int len);
+    
+    /** Get the size of a file in the local file system
+        \param filename the name of the file 
+        \return the size of the file, -1 if it does not exist
+    */
+    int fileSize(const char* filename);
+    
+    // ----------------------------------------------------------------
+    // HTTP client of the module
+    // ----------------------------------------------------------------
+    
+    //! HTTP commands (AT+UHTTPC)
+    typedef enum { HTTP_HEAD = 0, HTTP_GET = 1, HTTP_DELETE = 2, HTTP_PUT = 3, 
+                   HTTP_POST_FILE = 4, HTTP_POST_DATA = 5 } HttpCmd;
+    //! HTTP content types of POST
+    typedef enum { HTTP_URLENCODED = 0, HTTP_TEXT = 1, HTTP_OCTET = 2, 
+                   HTTP_MULTIPART = 3, HTTP_JSON = 4, HTTP_XML = 5 } HttpContent;
+    //! HTTP request state of a profile
+    typedef enum { HTTP_IDLE, HTTP_PENDING, HTTP_DONE, HTTP_FAILED } HttpState;
+    //! number of HTTP profiles of the module
+    enum { NUM_HTTP = 4 };
+    
+    /** Set up a HTTP profile of the module, the profile is reset first.
+        \param profile the profile (0..3)
+        \param server the server name or ip
+        \param port the server port
+        \param secure use HTTPS 
+        \param username an optional user name for basic authentication
+        \param password an optional password for basic authentication
+        \return true if successful, false otherwise
+    */
+    bool httpSetProfile(int profile, const char* server, int port = 80, bool secure = false,
+                        const char* username = NULL, const char* password = NULL);
+    
+    /** Start a HTTP request, the module runs it on its own and signals the 
+        completion with a +UUHTTPCR URC, see #httpWait. 
+        \param profile the profile (0..3)
+        \param cmd the request
+        \param path the path on the server 
+        \param respFile the file in the local file system receiving the response
+        \param param the file to PUT or POST, or the data for HTTP_POST_DATA
+        \param content the content type of POST, PUT has none
+        \return true if started, false otherwise
+    */
+    bool httpCommand(int profile, HttpCmd cmd, const char* path, const char* respFile, 
+                     const char* param = NULL, HttpContent content = HTTP_TEXT);
+    
+    /** Wait for the completion of a HTTP request 
+        \param profile the profile (0..3)
+        \param timeout_ms the time to wait, 0 just checks the state
+        \return the state of the request
+    */
+    HttpState httpWait(int profile, int timeout_ms = 0);
+    
+    /** GET a resource into a file of the local file system (blocking)
+        \param profile the profile (0..3)
+        \param path the path on the server 
+        \param respFile the file receiving the response (headers and body)
+        \param timeout_ms the time to wait for the completion
+        \return the size of the response file, -1 on failure
+    */
+    int httpGet(int profile, const char* path, const char* respFile, int timeout_ms = 180000);
+    
+    /** POST a buffer (blocking), the buffer is stored in the local 
+        file system and posted from there by the module 
+        \param profile the profile (0..3)
+        \param path the path on the server 
+        \param respFile the file receiving the response (headers and body)
+        \param buf the data to post
+        \param len the size of the data 
+        \param content the content type 
+        \param timeout_ms the time to wait for the completion
+        \return the size of the response file, -1 on failure
+    */
+    int httpPost(int profile, const char* path, const char* respFile, 
+                 const char* buf, int len, HttpContent content = HTTP_OCTET, 
+                 int timeout_ms = 180000);
+    
+    // ----------------------------------------------------------------
+    // CellLocate / hybrid positioning
+    // ----------------------------------------------------------------
+    
+    //! sensors of a position request (a mask) and of a result
+    typedef enum { CELL_LAST = 0, CELL_GNSS = 1, CELL_LOCATE = 2, CELL_HYBRID = 3 } CellSensType;
+    
+    //! result of a position request
+    typedef struct { 
+        int day, month, year;       //!< date (UTC)
+        int hour, minute, second;   //!< time (UTC)
+        double latitude;            //!< latitude in degrees
+        double longitude;           //!< longitude in degrees
+        int altitude;               //!< altitude in m (GNSS only)
+        int uncertainty;            //!< horizontal uncertainty in m
+        int speed;                  //!< speed in m/s (GNSS only)
+        int direction;              //!< course over ground in degrees (GNSS only)
+        int verticalAcc;            //!< vertical accuracy in m (GNSS only)
+        CellSensType sensor;        //!< the sensor that produced the position
+        int svUsed;                 //!< satellites used
+        int ttf_ms;                 //!< time from the request to the result
+    } CellLocData;
+    
+    /** Configure the CellLocate servers for the HTTP access (AT+UGSRV)
+        \param token the authentication token
+        \param server1 the primary server
+        \param server2 the secondary server
+        \return true if successful, false otherwise
+    */
+    bool cellLocSrvHttp(const char* token, 
+                        const char* server1 = "cell-live1.services.u-blox.com", 
+                        const char* server2 = "cell-live2.services.u-blox.com");
+    
+    /** Configure the CellLocate server for the UDP access (AT+UGAOP)
+        \param server the server
+        \param port the server port
+        \param latency the expected network latency in ms
+        \param mode 0 for the standard access
+        \return true if successful, false otherwise
+    */
+    bool cellLocSrvUdp(const char* server = "cell-live1.services.u-blox.com", 
+                       int port = 46434, int latency = 1000, int mode = 0);
+    
+    /** Configure the cell scan (AT+ULOCCELL)
+        \param scanMode 0 normal scan, 1 deep scan (slower, better indoors)
+        \return true if successful, false otherwise
+    */
+    bool cellLocConfigSensor(int scanMode);
+    
+    /** Enable the progress indications of the positioning (AT+ULOCIND)
+        \param mode 1 to enable, 0 to disable
+        \return true if successful, false otherwise
+    */
+    bool cellUnsolIndication(int mode);
+    
+    /** Start a single shot position request (AT+ULOC). The request runs 
+        on the module, the result is reported with a +UULOC URC and can 
+        be fetched with #cellLocGetData. With CELL_LOCATE the position is 
+        usually known within seconds, also indoors and with a cold GNSS. 
+        \param sensor the sensor mask, 1 GNSS, 2 CellLocate, 3 hybrid
+        \param timeout_s the time the module may take (1..999 s)
+        \param accuracy_m the target accuracy in m
+        \param detailed request the detailed result (speed, sensor, ...)
+        \return true if the request was started, false otherwise
+    */
+    bool cellLocRequest(int sensor, int timeout_s, int accuracy_m, bool detailed = true);
+    
+    /** Get the result of the last position request, this handles the 
+        pending URCs but does not wait.
+        \param data the structure to fill
+        \return true if a new result was available, false otherwise
+    */
+    bool cellLocGetData(CellLocData* data);
+    
     // ----------------------------------------------------------------
     // DEBUG/DUMP status to standard out (printf)
     // ----------------------------------------------------------------
     
     /*! Set the debug level 
         \param level 0 = OFF, 1 = INFO(default), 2 = TRACE, 3 = ATCMD
+               (recorded to the transcript, see #dumpTranscript)
         \return true if successful, false not possible
     */ 
     bool setDebug(int level);
+    
+    enum { 
+        TRACE_HEAD = 10,    //!< size of the record header of the transcript
+        TRACE_CAP  = 64,    //!< default number of payload bytes recorded
+        TRACE_SIZE = 2048   //!< size of the transcript enabled by #setDebug
+    };
+    
+    /** Enable the binary AT transcript. Every line sent to and received 
+        from the modem is recorded to a ring buffer in RAM as records of:
+        direction ('>' sent, '<' received), the line type (TYPE_xxx >> 16, 
+        0 if sent), timestamp in us (4 bytes), length of the line (2 bytes), 
+        length of the recorded payload (2 bytes), all little endian, 
+        followed by the payload. The oldest records are dropped when the 
+        ring is full, so it always holds the latest history.
+        \param size the size of the ring buffer, 0 disables the transcript
+        \param cap the payload bytes recorded per line, 0 records all 
+        \return true if successful, false otherwise
+    */
+    bool setTranscript(int size, int cap = TRACE_CAP);
+    
+    /** Drain the transcript, e.g. to pass it on to the debug port. Only 
+        whole records are copied, a record that does not fit stays in the 
+        transcript for the next call.
+        \param buf the buffer to fill 
+        \param len the size of the buffer, at least TRACE_HEAD + the cap
+        \return the number of bytes copied
+    */
+    int getTranscript(char* buf, int len);
+    
+    /** Get a snapshot of the modem metrics. The metrics are always 
+        collected, the cost is a few cycles per command.
+        \param metrics the structure to fill
+        \param reset restart the collection after taking the snapshot
+    */
+    void getMetrics(Metrics* metrics, bool reset = false);
 
     //! helper type for DPRINT
     typedef int (*_DPRINT)(void* param, char const * format, ...);
@@ -363,6 +844,31 @@ public:
         \param param  the irst argument passed to dprint
     */
     _DUMP_TEMPLATE(dumpIp, MDMParser::IP, ip)
+    
+    /** dump the metrics to stdout using printf
+        \param metrics the metrics to convert to textual form, 
+               unused command classes and sockets are ommited (not printed)
+        \param dprint a function pointer
+        \param param  the irst argument passed to dprint
+    */
+    _DUMP_TEMPLATE(dumpMetrics, MDMParser::Metrics*, metrics)
+    
+    /** Drain the transcript and print the decoded records, colored like 
+        the live trace, e.g. on demand or from a fault handler.
+        \param dprint a function pointer
+        \param param  the first argument passed to dprint
+    */
+    void dumpTranscript(_DPRINT dprint = (_DPRINT)fprintf, void* param = (void*)stdout);
+    
+    /** template version of #dumpTranscript, this allows the compiler to 
+        do type cheking of the print function argument.
+        \sa dumpTranscript
+    */
+    template<class T>
+    inline void dumpTranscript(int (*dprint)(T* param, char const * format, ...), T* param)
+    {
+        dumpTranscript((_DPRINT)dprint, (void*)param);
+    }
    
     // ----------------------------------------------------------------
     // Parseing
@@ -427,6 +933,46 @@ public:
     */
     int sendFormated(const char* format, ...);
     
+    /** Allocation free builder of AT commands, used instead of 
+        #sendFormated on the hot paths. The literal pieces are copied with 
+        their length known at compile time, numbers and addresses are 
+        converted without the printf machinery. Pieces that do not fit 
+        are truncated like vsnprintf does.
+    */
+    class AtCmd
+    {
+    public:
+        enum { SIZE = 128 }; //!< largest command, as for sendFormated, a host name needs the most
+        //! start the command with a literal prefix, e.g. "AT+USOWR="
+        template<int N> 
+        AtCmd(const char (&prefix)[N]) { _len = 0; str(prefix); }
+        //! append a literal 
+        template<int N> 
+        AtCmd& str(const char (&lit)[N]) { return raw(lit, N-1); }
+        //! append a number 
+        AtCmd& num(int val);
+        //! append an ip address in dotted notation (without quotes)
+        AtCmd& ip(IP ip);
+        //! append a string in quotes 
+        AtCmd& quoted(const char* str);
+        //! append the command terminator 
+        AtCmd& end(void) { return str("\r\n"); }
+        //! the command
+        const char* buf(void) const { return _buf; }
+        //! the length of the command
+        int len(void) const         { return _len; }
+    protected:
+        AtCmd& raw(const char* buf, int len);
+        char _buf[SIZE+1];
+        int _len;
+    };
+    
+    /** Write a command created with #AtCmd to the physical interface
+        \param cmd the command
+        \return bytes written
+    */
+    int sendCmd(const AtCmd& cmd);
+    
     /** callback function for #waitFinalResp with void* as argument
         \param type the #getLine response
         \param buf the parsed line
@@ -460,7 +1006,31 @@ public:
     {
         return waitFinalResp((_CALLBACKPTR)cb, (void*)param, timeout_ms);
     }
-    
+
+    //! a command of a batch, see #sendBatch
+    typedef struct {
+        const char* cmd;    //!< extended command without the "AT" e.g. "+CSQ" or "+CREG?"
+        _CALLBACKPTR cb;    //!< the optional callback for the intermediate response
+        void* param;        //!< the optional callback function parameter
+    } BatchCmd;
+
+    //! helper to generate a #BatchCmd, casts the callback and its parameter
+    #define _BATCH(cmd,cb,param) { cmd, (MDMParser::_CALLBACKPTR)(cb), (void*)(param) }
+
+    /** Send a batch of commands concatenated to a single command line
+        (e.g. AT+CREG?;+CGREG?;+CSQ) and wait for the single final response.
+        Intermediate responses starting with the command name are passed to
+        the callback of this command, information text lines (e.g. of +CGMI)
+        are passed in order to the next command with a callback that is no
+        set (=) or read (?) command. Only extended commands without a prompt
+        should be combined, the first error aborts the batch.
+        \param cmds the commands to send
+        \param num the number of commands
+        \param timeout_ms the timeout to wait for the final response
+        \return the final response like #waitFinalResp
+    */
+    int sendBatch(const BatchCmd* cmds, int num, int timeout_ms = 10000);
+
 protected:
     /** Write bytes to the physical interface. This function should be 
         implemented in a inherited class.
@@ -470,6 +1040,26 @@ protected:
     */
     virtual int _send(const void* buf, int len) = 0;
 
+    /** Change the baudrate of the physical interface. This function 
+        should be implemented in a inherited class.
+        \param baudrate the new baudrate
+    */
+    virtual void _setBaudrate(int baudrate) = 0;
+
+    /** Configure the physical interface for a power saving mode. This 
+        function should be implemented in a inherited class.
+        \param psv the power saving mode
+        \param dtr the DTR pin or NC
+        \return true if supported, false otherwise
+    */
+    virtual bool _powerSaving(Psv psv, PinName dtr) = 0;
+    
+    /** Get the wake up statistics of the physical interface. This function 
+        should be implemented in a inherited class.
+        \param stats the statistics to fill
+    */
+    virtual void _powerStats(PowerStats* stats) = 0;
+
     /** Helper: Parse a line from the receiving buffered pipe
         \param pipe the receiving buffer pipe 
         \param buf the parsed line
@@ -511,20 +1101,37 @@ protected:
     // parsing callbacks for different AT commands and their parameter arguments
     static int _cbString(int type, const char* buf, int len, char* str);
     static int _cbInt(int type, const char* buf, int len, int* val);
+    typedef struct { const BatchCmd* cmds; int num; int ix; } BATCHparam;
+    static int _cbBatch(int type, const char* buf, int len, BATCHparam* param);
     // device
     static int _cbATI(int type, const char* buf, int len, Dev* dev);
     static int _cbCPIN(int type, const char* buf, int len, Sim* sim);
     static int _cbCCID(int type, const char* buf, int len, char* ccid);
     // network 
+    static int _cbCREG(int type, const char* buf, int len, NetStatus* status);
     static int _cbCSQ(int type, const char* buf, int len, NetStatus* status);
+    static int _cbUCELLINFO(int type, const char* buf, int len, CellSnapshot* snap);
+    static int _cellQuality(const CellInfo* cell);
     static int _cbCOPS(int type, const char* buf, int len, NetStatus* status);
     static int _cbCNUM(int type, const char* buf, int len, char* num);
     static int _cbUACTIND(int type, const char* buf, int len, int* i);
     static int _cbUDOPN(int type, const char* buf, int len, char* mccmnc);
     // sockets
     static int _cbCMIP(int type, const char* buf, int len, IP* ip);
+    void _chunkLimits(int* tx, int* rx, int* pace);
+    int _chunkTx(int socket, int* pace);
+    int _chunkRx(int socket);
+    void _chunkDone(int socket, bool ok, int ms);
+    /** helper: set up the profile and try to activate it 
+        \param auth the authentication to use or AUTH_DETECT, 
+                    returns the one that was successful
+        \return true if activated, false otherwise
+    */
+    bool _activateProfile(const char* apn, const char* username, 
+                          const char* password, Auth* auth);
     static int _cbUPSND(int type, const char* buf, int len, int* act);
     static int _cbUPSND(int type, const char* buf, int len, IP* ip);
+    static int _cbUPSD(int type, const char* buf, int len, char* apn);
     static int _cbUDNSRN(int type, const char* buf, int len, IP* ip);
     static int _cbUSOCR(int type, const char* buf, int len, int* socket);
     static int _cbUSORD(int type, const char* buf, int len, char* out);
@@ -535,22 +1142,66 @@ protected:
     // sms
     typedef struct { int* ix; int num; } CMGLparam;
     static int _cbCMGL(int type, const char* buf, int len, CMGLparam* param);
+    typedef struct { _SMSCB cb; void* param; int ix; char num[32]; char time[32]; int cnt; } CMGLALLparam;
+    static int _cbCMGLALL(int type, const char* buf, int len, CMGLALLparam* param);
+    int _sendHex(const void* buf, int len);
     static int _cbCMGR(int type, const char* buf, int len, CMGRparam* param);
     // file
     typedef struct { const char* filename; char* buf; int sz; int len; } URDFILEparam;
     static int _cbURDFILE(int type, const char* buf, int len, URDFILEparam* param);
+    static int _cbURDBLOCK(int type, const char* buf, int len, URDFILEparam* param);
+    static int _cbULSTFILE(int type, const char* buf, int len, int* size);
+    // http
+    int _httpRequest(int profile, HttpCmd cmd, const char* path, const char* respFile, 
+                     const char* param, HttpContent content, int timeout_ms);
+    // power saving
+    bool _setPowerSaving(Psv psv, PinName dtr);
+    bool _powerOn(PinName pn, PinName r_pn, Timer& timer);
+    // transcript
+    void _transcript(char dir, int type, const char* buf, int len);
+    // metrics
+    void _metricsStart(const char* buf);
+    void _metricsStop(int ret);
     // variables
     DevStatus   _dev; //!< collected device information
     NetStatus   _net; //!< collected network information 
     IP          _ip;  //!< assigned ip address
     // management struture for sockets
     typedef enum { SOCK_FREE, SOCK_CREATED, SOCK_CONNECTED } SockState;
-    typedef struct { volatile SockState state; volatile int pending; int timeout_ms; } SockCtrl;
+    typedef struct { 
+        volatile SockState state; 
+        volatile int pending; 
+        int timeout_ms; 
+        int txBlk;      //!< the adapted write block, 0 not yet adapted
+        int txFix;      //!< fixed write block, -1 adaptive
+        int rxFix;      //!< fixed read block, -1 adaptive
+        int paceFix;    //!< fixed delay between the chunks, -1 adaptive
+    } SockCtrl;
     // LISA-C has 6 TCP and 6 UDP sockets starting at index 18
     // LISA-U and SARA-G have 7 sockets starting at index 1
-    SockCtrl _sockets[32];
+    SockCtrl _sockets[NUM_SOCKETS];
     static MDMParser* inst;
     bool _init;
+    int _linkBaud; //!< the baudrate of the physical interface
+    Dev _lastDev;  //!< the module found by the last init of this boot, selects the power on pulse
+    BootTiming _boot; //!< timing of the last init
+    Psv _psv;      //!< the power saving mode in use
+    unsigned char _smsRef; //!< reference number of concatenated sms
+    volatile HttpState _http[NUM_HTTP]; //!< state of the http profiles
+    CellLocData _loc;  //!< the last position result
+    volatile bool _locDone; //!< a new position result is available
+    Timer _locTimer;   //!< time since the position request
+    CellSnapshot _cells; //!< the cached cell snapshot
+    bool _cellsValid;  //!< the cell snapshot was taken
+    Timer _cellsTimer; //!< time since the cell snapshot was taken
+    Metrics _metrics;  //!< the collected metrics
+    int _cmdClass;     //!< the class of the pending command, -1 if none
+    uint32_t _cmdStart;//!< the time the pending command was sent in us
+    Pipe<char>* _script; //!< the transcript ring buffer, NULL if disabled
+    int _scriptCap;      //!< the payload bytes recorded per line, 0 all
+    int _scriptLost;     //!< the records dropped since the last dump
+    _LINKCB _linkCb;     //!< the link event callback
+    void* _linkParam;    //!< the argument of the link event callback
 #ifdef TARGET_UBLOX_C027
     bool _onboard;
 #endif
@@ -614,6 +1265,26 @@ protected:
         \return bytes written
     */
     virtual int _send(const void* buf, int len);
+    
+    /** Change the baudrate of the serial port.
+        \param baudrate the new baudrate
+    */
+    virtual void _setBaudrate(int baudrate);
+    
+    /** Gate the transmission of the serial port for a power saving mode.
+        \param psv the power saving mode
+        \param dtr the DTR pin or NC
+        \return true if supported, false otherwise
+    */
+    virtual bool _powerSaving(Psv psv, PinName dtr);
+    
+    /** Get the wake up statistics of the serial port.
+        \param stats the statistics to fill
+    */
+    virtual void _powerStats(PowerStats* stats);
+#if DEVICE_SERIAL_FC
+    bool _cts; //!< the transmission is gated by CTS
+#endif
 };
 
 // -----------------------------------------------------------------------
@@ -631,6 +1302,9 @@ public:
     virtual void purge(void) { }
 protected:
     virtual int _send(const void* buf, int len);
+    virtual void _setBaudrate(int baudrate) { }
+    virtual bool _powerSaving(Psv psv, PinName dtr) { return psv == PSV_OFF; }
+    virtual void _powerStats(PowerStats* stats) { }
 };
 #endif
 
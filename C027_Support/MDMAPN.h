@@ -23,106 +23,194 @@
     *cfg ? cfg : ""; \
     cfg  += strlen(cfg) + 1
                     
-//! APN lookup struct
-typedef struct { 
-    const char* mccmnc; //!< mobile country code (MCC) and mobile network code MNC  
-    const char* cfg;    //!< APN configuartion string, use _APN macro to generate
-} APN_t;
-
 //! default APN settings used by many networks
 static const char* apndef = _APN(,,)
                             _APN("internet",,);
 
-/*! this is a list of special APNs for different network operators 
-    There is no need to enter the default apn internet in the table; 
-    apndef will be used if no entry matches.
-    
-    The APN without username/password have to be listed first.
-*/
-static const APN_t apnlut[] = {
-// MCC Country
-//  { /* Operator */ "MCC-MNC[,MNC]" _APN(APN,USERNAME,PASSWORD) },
-// MCC must be 3 digits
-// MNC must be either 2 or 3 digits
-// MCC must be separated by '-' from MNC, multiple MNC can be separated by ','
+/* ----------------------------------------------------------------
+   APN configurations of different network operators, use the _APN 
+   macro to generate them. There is no need to enter the default apn 
+   internet here; apndef will be used if no entry matches.
+   
+   The APN without username/password have to be listed first.
+---------------------------------------------------------------- */
 
 // 460 China - CN
-    { /* CN Mobile */"460-00",  _APN("cmnet",,)
-                                _APN("cmwap",,) },
-    { /* Unicom */   "460-01",  _APN("3gnet",,)
-                                _APN("uninet","uninet","uninet") },
-                                
+static const char apnCnMobile[]   = _APN("cmnet",,)
+                                    _APN("cmwap",,);
+static const char apnCnUnicom[]   = _APN("3gnet",,)
+                                    _APN("uninet","uninet","uninet");
 // 262 Germany - DE
-    { /* T-Mobile */ "262-01",  _APN("internet.t-mobile","t-mobile","tm") },
-
+static const char apnDeTMobile[]  = _APN("internet.t-mobile","t-mobile","tm");
 // 222 Italy - IT
-    { /* TIM */      "222-01",  _APN("ibox.tim.it",,) },
-    { /* Vodafone */ "222-10",  _APN("web.omnitel.it",,) },
-    { /* Wind */     "222-88",  _APN("internet.wind.biz",,) },
-
+static const char apnItTim[]      = _APN("ibox.tim.it",,);
+static const char apnItVodafone[] = _APN("web.omnitel.it",,);
+static const char apnItWind[]     = _APN("internet.wind.biz",,);
 // 440 Japan - JP
-    { /* Softbank */ "440-04,06,20,40,41,42,43,44,45,46,47,48,90,91,92,93,94,95"
-                         ",96,97,98"
-                                _APN("open.softbank.ne.jp","opensoftbank","ebMNuX1FIHg9d3DA")
-                                _APN("smile.world","dna1trop","so2t3k3m2a") },
-    { /* NTTDoCoMo */"440-09,10,11,12,13,14,15,16,17,18,19,21,22,23,24,25,26,27,"
-                         "28,29,30,31,32,33,34,35,36,37,38,39,58,59,60,61,62,63,"
-                         "64,65,66,67,68,69,87,99",
-                                _APN("bmobilewap",,) /*BMobile*/
-                                _APN("mpr2.bizho.net","Mopera U",) /* DoCoMo */
-                                _APN("bmobile.ne.jp","bmobile@wifi2","bmobile") /*BMobile*/ },
-
+static const char apnJpSoftbank[] = _APN("open.softbank.ne.jp","opensoftbank","ebMNuX1FIHg9d3DA")
+                                    _APN("smile.world","dna1trop","so2t3k3m2a");
+static const char apnJpDoCoMo[]   = _APN("bmobilewap",,) /*BMobile*/
+                                    _APN("mpr2.bizho.net","Mopera U",) /* DoCoMo */
+                                    _APN("bmobile.ne.jp","bmobile@wifi2","bmobile") /*BMobile*/;
 // 293 Slovenia - SI
-    { /* Si.mobil */ "293-40",  _APN("internet.simobil.si",,) },
-    { /* Tusmobil */ "293-70",  _APN("internet.tusmobil.si",,) },
-
+static const char apnSiSimobil[]  = _APN("internet.simobil.si",,);
+static const char apnSiTusmobil[] = _APN("internet.tusmobil.si",,);
 // 228 Switzerland - CH
-    { /* Swisscom */ "228-01",  _APN("gprs.swisscom.ch",,) },
-    { /* Orange */   "228-03",  _APN("internet",,) /* contract */
-                                _APN("click",,)    /* pre-pay */ },
-
+static const char apnChSwisscom[] = _APN("gprs.swisscom.ch",,);
+static const char apnChOrange[]   = _APN("internet",,) /* contract */
+                                    _APN("click",,)    /* pre-pay */;
 // 234 United Kingdom - GB
-    { /* O2 */       "234-02,10,11",
-                                _APN("mobile.o2.co.uk","faster","web") /* contract */
-                                _APN("mobile.o2.co.uk","bypass","web") /* pre-pay */
-                                _APN("payandgo.o2.co.uk","payandgo","payandgo") },
-    { /* Vodafone */ "234-15",  _APN("internet","web","web")          /* contract */
-                                _APN("pp.vodafone.co.uk","wap","wap")  /* pre-pay */ },
-
+static const char apnGbO2[]       = _APN("mobile.o2.co.uk","faster","web") /* contract */
+                                    _APN("mobile.o2.co.uk","bypass","web") /* pre-pay */
+                                    _APN("payandgo.o2.co.uk","payandgo","payandgo");
+static const char apnGbVodafone[] = _APN("internet","web","web")          /* contract */
+                                    _APN("pp.vodafone.co.uk","wap","wap")  /* pre-pay */;
 // 310 United States of America - US
-    { /* T-Mobile */ "310-026,260,490",
-                                _APN("epc.tmobile.com",,)
-                                _APN("fast.tmobile.com",,) /* LTE */ },
-    { /* AT&T */     "310-030,150,170,260,410,560,680",
-                                _APN("phone",,)
-                                _APN("wap.cingular","WAP@CINGULARGPRS.COM","CINGULAR1")
-                                _APN("isp.cingular","ISP@CINGULARGPRS.COM","CINGULAR1") },
+static const char apnUsTMobile[]  = _APN("epc.tmobile.com",,)
+                                    _APN("fast.tmobile.com",,) /* LTE */;
+static const char apnUsATT[]      = _APN("phone",,)
+                                    _APN("wap.cingular","WAP@CINGULARGPRS.COM","CINGULAR1")
+                                    _APN("isp.cingular","ISP@CINGULARGPRS.COM","CINGULAR1");
+
+//! helper to encode a 3 digit MNC (e.g. 310-026), 2 digit MNC are used as is
+#define _MNC3(mnc) (1000 + (mnc))
+
+//! APN lookup struct
+typedef struct { 
+    unsigned short mcc; //!< mobile country code (MCC)
+    unsigned short mnc; //!< mobile network code (MNC), use _MNC3 for 3 digit MNC
+    const char* cfg;    //!< APN configuartion string, use _APN macro to generate
+} APN_t;
+
+/*! this is the lookup table from MCC/MNC to the APN configuration, 
+    it is searched binary so it MUST be sorted by MCC and then MNC.
+*/
+static const APN_t apnlut[] = {
+//  { MCC, MNC,       config        }, // Operator
+    { 222,  1,        apnItTim      }, // TIM
+    { 222, 10,        apnItVodafone }, // Vodafone
+    { 222, 88,        apnItWind     }, // Wind
+    { 228,  1,        apnChSwisscom }, // Swisscom
+    { 228,  3,        apnChOrange   }, // Orange
+    { 234,  2,        apnGbO2       }, // O2
+    { 234, 10,        apnGbO2       }, // O2
+    { 234, 11,        apnGbO2       }, // O2
+    { 234, 15,        apnGbVodafone }, // Vodafone
+    { 262,  1,        apnDeTMobile  }, // T-Mobile
+    { 293, 40,        apnSiSimobil  }, // Si.mobil
+    { 293, 70,        apnSiTusmobil }, // Tusmobil
+    { 310, _MNC3( 26),apnUsTMobile  }, // T-Mobile
+    { 310, _MNC3( 30),apnUsATT      }, // AT&T
+    { 310, _MNC3(150),apnUsATT      }, // AT&T
+    { 310, _MNC3(170),apnUsATT      }, // AT&T
+    { 310, _MNC3(260),apnUsTMobile  }, // T-Mobile (also used by AT&T)
+    { 310, _MNC3(410),apnUsATT      }, // AT&T
+    { 310, _MNC3(490),apnUsTMobile  }, // T-Mobile
+    { 310, _MNC3(560),apnUsATT      }, // AT&T
+    { 310, _MNC3(680),apnUsATT      }, // AT&T
+    { 440,  4,        apnJpSoftbank }, // Softbank
+    { 440,  6,        apnJpSoftbank }, // Softbank
+    { 440,  9,        apnJpDoCoMo   }, // NTTDoCoMo
+    { 440, 10,        apnJpDoCoMo   }, // NTTDoCoMo
+    { 440, 11,        apnJpDoCoMo   }, // NTTDoCoMo
+    { 440, 12,        apnJpDoCoMo   }, // NTTDoCoMo
+    { 440, 13,        apnJpDoCoMo   }, // NTTDoCoMo
+    { 440, 14,        apnJpDoCoMo   }, // NTTDoCoMo
+    { 440, 15,        apnJpDoCoMo   }, // NTTDoCoMo
+    { 440, 16,        apnJpDoCoMo   }, // NTTDoCoMo
+    { 440, 17,        apnJpDoCoMo   }, // NTTDoCoMo
+    { 440, 18,        apnJpDoCoMo   }, // NTTDoCoMo
+    { 440, 19,        apnJpDoCoMo   }, // NTTDoCoMo
+    { 440, 20,        apnJpSoftbank }, // Softbank
+    { 440, 21,        apnJpDoCoMo   }, // NTTDoCoMo
+    { 440, 22,        apnJpDoCoMo   }, // NTTDoCoMo
+    { 440, 23,        apnJpDoCoMo   }, // NTTDoCoMo
+    { 440, 24,        apnJpDoCoMo   }, // NTTDoCoMo
+    { 440, 25,        apnJpDoCoMo   }, // NTTDoCoMo
+    { 440, 26,        apnJpDoCoMo   }, // NTTDoCoMo
+    { 440, 27,        apnJpDoCoMo   }, // NTTDoCoMo
+    { 440, 28,        apnJpDoCoMo   }, // NTTDoCoMo
+    { 440, 29,        apnJpDoCoMo   }, // NTTDoCoMo
+    { 440, 30,        apnJpDoCoMo   }, // NTTDoCoMo
+    { 440, 31,        apnJpDoCoMo   }, // NTTDoCoMo
+    { 440, 32,        apnJpDoCoMo   }, // NTTDoCoMo
+    { 440, 33,        apnJpDoCoMo   }, // NTTDoCoMo
+    { 440, 34,        apnJpDoCoMo   }, // NTTDoCoMo
+    { 440, 35,        apnJpDoCoMo   }, // NTTDoCoMo
+    { 440, 36,        apnJpDoCoMo   }, // NTTDoCoMo
+    { 440, 37,        apnJpDoCoMo   }, // NTTDoCoMo
+    { 440, 38,        apnJpDoCoMo   }, // NTTDoCoMo
+    { 440, 39,        apnJpDoCoMo   }, // NTTDoCoMo
+    { 440, 40,        apnJpSoftbank }, // Softbank
+    { 440, 41,        apnJpSoftbank }, // Softbank
+    { 440, 42,        apnJpSoftbank }, // Softbank
+    { 440, 43,        apnJpSoftbank }, // Softbank
+    { 440, 44,        apnJpSoftbank }, // Softbank
+    { 440, 45,        apnJpSoftbank }, // Softbank
+    { 440, 46,        apnJpSoftbank }, // Softbank
+    { 440, 47,        apnJpSoftbank }, // Softbank
+    { 440, 48,        apnJpSoftbank }, // Softbank
+    { 440, 58,        apnJpDoCoMo   }, // NTTDoCoMo
+    { 440, 59,        apnJpDoCoMo   }, // NTTDoCoMo
+    { 440, 60,        apnJpDoCoMo   }, // NTTDoCoMo
+    { 440, 61,        apnJpDoCoMo   }, // NTTDoCoMo
+    { 440, 62,        apnJpDoCoMo   }, // NTTDoCoMo
+    { 440, 63,        apnJpDoCoMo   }, // NTTDoCoMo
+    { 440, 64,        apnJpDoCoMo   }, // NTTDoCoMo
+    { 440, 65,        apnJpDoCoMo   }, // NTTDoCoMo
+    { 440, 66,        apnJpDoCoMo   }, // NTTDoCoMo
+    { 440, 67,        apnJpDoCoMo   }, // NTTDoCoMo
+    { 440, 68,        apnJpDoCoMo   }, // NTTDoCoMo
+    { 440, 69,        apnJpDoCoMo   }, // NTTDoCoMo
+    { 440, 87,        apnJpDoCoMo   }, // NTTDoCoMo
+    { 440, 90,        apnJpSoftbank }, // Softbank
+    { 440, 91,        apnJpSoftbank }, // Softbank
+    { 440, 92,        apnJpSoftbank }, // Softbank
+    { 440, 93,        apnJpSoftbank }, // Softbank
+    { 440, 94,        apnJpSoftbank }, // Softbank
+    { 440, 95,        apnJpSoftbank }, // Softbank
+    { 440, 96,        apnJpSoftbank }, // Softbank
+    { 440, 97,        apnJpSoftbank }, // Softbank
+    { 440, 98,        apnJpSoftbank }, // Softbank
+    { 440, 99,        apnJpDoCoMo   }, // NTTDoCoMo
+    { 460,  0,        apnCnMobile   }, // CN Mobile
+    { 460,  1,        apnCnUnicom   }, // Unicom
 };
 
+//! binary search the lookup table, returns NULL if not found
+inline const char* _apnfind(int mcc, int mnc)
+{
+    int l = 0;
+    int h = sizeof(apnlut)/sizeof(*apnlut) - 1;
+    while (l <= h) {
+        int m = (l + h) / 2;
+        int d = (apnlut[m].mcc != mcc) ? apnlut[m].mcc - mcc : apnlut[m].mnc - mnc;
+        if      (d < 0) l = m + 1;
+        else if (d > 0) h = m - 1;
+        else            return apnlut[m].cfg;
+    }
+    return NULL;
+}
+
 inline const char* apnconfig(const char* imsi)
 {
     const char* config = NULL;
     if (imsi && *imsi) {
-        // many carriers use internet without username and password, os use this as default
-        // now try to lookup the setting for our table
-        for (int i = 0; i < sizeof(apnlut)/sizeof(*apnlut) && !config; i ++) {
-            const char* p = apnlut[i].mccmnc;
-            // check the MCC
-            if ((0 == memcmp(imsi, p, 3))) {
-                p += 3;
-                // check all the MNC, MNC length can be 2 or 3 digits
-                while (((p[0] == '-') || (p[0] == ',')) && 
-                        (p[1] >= '0') && (p[1] <= '9') && 
-                        (p[2] >= '0') && (p[2] <= '9') && !config) {
-                    int l = ((p[3] >= '0') && (p[3] <= '9')) ? 3 : 2;
-                    if (0 == memcmp(imsi+3,p+1,l))
-                        config = apnlut[i].cfg;
-                    p += 1 + l;
-                } 
-            }
+        // the imsi starts with the 3 digits MCC followed by the MNC, 
+        // the MNC length can be 2 or 3 digits 
+        int d[6];
+        int i;
+        for (i = 0; (i < 6) && (imsi[i] >= '0') && (imsi[i] <= '9'); i ++)
+            d[i] = imsi[i] - '0';
+        if (i == 6) {
+            int mcc = d[0] * 100 + d[1] * 10 + d[2];
+            int mnc = d[3] * 10 + d[4];
+            config = _apnfind(mcc, _MNC3(mnc * 10 + d[5]));
+            if (!config)
+                config = _apnfind(mcc, mnc);
         }
     }
-    // use default if not found
+    // many carriers use internet without username and password, so use this as default
     if (!config)
         config = apndef;
     return config;
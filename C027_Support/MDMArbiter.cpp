@@ -0,0 +1,139 @@
+#include "mbed.h"
+#include "MDMArbiter.h"
+
+MDMArbiter::MDMArbiter(MDMParser* mdm)
+{
+    _mdm = mdm;
+    memset(_jobs, 0, sizeof(_jobs));
+    _id = 0;
+    _seq = 0;
+    _busy = false;
+}
+
+int MDMArbiter::post(_JOBCB cb, void* param /*= NULL*/, Prio prio /*= PRIO_NORMAL*/)
+{
+    if (!cb)
+        return -1;
+    for (int i = 0; i < MAX_JOBS; i ++) {
+        if (!_jobs[i].cb) {
+            if (++_id <= 0)
+                _id = 1;
+            _jobs[i].id = _id;
+            _jobs[i].cb = cb;
+            _jobs[i].param = param;
+            _jobs[i].prio = prio;
+            _jobs[i].age = 0;
+            _jobs[i].seq = _seq++;
+            return _id;
+        }
+    }
+    return -1;
+}
+
+bool MDMArbiter::pending(int id)
+{
+    for (int i = 0; i < MAX_JOBS; i ++) {
+        if (_jobs[i].cb && (_jobs[i].id == id))
+            return true;
+    }
+    return false;
+}
+
+bool MDMArbiter::cancel(int id)
+{
+    for (int i = 0; i < MAX_JOBS; i ++) {
+        if (_jobs[i].cb && (_jobs[i].id == id)) {
+            _jobs[i].cb = NULL;
+            return true;
+        }
+    }
+    return false;
+}
+
+int MDMArbiter::pump(int steps /*= 1*/)
+{
+    if (_busy)
+        return queued();
+    _busy = true;
+    while (steps-- > 0) {
+        // highest priority including the age, the longest waiting first
+        int best = -1;
+        int bestPrio = 0;
+        for (int i = 0; i < MAX_JOBS; i ++) {
+            if (!_jobs[i].cb)
+                continue;
+            int prio = _jobs[i].prio * AGE_STEP + _jobs[i].age;
+            if ((best < 0) || (prio > bestPrio) || ((prio == bestPrio) &&
+                ((int)(_jobs[i].seq - _jobs[best].seq) < 0))) {
+                best = i;
+                bestPrio = prio;
+            }
+        }
+        if (best < 0)
+            break;
+        for (int i = 0; i < MAX_JOBS; i ++) {
+            if (_jobs[i].cb && (i != best) && (_jobs[i].age < (PRIO_HIGH * AGE_STEP)))
+                _jobs[i].age ++;
+        }
+        Job* job = &_jobs[best];
+        int id = job->id;
+        job->age = 0;
+        bool done = job->cb(job->param, _mdm);
+        // the job may have been cancelled by its step
+        if (job->cb && (job->id == id)) {
+            if (done)
+                job->cb = NULL;
+            else
+                job->seq = _seq++; // in turn with the jobs of the same priority
+        }
+    }
+    int num = queued();
+    if (num == 0)
+        _mdm->processUrc();
+    _busy = false;
+    return num;
+}
+
+int MDMArbiter::queued(void)
+{
+    int num = 0;
+    for (int i = 0; i < MAX_JOBS; i ++) {
+        if (_jobs[i].cb)
+            num ++;
+    }
+    return num;
+}
+
+bool MDMArbiter::sendStep(SendJob* job, MDMParser* mdm)
+{
+    int n = job->len - job->sent;
+    if (n > SEND_CHUNK)
+        n = SEND_CHUNK;
+    if (n > 0) {
+        int ret = mdm->socketSend(job->socket, job->buf + job->sent, n);
+        if (ret < 0) {
+            job->sent = SOCKET_ERROR;
+            return true;
+        }
+        job->sent += ret;
+    }
+    return (job->sent >= job->len);
+}
+
+bool MDMArbiter::smsStep(SmsJob* job, MDMParser* mdm)
+{
+    job->num = mdm->smsReadAll(job->stat, job->cb, job->param);
+    return true;
+}
+
+bool MDMArbiter::dnsStep(DnsJob* job, MDMParser* mdm)
+{
+    job->ip = mdm->gethostbyname(job->host);
+    return true;
+}
+
+bool MDMArbiter::statusStep(StatusJob* job, MDMParser* mdm)
+{
+    job->ok = mdm->checkNetStatus(&job->status);
+    return true;
+}
@@ -0,0 +1,162 @@
+#pragma once
+
+#include "mbed.h"
+#include "MDM.h"
+
+/** Cooperative arbiter that shares the modem between several tasks
+    without an RTOS.
+
+    Instead of calling the blocking modem functions directly, the tasks
+    post jobs. A job is a step function that does one short transaction
+    (e.g. one AT command or one chunk of a transfer) and returns whether
+    it is done, it is called again by the pump until then. The pump runs
+    one step at a time, the job with the highest priority first and jobs
+    of the same priority in turn, so that a short high priority command
+    runs between the chunks of a long transfer. Waiting jobs age and are
+    promoted, low priority jobs are not starved.
+    Steps should avoid long timeouts, e.g. use non blocking sockets and
+    #MDMParser::checkNetStatus instead of #MDMParser::registerNet.
+    Ready made steps send data, poll the messages, look up host names and
+    check the network status. A #LinkSupervisor runs as a job of its own
+    with #LinkSupervisor::pollStep.
+*/
+class MDMArbiter
+{
+public:
+    enum {
+        MAX_JOBS   = 8,    //!< number of queued jobs
+        AGE_STEP   = 8,    //!< steps waited to gain one priority level
+        SEND_CHUNK = 256   //!< bytes sent per step by #sendStep
+    };
+
+    //! job priorities
+    typedef enum { PRIO_LOW, PRIO_NORMAL, PRIO_HIGH } Prio;
+
+    /** step function of a job, it must not call #pump
+        \param param the argument passed to #post
+        \param mdm the modem
+        \return true if the job is done, false to be called again
+    */
+    typedef bool (*_JOBCB)(void* param, MDMParser* mdm);
+
+    /** Constructor
+        \param mdm the modem to share
+    */
+    MDMArbiter(MDMParser* mdm);
+
+    /** Queue a job
+        \param cb the step function
+        \param param the argument passed to the step function
+        \param prio the priority
+        \return the id of the job or -1 if the queue is full
+    */
+    int post(_JOBCB cb, void* param = NULL, Prio prio = PRIO_NORMAL);
+
+    /** template version of #post, this allows the compiler to do
+        type cheking of the callback argument.
+        \sa post
+    */
+    template<class T>
+    inline int post(bool (*cb)(T* param, MDMParser* mdm), T* param, Prio prio = PRIO_NORMAL)
+    {
+        return post((_JOBCB)cb, (void*)param, prio);
+    }
+
+    /** Check if a job is still queued
+        \param id the id returned by #post
+        \return true if queued, false if done or unknown
+    */
+    bool pending(int id);
+
+    /** Remove a job from the queue, its step function is not called again
+        \param id the id returned by #post
+        \return true if removed, false if done or unknown
+    */
+    bool cancel(int id);
+
+    /** Run steps of the queued jobs, the URCs are handled when the
+        queue is empty. Call this frequently from the main loop.
+        \param steps the maximum number of steps to run
+        \return the number of jobs still queued
+    */
+    int pump(int steps = 1);
+
+    /** Get the number of queued jobs
+        \return the number of jobs
+    */
+    int queued(void);
+
+    //! job argument for #sendStep
+    typedef struct {
+        int socket;       //!< the socket
+        const char* buf;  //!< the data to send
+        int len;          //!< the length of the data
+        int sent;         //!< bytes sent, SOCKET_ERROR on failure
+    } SendJob;
+
+    /** Step function that sends data on a socket in chunks of #SEND_CHUNK
+        \param job the job, sent must be 0 when posted
+        \param mdm the modem
+        \return true if all data is sent or on failure
+    */
+    static bool sendStep(SendJob* job, MDMParser* mdm);
+
+    //! job argument for #smsStep
+    typedef struct {
+        const char* stat;         //!< what type of messages to read, e.g. "REC UNREAD"
+        MDMParser::_SMSCB cb;     //!< called once per message
+        void* param;              //!< the argument passed to the callback
+        int num;                  //!< the number of messages, -1 on failure
+    } SmsJob;
+
+    /** Step function that polls the messages with one AT+CMGL
+        \param job the job
+        \param mdm the modem
+        \return true, it is done in one step
+    */
+    static bool smsStep(SmsJob* job, MDMParser* mdm);
+
+    //! job argument for #dnsStep
+    typedef struct {
+        const char* host;         //!< the host name to look up
+        MDMParser::IP ip;         //!< the ip address, NOIP on failure
+    } DnsJob;
+
+    /** Step function that looks up a host name
+        \param job the job
+        \param mdm the modem
+        \return true, it is done in one step
+    */
+    static bool dnsStep(DnsJob* job, MDMParser* mdm);
+
+    //! job argument for #statusStep
+    typedef struct {
+        MDMParser::NetStatus status; //!< the network status
+        bool ok;                  //!< registered to the network
+    } StatusJob;
+
+    /** Step function that checks the network status, this does not 
+        wait for the registration
+        \param job the job
+        \param mdm the modem
+        \return true, it is done in one step
+    */
+    static bool statusStep(StatusJob* job, MDMParser* mdm);
+
+protected:
+    //! a queued job, cb NULL is free
+    typedef struct {
+        int id;
+        _JOBCB cb;
+        void* param;
+        Prio prio;
+        int age;            //!< steps waited since the last run
+        unsigned int seq;   //!< position within the priority
+    } Job;
+
+    MDMParser* _mdm;        //!< the shared modem
+    Job _jobs[MAX_JOBS];    //!< the queue
+    int _id;                //!< the last job id
+    unsigned int _seq;      //!< the next position
+    bool _busy;             //!< a step is running
+};
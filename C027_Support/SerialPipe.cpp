@@ -7,6 +7,16 @@ SerialPipe::SerialPipe(PinName tx, PinName rx, int rxSize, int txSize) :
             _pipeRx( (rx!=NC) ? rxSize : 0), 
             _pipeTx( (tx!=NC) ? txSize : 0)
 {
+    _idleUs = 0;
+    _wakeUs = 0;
+    _preamble = EOF;
+    _wakePin = NULL;
+    _awake = true;
+    _held = false;
+    _wakeMeasure = false;
+    _last = _stateStart = us_ticker_read();
+    _stateUs = 0;
+    memset(&_wakeStats, 0, sizeof(_wakeStats));
     if (rx!=NC)
         attach(this, &SerialPipe::rxIrqBuf, RxIrq);
 }
@@ -15,6 +25,10 @@ SerialPipe::~SerialPipe(void)
 {
     attach(NULL, RxIrq);
     attach(NULL, TxIrq);
+    _wakeTimeout.detach();
+    _idleTimeout.detach();
+    if (_wakePin)
+        delete _wakePin;
 }
 
 // tx channel
@@ -59,6 +73,7 @@ void SerialPipe::txCopy(void)
     {
         char c = _pipeTx.getc();
         _SerialPipeBase::_base_putc(c);
+        _last = us_ticker_read();
     }
 }
 
@@ -72,6 +87,9 @@ void SerialPipe::txIrqBuf(void)
 
 void SerialPipe::txStart(void)
 {
+    // hold back the data while the peer wakes up
+    if (_idleUs && !txWakeup())
+        return;
     // disable the tx isr to avoid interruption
     attach(NULL, TxIrq);
     txCopy();
@@ -103,6 +121,21 @@ void SerialPipe::rxIrqBuf(void)
     while (_SerialPipeBase::readable())
     {
         char c = _SerialPipeBase::_base_getc();
+        _last = us_ticker_read();
+        // the first answer after a wake up ends the latency measurement
+        if (_wakeMeasure) {
+            unsigned int us = _last - _wakeStart;
+            _wakeStats.wakeUs = us;
+            if (us > _wakeStats.maxWakeUs)
+                _wakeStats.maxWakeUs = us;
+            _wakeMeasure = false;
+        }
+        // the peer talks so it is awake
+        if (_idleUs && !_awake && !_held) {
+            txAccount(_last);
+            _awake = true;
+            _idleTimeout.attach_us(this, &SerialPipe::txIdleCheck, _idleUs);
+        }
         if (_pipeRx.writeable())
             _pipeRx.putc(c);
         else 
@@ -110,3 +143,106 @@ void SerialPipe::rxIrqBuf(void)
     }
 }
 
+// tx wake up
+void SerialPipe::setTxWakeup(int idle_us, int wake_us, int preamble, PinName wake)
+{
+    _idleTimeout.detach();
+    _wakeTimeout.detach();
+    if (_wakePin) {
+        delete _wakePin;
+        _wakePin = NULL;
+    }
+    txAccount(us_ticker_read());
+    _idleUs = idle_us;
+    _wakeUs = wake_us;
+    _preamble = preamble;
+    // assert the wake pin, the peer is assumed to be awake now
+    if (idle_us && (wake != NC))
+        _wakePin = new DigitalOut(wake, 0);
+    _awake = true;
+    _held = false;
+    _wakeMeasure = false;
+    _last = us_ticker_read();
+    if (_idleUs)
+        _idleTimeout.attach_us(this, &SerialPipe::txIdleCheck, _idleUs);
+    // release any data that was held back
+    if (_pipeTx.readable())
+        txStart();
+}
+
+void SerialPipe::getWakeStats(WakeStats* stats)
+{
+    __disable_irq();
+    txAccount(us_ticker_read());
+    *stats = _wakeStats;
+    __enable_irq();
+}
+
+bool SerialPipe::txWakeup(void)
+{
+    bool start = false;
+    __disable_irq();
+    if (!_awake && !_held) {
+        unsigned int now = us_ticker_read();
+        txAccount(now);
+        _awake = true;
+        _held = (_wakeUs != 0);
+        _last = _wakeStart = now;
+        _wakeMeasure = true;
+        _wakeStats.wakeups ++;
+        start = true;
+    }
+    bool awake = !_held;
+    __enable_irq();
+    if (start) {
+        if (_wakePin)
+            *_wakePin = 0;
+        if (_preamble != EOF)
+            _SerialPipeBase::_base_putc(_preamble);
+        if (_wakeUs)
+            _wakeTimeout.attach_us(this, &SerialPipe::txWoken, _wakeUs);
+        _idleTimeout.attach_us(this, &SerialPipe::txIdleCheck, _wakeUs + _idleUs);
+    }
+    return awake;
+}
+
+void SerialPipe::txWoken(void)
+{
+    _last = us_ticker_read();
+    _held = false;
+    txStart();
+}
+
+void SerialPipe::txIdleCheck(void)
+{
+    unsigned int now = us_ticker_read();
+    if (_awake) {
+        unsigned int idle = now - _last;
+        if (_held || _pipeTx.readable() || (idle < (unsigned int)_idleUs)) {
+            unsigned int us = (idle < (unsigned int)_idleUs) ? _idleUs - idle : _idleUs;
+            _idleTimeout.attach_us(this, &SerialPipe::txIdleCheck, us);
+            return;
+        }
+        // the peer went to sleep, release the wake pin
+        txAccount(now);
+        _awake = false;
+        if (_wakePin)
+            *_wakePin = 1;
+    } else
+        txAccount(now);
+    // fold the sleeping time regularly as the us ticker wraps after 71 minutes
+    _idleTimeout.attach_us(this, &SerialPipe::txIdleCheck, 60000000);
+}
+
+void SerialPipe::txAccount(unsigned int now)
+{
+    unsigned int us = (now - _stateStart) + _stateUs;
+    _stateStart = now;
+    if (!_idleUs) {
+        _stateUs = 0;
+        return;
+    }
+    _stateUs = us % 1000;
+    if (_awake) _wakeStats.awakeMs += us / 1000;
+    else        _wakeStats.sleepMs += us / 1000;
+}
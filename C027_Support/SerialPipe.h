@@ -66,6 +66,36 @@ public:
     */
     int get(void* buffer, int length, bool blocking);
     
+    // tx wake up
+    //----------------------------------------------------
+    
+    /** Gate the transmit channel for a peer that sleeps while the link 
+        is idle. Before the first byte after an idle period the wake pin 
+        is asserted (active low) or the preamble is sent and the queued 
+        data is held back until the wake up time has passed.
+        \param idle_us the idle time after which the peer sleeps, 0 disables the gating
+        \param wake_us the wake up time of the peer, 0 if the peer 
+               gates the transmission itself (CTS)
+        \param preamble the character sent to wake the peer, EOF if none
+        \param wake the wake up pin (e.g. DTR), NC if none
+    */
+    void setTxWakeup(int idle_us, int wake_us = 0, int preamble = EOF, PinName wake = NC);
+    
+    //! tx wake up statistics
+    typedef struct { 
+        unsigned int wakeups;   //!< number of times the peer was woken up
+        unsigned int wakeUs;    //!< time from the last wake up (pin or preamble) to the
+                                //!< first received byte in us, includes the reply time
+        unsigned int maxWakeUs; //!< worst of these times in us
+        unsigned int awakeMs;   //!< time the peer was awake in ms
+        unsigned int sleepMs;   //!< time the peer was sleeping in ms
+    } WakeStats;
+    
+    /** get the tx wake up statistics
+        \param stats the statistics to fill
+    */
+    void getWakeStats(WakeStats* stats);
+    
 protected:
     //! receive interrupt routine
     void rxIrqBuf(void);
@@ -75,6 +105,29 @@ protected:
     void txStart(void);
     //! move bytes to hardware
     void txCopy(void);
+    //! wake up the peer if needed, returns true if awake 
+    bool txWakeup(void);
+    //! wake up time of the peer has passed
+    void txWoken(void);
+    //! check if the peer went to sleep
+    void txIdleCheck(void);
+    //! account the time spent in the current state
+    void txAccount(unsigned int now);
     Pipe<char> _pipeRx; //!< receive pipe
     Pipe<char> _pipeTx; //!< transmit pipe
+    // tx wake up 
+    int _idleUs;                //!< idle time after which the peer sleeps, 0 if disabled
+    int _wakeUs;                //!< wake up time of the peer
+    int _preamble;              //!< wake up character or EOF
+    DigitalOut* _wakePin;       //!< wake up pin or NULL
+    Timeout _wakeTimeout;       //!< wake up timer
+    Timeout _idleTimeout;       //!< idle check timer
+    volatile bool _awake;       //!< the peer is assumed to be awake
+    volatile bool _held;        //!< the tx data is held back 
+    volatile unsigned int _last;//!< time of the last activity on the link
+    unsigned int _wakeStart;    //!< time the last wake up was started
+    volatile bool _wakeMeasure; //!< waiting for the first byte after a wake up
+    unsigned int _stateStart;   //!< time the current state was entered
+    unsigned int _stateUs;      //!< fraction of a ms not yet accounted
+    WakeStats _wakeStats;       //!< the statistics
 };
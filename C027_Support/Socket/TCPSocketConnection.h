@@ -10,9 +10,86 @@ class TCPSocketConnection: public Socket
     friend class TCPSocketServer;
 
 public:
+    //! the maximum size of coalesced writes, the size of one AT+USOWR 
+    enum { MAX_COALESCE = 1024 };
+    
     /** TCP socket connection
     */
-    TCPSocketConnection() {}
+    TCPSocketConnection() {
+        _txBuf = NULL;
+        _txLen = 0;
+        _txSize = 0;
+        _txDelay_ms = 0;
+        _secure = -1;
+    }
+    
+    ~TCPSocketConnection() { close(); }
+    
+    /** Use TLS for the connection, the encryption is done by the modem 
+        with one of its security profiles. Has to be set before connect.
+    \param secure true to use TLS 
+    \param profile the security profile of the modem
+    */
+    void set_secure(bool secure, int profile = 0) { _secure = secure ? profile : -1; }
+    
+    /** Combine small writes into one transfer to the modem, in a buffer 
+        of the caller. The held back data is sent when the buffer is full, 
+        before receiving, on close and by send, poll or flush once the delay 
+        has passed. No timer sends it by itself, the modem can not be used 
+        from an interrupt, so call poll regularly while data may be held back.
+    \param delay_ms the time small writes are held back, 0 disables coalescing
+    \param buf the buffer, it must remain valid until coalescing is disabled
+    \param size the size of the buffer, the number of bytes sent at once (up to MAX_COALESCE)
+    \return 0 on success, -1 if the pending data could not be sent
+    */
+    int set_coalescing(int delay_ms, char* buf = NULL, int size = 0)
+    {
+        int ret = flush();
+        if (size > MAX_COALESCE) size = MAX_COALESCE;
+        if ((delay_ms <= 0) || !buf || (size < 1)) {
+            delay_ms = 0;
+            buf = NULL;
+            size = 0;
+        }
+        _txBuf = buf;
+        _txSize = size;
+        _txDelay_ms = delay_ms;
+        return ret;
+    }
+    
+    /** Send the held back data once the delay has passed.
+    \return 0 on success, -1 on failure.
+    */
+    int poll(void)
+    {
+        if (_txLen && (_txTimer.read_ms() >= _txDelay_ms))
+            return flush();
+        return 0;
+    }
+    
+    /** Send the coalesced data to the remote host.
+    \return 0 on success, -1 on failure.
+    */
+    int flush(void)
+    {
+        if (_txLen == 0)
+            return 0;
+        if (_mdm->socketSend(_socket, _txBuf, _txLen) != _txLen)
+            return -1;
+        _txLen = 0;
+        return 0;
+    }
+    
+    /** Close the socket, pending coalesced data is sent before.
+    \return 0 on success, -1 on failure.
+    */
+    int close()
+    {
+        if (_socket >= 0)
+            flush();
+        _txLen = 0;
+        return Socket::close();
+    }
 
     /** Connects this TCP socket to the server
     \param host The host to connect to. It can either be an IP Address or a hostname that will be resolved with DNS.
@@ -31,6 +108,10 @@ public:
             if (_socket < 0) {
                 return -1;
             }
+            if ((_secure >= 0) && !_mdm->socketSecure(_socket, _secure)) {
+                close();
+                return -1;
+            }
         }
     
         _mdm->socketSetBlocking(_socket, _timeout_ms); 
@@ -49,7 +130,24 @@ public:
     \param length The length of the buffer to send.
     \return the number of written bytes on success (>=0) or -1 on failure
      */
-    int send(char* data, int length)        { return _mdm->socketSend(_socket, data, length); }
+    int send(char* data, int length)
+    {
+        // send the held back data if it is due or the new data does not fit
+        if (_txLen && ((_txDelay_ms == 0) || (_txTimer.read_ms() >= _txDelay_ms) || 
+                       (_txLen + length > _txSize)) && (flush() < 0))
+            return -1;
+        if ((_txDelay_ms == 0) || (length >= _txSize))
+            return _mdm->socketSend(_socket, data, length);
+        if (_txLen == 0) {
+            _txTimer.reset();
+            _txTimer.start();
+        }
+        memcpy(_txBuf + _txLen, data, length);
+        _txLen += length;
+        if ((_txLen == _txSize) && (flush() < 0))
+            return -1;
+        return length;
+    }
 
     /** Send all the data to the remote host.
     \param data The buffer to send to the host.
@@ -63,7 +161,13 @@ public:
     \param length The maximum length of the buffer.
     \return the number of received bytes on success (>=0) or -1 on failure
      */
-    int receive(char* data, int length)     { return _mdm->socketRecv(_socket, data, length); }
+    int receive(char* data, int length)
+    {
+        // the peer usually waits for what we held back
+        if (flush() < 0)
+            return -1;
+        return _mdm->socketRecv(_socket, data, length);
+    }
 
     /** Receive all the data from the remote host.
     \param data The buffer in which to store the data received from the host.
@@ -72,6 +176,13 @@ public:
     */
     int receive_all(char* data, int length) { return receive(data,length); }
     
+protected:
+    char* _txBuf;       //!< the coalescing buffer of the caller, NULL if disabled
+    int _txLen;         //!< the number of bytes held back 
+    int _txSize;        //!< the size of the coalescing buffer 
+    int _txDelay_ms;    //!< the time small writes are held back, 0 if disabled
+    Timer _txTimer;     //!< measures the time since the first held back byte
+    int _secure;        //!< the security profile, -1 if not secure
 };
 
 #endif
@@ -0,0 +1,437 @@
+#include "mbed.h"
+#include "CoAPClient.h"
+
+#define COAP_VERSION     0x40 //!< version 1 in the first header byte
+#define COAP_PAYLOAD     0xFF //!< the payload marker
+#define BLOCK_MORE       0x08 //!< more flag of the block options
+
+// check if a message carries the given token
+static bool isToken(const void* msg, int tkl, const char* token)
+{
+    return (tkl == CoAPClient::TOKEN_LEN) && (0 == memcmp(msg, token, tkl));
+}
+
+CoAPClient::CoAPClient(void)
+{
+    _open = false;
+    _mid = 0;
+    _tokenSeq = 0;
+    memset(_obs, 0, sizeof(_obs));
+}
+
+bool CoAPClient::connect(const char* host, int port /*= 5683*/)
+{
+    close();
+    // start with a random message id and token to not collide with a
+    // previous run towards the same server, rand is not seeded at boot
+    MDMParser* mdm = MDMParser::getInstance();
+    unsigned int seed = mdm ? mdm->entropy() : us_ticker_read();
+    _mid = seed;
+    _tokenSeq = seed >> 16;
+    if ((_socket.init() < 0) || (_socket.bind(-1) < 0))
+        return false;
+    if (_ep.set_address(host, port) < 0) {
+        _socket.close();
+        return false;
+    }
+    _open = true;
+    return true;
+}
+
+int CoAPClient::request(Method method, const char* path, const void* payload /*= NULL*/,
+                        int len /*= 0*/, char* buf /*= NULL*/, int* size /*= NULL*/,
+                        int format /*= FORMAT_NONE*/, bool confirmable /*= true*/)
+{
+    int max = (buf && size) ? *size : 0;
+    if (size) *size = 0;
+    if (!_open)
+        return -1;
+    char token[TOKEN_LEN];
+    _newToken(token);
+    if (!confirmable && (len <= BLOCK_SIZE)) {
+        // fire and forget, one datagram
+        int n = _build(TYPE_NON, method, ++_mid, token, path, -1, format, -1, -1, payload, len);
+        return ((n > 0) && _send(_tx, n)) ? 0 : -1;
+    }
+    Msg rsp;
+    // upload larger payloads block by block, the server may ask for smaller blocks
+    int szx = BLOCK_SZX;
+    int off = 0;
+    do {
+        int bs = 16 << szx;
+        int blk = len - off;
+        bool more = (blk > bs);
+        if (more) blk = bs;
+        int block1 = (len > BLOCK_SIZE) ? (((off / bs) << 4) | (more ? BLOCK_MORE : 0) | szx) : -1;
+        // with the last request tell the server the block size of the response
+        int block2 = more ? -1 : RX_BLOCK_SZX;
+        if (!_exchange(method, path, -1, format, block1, block2, (const char*)payload + off, blk, token, &rsp))
+            return -1;
+        if (more) {
+            if (rsp.code != CODE_CONTINUE)
+                return rsp.code;
+            if ((rsp.block1 >= 0) && ((rsp.block1 & 7) < szx))
+                szx = rsp.block1 & 7;
+        }
+        off += blk;
+    } while (off < len);
+    // collect the response, fetch the following blocks while there is space
+    int got = 0;
+    for (;;) {
+        int n = rsp.len;
+        if (n > max - got) n = max - got;
+        if (n > 0) {
+            memcpy(buf + got, rsp.payload, n);
+            got += n;
+        }
+        if ((rsp.block2 < 0) || !(rsp.block2 & BLOCK_MORE) || (got >= max))
+            break;
+        int code = rsp.code;
+        int block2 = (((rsp.block2 >> 4) + 1) << 4) | (rsp.block2 & 7);
+        if (!_exchange(method, path, -1, FORMAT_NONE, -1, block2, NULL, 0, token, &rsp))
+            return -1;
+        if (rsp.code != code)
+            break; // the resource changed or the server gave up
+    }
+    if (size) *size = got;
+    return rsp.code;
+}
+
+bool CoAPClient::observe(const char* path, _OBSCB cb, void* param /*= NULL*/)
+{
+    int slot = -1;
+    for (int i = 0; (i < MAX_OBSERVE) && (slot < 0); i ++) {
+        if (!_obs[i].path)
+            slot = i;
+    }
+    if (!_open || (slot < 0))
+        return false;
+    char token[TOKEN_LEN];
+    _newToken(token);
+    Msg rsp;
+    if (!_exchange(METHOD_GET, path, 0, FORMAT_NONE, -1, RX_BLOCK_SZX, NULL, 0, token, &rsp))
+        return false;
+    if (cb)
+        cb(param, rsp.code, rsp.payload, rsp.len);
+    // without the observe option the server does not support it
+    if ((rsp.observe < 0) || ((rsp.code >> 5) != 2))
+        return false;
+    _obs[slot].path = path;
+    memcpy(_obs[slot].token, token, TOKEN_LEN);
+    _obs[slot].mid = rsp.mid;
+    _obs[slot].cb = cb;
+    _obs[slot].param = param;
+    return true;
+}
+
+bool CoAPClient::cancel(const char* path)
+{
+    for (int i = 0; i < MAX_OBSERVE; i ++) {
+        if (_obs[i].path && (0 == strcmp(_obs[i].path, path))) {
+            _obs[i].path = NULL;
+            // deregister with the token of the observation
+            Msg rsp;
+            return _open && _exchange(METHOD_GET, path, 1, FORMAT_NONE, -1, -1,
+                                      NULL, 0, _obs[i].token, &rsp);
+        }
+    }
+    return false;
+}
+
+bool CoAPClient::yield(int timeout_ms /*= 0*/)
+{
+    if (!_open)
+        return false;
+    int n = _recv(timeout_ms);
+    while (n > 0) {
+        Msg msg;
+        if (_parse(_rx, n, &msg))
+            _dispatch(&msg);
+        n = _recv(0);
+    }
+    return (n == 0);
+}
+
+void CoAPClient::close(void)
+{
+    memset(_obs, 0, sizeof(_obs));
+    _open = false;
+    _socket.close();
+}
+
+// ----------------------------------------------------------------
+
+bool CoAPClient::_exchange(int code, const char* path, int observe, int format,
+                           int block1, int block2, const void* payload, int len,
+                           const char* token, Msg* rsp)
+{
+    unsigned short mid = ++_mid;
+    int n = _build(TYPE_CON, code, mid, token, path, observe, format, block1, block2, payload, len);
+    if (n < 0)
+        return false;
+    // random initial timeout, doubled with every retransmission
+    int timeout = ACK_TIMEOUT_MS + rand() % (ACK_TIMEOUT_MS / 2);
+    bool acked = false;
+    Timer timer;
+    timer.start();
+    for (int retry = 0; !acked; retry ++) {
+        if ((retry > MAX_RETRANSMIT) || !_send(_tx, n))
+            return false;
+        timer.reset();
+        int left;
+        while (!acked && ((left = timeout - timer.read_ms()) > 0)) {
+            int r = _recv(left);
+            if (r < 0)
+                return false;
+            if ((r == 0) || !_parse(_rx, r, rsp))
+                continue;
+            if ((rsp->mid == mid) && (rsp->type == TYPE_RST))
+                return false;
+            if ((rsp->mid == mid) && (rsp->type == TYPE_ACK)) {
+                // piggybacked response, else the response follows separately
+                if (rsp->code != 0)
+                    return isToken(rsp->token, rsp->tkl, token);
+                acked = true;
+            } else if ((rsp->type != TYPE_ACK) && rsp->code && isToken(rsp->token, rsp->tkl, token)) {
+                // separate response that overtook the lost empty ACK
+                if (rsp->type == TYPE_CON)
+                    _reply(TYPE_ACK, rsp->mid);
+                return true;
+            } else
+                _dispatch(rsp);
+        }
+        timeout *= 2;
+    }
+    timer.reset();
+    int left;
+    while ((left = SEPARATE_MS - timer.read_ms()) > 0) {
+        int r = _recv(left);
+        if (r < 0)
+            return false;
+        if ((r == 0) || !_parse(_rx, r, rsp))
+            continue;
+        if ((rsp->type != TYPE_ACK) && rsp->code && isToken(rsp->token, rsp->tkl, token)) {
+            if (rsp->type == TYPE_CON)
+                _reply(TYPE_ACK, rsp->mid);
+            return true;
+        }
+        _dispatch(rsp);
+    }
+    return false;
+}
+
+int CoAPClient::_build(int type, int code, unsigned short mid, const char* token,
+                       const char* path, int observe, int format,
+                       int block1, int block2, const void* payload, int len)
+{
+    const char* end = _tx + sizeof(_tx);
+    char* p = _tx;
+    *p++ = COAP_VERSION | (type << 4) | TOKEN_LEN;
+    *p++ = code;
+    *p++ = mid >> 8;
+    *p++ = mid & 0xFF;
+    memcpy(p, token, TOKEN_LEN);
+    p += TOKEN_LEN;
+    // the options in ascending order, the query follows the content format
+    int last = 0;
+    if (observe >= 0)
+        p = _putUint(p, end, &last, OPT_OBSERVE, observe);
+    if (*path == '/')
+        path ++;
+    const char* query = strchr(path, '?');
+    const char* pe = query ? query : path + strlen(path);
+    p = _putList(p, end, &last, OPT_URI_PATH, path, pe, '/');
+    if (format >= 0)
+        p = _putUint(p, end, &last, OPT_CONTENT_FORMAT, format);
+    if (query)
+        p = _putList(p, end, &last, OPT_URI_QUERY, query + 1, query + 1 + strlen(query + 1), '&');
+    if (block2 >= 0)
+        p = _putUint(p, end, &last, OPT_BLOCK2, block2);
+    if (block1 >= 0)
+        p = _putUint(p, end, &last, OPT_BLOCK1, block1);
+    if (p && (len > 0)) {
+        if (p + 1 + len > end)
+            return -1;
+        *p++ = COAP_PAYLOAD;
+        memcpy(p, payload, len);
+        p += len;
+    }
+    return p ? (p - _tx) : -1;
+}
+
+bool CoAPClient::_send(const char* buf, int len)
+{
+    return (_socket.sendTo(_ep, (char*)buf, len) == len);
+}
+
+bool CoAPClient::_reply(int type, unsigned short mid)
+{
+    char buf[4];
+    buf[0] = COAP_VERSION | (type << 4);
+    buf[1] = 0;
+    buf[2] = mid >> 8;
+    buf[3] = mid & 0xFF;
+    return _send(buf, sizeof(buf));
+}
+
+int CoAPClient::_recv(int timeout_ms)
+{
+    Endpoint ep;
+    _socket.set_blocking(false, timeout_ms);
+    int n = _socket.receiveFrom(ep, _rx, sizeof(_rx));
+    if (n <= MAX_MESSAGE)
+        return n;
+    // the datagram does not fit, drop what is left of it
+    _socket.set_blocking(false, 0);
+    while (_socket.receiveFrom(ep, _rx, sizeof(_rx)) == (int)sizeof(_rx))
+        /*nothing*/;
+    return 0;
+}
+
+void CoAPClient::_dispatch(const Msg* msg)
+{
+    // stale acknowledges and resets of earlier exchanges
+    if ((msg->type == TYPE_ACK) || (msg->type == TYPE_RST))
+        return;
+    int i;
+    for (i = 0; i < MAX_OBSERVE; i ++) {
+        if (_obs[i].path && msg->code && isToken(msg->token, msg->tkl, _obs[i].token))
+            break;
+    }
+    if (i == MAX_OBSERVE) {
+        // pings and messages we do not expect, this also stops the
+        // notifications of forgotten observations
+        _reply(TYPE_RST, msg->mid);
+        return;
+    }
+    if (msg->type == TYPE_CON)
+        _reply(TYPE_ACK, msg->mid);
+    // a retransmission of a notification we already have
+    if (msg->mid == _obs[i].mid)
+        return;
+    _obs[i].mid = msg->mid;
+    // a response without the observe option ends the observation
+    if (msg->observe < 0)
+        _obs[i].path = NULL;
+    if (_obs[i].cb)
+        _obs[i].cb(_obs[i].param, msg->code, msg->payload, msg->len);
+}
+
+void CoAPClient::_newToken(char* token)
+{
+    unsigned int t = (++_tokenSeq) ^ ((unsigned int)rand() << 16);
+    for (int i = 0; i < TOKEN_LEN; i ++) {
+        token[i] = t & 0xFF;
+        t >>= 8;
+    }
+}
+
+// read the extended option delta or length
+static bool getExt(const char** p, const char* end, int* v)
+{
+    if (*v == 13) {
+        if (*p + 1 > end) return false;
+        *v = 13 + ((*p)[0] & 0xFF);
+        *p += 1;
+    } else if (*v == 14) {
+        if (*p + 2 > end) return false;
+        *v = 269 + ((((*p)[0] & 0xFF) << 8) | ((*p)[1] & 0xFF));
+        *p += 2;
+    } else if (*v == 15)
+        return false;
+    return true;
+}
+
+bool CoAPClient::_parse(const char* buf, int len, Msg* msg)
+{
+    if ((len < 4) || ((buf[0] & 0xC0) != COAP_VERSION))
+        return false;
+    msg->type = (buf[0] >> 4) & 3;
+    msg->tkl = buf[0] & 0x0F;
+    msg->code = buf[1] & 0xFF;
+    msg->mid = ((buf[2] & 0xFF) << 8) | (buf[3] & 0xFF);
+    msg->observe = msg->block1 = msg->block2 = -1;
+    msg->payload = NULL;
+    msg->len = 0;
+    const char* p = buf + 4;
+    const char* end = buf + len;
+    if ((msg->tkl > 8) || (p + msg->tkl > end))
+        return false;
+    memcpy(msg->token, p, msg->tkl);
+    p += msg->tkl;
+    int num = 0;
+    while (p < end) {
+        int c = *p++ & 0xFF;
+        if (c == COAP_PAYLOAD) {
+            msg->payload = p;
+            msg->len = end - p;
+            break;
+        }
+        int d = c >> 4;
+        int l = c & 0x0F;
+        if (!getExt(&p, end, &d) || !getExt(&p, end, &l) || (p + l > end))
+            return false;
+        num += d;
+        int v = 0;
+        for (int i = 0; (i < l) && (i < 3); i ++)
+            v = (v << 8) | (p[i] & 0xFF);
+        if (num == OPT_OBSERVE)      msg->observe = v;
+        else if (num == OPT_BLOCK2)  msg->block2 = v;
+        else if (num == OPT_BLOCK1)  msg->block1 = v;
+        p += l;
+    }
+    return true;
+}
+
+// write the extended option delta or length, returns the nibble
+static int putExt(char** p, int v)
+{
+    if (v < 13)
+        return v;
+    if (v < 269) {
+        *(*p)++ = v - 13;
+        return 13;
+    }
+    v -= 269;
+    *(*p)++ = v >> 8;
+    *(*p)++ = v & 0xFF;
+    return 14;
+}
+
+char* CoAPClient::_putOpt(char* p, const char* end, int* last, int num, const void* val, int len)
+{
+    if (!p || (p + 5 + len > end))
+        return NULL;
+    char* h = p++;
+    int d = putExt(&p, num - *last);
+    int l = putExt(&p, len);
+    *h = (d << 4) | l;
+    memcpy(p, val, len);
+    *last = num;
+    return p + len;
+}
+
+char* CoAPClient::_putUint(char* p, const char* end, int* last, int num, unsigned int val)
+{
+    // minimal big endian encoding, zero has no bytes
+    char b[4];
+    int n = 0;
+    for (int s = 24; s >= 0; s -= 8) {
+        if (n || ((val >> s) & 0xFF))
+            b[n++] = (val >> s) & 0xFF;
+    }
+    return _putOpt(p, end, last, num, b, n);
+}
+
+char* CoAPClient::_putList(char* p, const char* end, int* last, int num,
+                           const char* s, const char* e, char sep)
+{
+    while (p && (s < e)) {
+        const char* n = s;
+        while ((n < e) && (*n != sep))
+            n ++;
+        p = _putOpt(p, end, last, num, s, n - s);
+        s = n + 1;
+    }
+    return p;
+}
@@ -0,0 +1,235 @@
+#pragma once
+
+#include "mbed.h"
+#include "UDPSocket.h"
+
+/** Minimal CoAP (RFC 7252) client on top of a modem UDP socket.
+
+    A report is a single confirmable datagram that is acknowledged by the
+    server, there is no connection setup. Confirmable requests are sent
+    again with exponential back-off until acknowledged, responses are
+    matched by token, piggybacked and separate responses are supported.
+    Payloads larger than one block are transferred with Block1 (RFC 7959),
+    the requests ask for responses in blocks of 16 << #RX_BLOCK_SZX bytes
+    and the following blocks are collected with Block2. Datagrams larger
+    than #MAX_MESSAGE are dropped. Resources can be observed
+    (RFC 7641), the notifications are delivered by #yield.
+    All messages are built in static buffers, no heap is used.
+*/
+class CoAPClient
+{
+public:
+    enum {
+        MAX_MESSAGE     = 256,   //!< largest message sent or received
+        BLOCK_SZX       = 3,     //!< block size exponent, the block size is 16 << BLOCK_SZX
+        BLOCK_SIZE      = 16 << BLOCK_SZX, //!< the block size
+        RX_BLOCK_SZX    = 2,     //!< block size exponent asked for the responses, a
+                                 //!< block must fit into one modem read of 128 bytes
+        MAX_OBSERVE     = 2,     //!< number of observed resources
+        TOKEN_LEN       = 4,     //!< length of the tokens
+        ACK_TIMEOUT_MS  = 2000,  //!< initial retransmission timeout
+        MAX_RETRANSMIT  = 4,     //!< number of retransmissions
+        SEPARATE_MS     = 30000  //!< time to wait for a separate response
+    };
+
+    //! request methods
+    typedef enum { METHOD_GET = 1, METHOD_POST = 2, METHOD_PUT = 3, METHOD_DELETE = 4 } Method;
+
+    //! response codes (class << 5 | detail)
+    enum {
+        CODE_CREATED  = 0x41, //!< 2.01
+        CODE_DELETED  = 0x42, //!< 2.02
+        CODE_VALID    = 0x43, //!< 2.03
+        CODE_CHANGED  = 0x44, //!< 2.04
+        CODE_CONTENT  = 0x45, //!< 2.05
+        CODE_CONTINUE = 0x5F  //!< 2.31
+    };
+
+    //! content formats
+    enum {
+        FORMAT_NONE   = -1,
+        FORMAT_TEXT   = 0,
+        FORMAT_OCTET  = 42,
+        FORMAT_JSON   = 50,
+        FORMAT_CBOR   = 60
+    };
+
+    /** callback function for notifications of observed resources
+        \param param the argument passed to #observe
+        \param code the response code
+        \param payload the payload of the notification
+        \param len the length of the payload
+    */
+    typedef void (*_OBSCB)(void* param, int code, const char* payload, int len);
+
+    //! Constructor
+    CoAPClient(void);
+
+    /** Open a socket for the exchanges with a server
+        \param host the server name or ip
+        \param port the server port
+        \return true if successful, false otherwise
+    */
+    bool connect(const char* host, int port = 5683);
+
+    /** Send a request and wait for the response
+        \param method the request method
+        \param path the uri path with optional query, e.g. "/sensors/temp?unit=C"
+        \param payload the request payload
+        \param len the length of the payload, sent with Block1 if larger than #BLOCK_SIZE
+        \param buf the buffer for the response payload, fetched with Block2 if needed
+        \param size in: the size of buf, out: the length of the response payload
+        \param format the content format of the payload
+        \param confirmable use a confirmable message, a non-confirmable request
+               is sent once and not waited for
+        \return the response code, 0 for non-confirmable requests, -1 on failure
+    */
+    int request(Method method, const char* path, const void* payload = NULL, int len = 0,
+                char* buf = NULL, int* size = NULL, int format = FORMAT_NONE,
+                bool confirmable = true);
+
+    /** Get a resource
+        \param path the uri path
+        \param buf the buffer for the response payload
+        \param size in: the size of buf, out: the length of the payload
+        \return the response code or -1 on failure
+    */
+    int get(const char* path, char* buf, int* size)
+    {
+        return request(METHOD_GET, path, NULL, 0, buf, size);
+    }
+
+    /** Post a payload, e.g. report a sample
+        \param path the uri path
+        \param payload the payload
+        \param len the length of the payload
+        \param format the content format of the payload
+        \param confirmable use a confirmable message
+        \return the response code, 0 for non-confirmable requests, -1 on failure
+    */
+    int post(const char* path, const void* payload, int len,
+             int format = FORMAT_NONE, bool confirmable = true)
+    {
+        return request(METHOD_POST, path, payload, len, NULL, NULL, format, confirmable);
+    }
+
+    /** Put a payload
+        \param path the uri path
+        \param payload the payload
+        \param len the length of the payload
+        \param format the content format of the payload
+        \return the response code or -1 on failure
+    */
+    int put(const char* path, const void* payload, int len, int format = FORMAT_NONE)
+    {
+        return request(METHOD_PUT, path, payload, len, NULL, NULL, format);
+    }
+
+    /** Observe a resource, the current state and all notifications are
+        passed to the callback. The callback must not send requests.
+        \param path the uri path, must remain valid while observed
+        \param cb the callback for the notifications
+        \param param the argument passed to the callback
+        \return true if the server accepted the observation, false otherwise
+    */
+    bool observe(const char* path, _OBSCB cb, void* param = NULL);
+
+    /** template version of #observe, this allows the compiler to do
+        type cheking of the callback argument.
+        \sa observe
+    */
+    template<class T>
+    inline bool observe(const char* path,
+                    void (*cb)(T* param, int code, const char* payload, int len),
+                    T* param)
+    {
+        return observe(path, (_OBSCB)cb, (void*)param);
+    }
+
+    /** Stop observing a resource
+        \param path the uri path passed to #observe
+        \return true if successful, false otherwise
+    */
+    bool cancel(const char* path);
+
+    /** Receive and dispatch the notifications of observed resources
+        \param timeout_ms the time to wait for incoming data
+        \return true if successful, false on a socket error
+    */
+    bool yield(int timeout_ms = 0);
+
+    /** Close the socket, observations are forgotten
+    */
+    void close(void);
+
+protected:
+    //! message types
+    enum { TYPE_CON = 0, TYPE_NON = 1, TYPE_ACK = 2, TYPE_RST = 3 };
+    //! option numbers
+    enum {
+        OPT_OBSERVE = 6,
+        OPT_URI_PATH = 11,
+        OPT_CONTENT_FORMAT = 12,
+        OPT_URI_QUERY = 15,
+        OPT_BLOCK2 = 23,
+        OPT_BLOCK1 = 27
+    };
+    //! a parsed message, options not present are -1
+    typedef struct {
+        int type;
+        int code;
+        unsigned short mid;
+        int tkl;
+        char token[8];
+        int observe;
+        int block1;
+        int block2;
+        const char* payload;
+        int len;
+    } Msg;
+    //! an observed resource
+    typedef struct {
+        const char* path;
+        char token[TOKEN_LEN];
+        int mid;        //!< last notification, to drop duplicates
+        _OBSCB cb;
+        void* param;
+    } Obs;
+
+    //! send a confirmable request and wait for the response with the token
+    bool _exchange(int code, const char* path, int observe, int format,
+                   int block1, int block2, const void* payload, int len,
+                   const char* token, Msg* rsp);
+    //! build a message in the transmit buffer, returns its size or -1
+    int _build(int type, int code, unsigned short mid, const char* token,
+               const char* path, int observe, int format,
+               int block1, int block2, const void* payload, int len);
+    //! send a datagram to the server
+    bool _send(const char* buf, int len);
+    //! send an empty ACK or RST
+    bool _reply(int type, unsigned short mid);
+    //! receive a datagram, returns its size, 0 on timeout, -1 on failure
+    int _recv(int timeout_ms);
+    //! handle a message that is not the response of a pending exchange
+    void _dispatch(const Msg* msg);
+    //! make a new token
+    void _newToken(char* token);
+    //! parse a message
+    static bool _parse(const char* buf, int len, Msg* msg);
+    //! write an option
+    static char* _putOpt(char* p, const char* end, int* last, int num, const void* val, int len);
+    //! write an unsigned integer option
+    static char* _putUint(char* p, const char* end, int* last, int num, unsigned int val);
+    //! write one option per element of a separated list
+    static char* _putList(char* p, const char* end, int* last, int num,
+                          const char* s, const char* e, char sep);
+
+    UDPSocket _socket;            //!< the socket
+    Endpoint _ep;                 //!< the server
+    bool _open;                   //!< the socket is open
+    unsigned short _mid;          //!< the last message id
+    unsigned int _tokenSeq;       //!< counter for the tokens
+    Obs _obs[MAX_OBSERVE];        //!< the observed resources, path NULL is free
+    char _tx[MAX_MESSAGE];        //!< the transmit buffer, kept for retransmissions
+    char _rx[MAX_MESSAGE + 1];    //!< the receive buffer, one more to find oversized datagrams
+};
@@ -0,0 +1,421 @@
+#include "mbed.h"
+#include "MQTTClient.h"
+
+// MQTT control packet types (upper nibble of the fixed header)
+#define MQTT_CONNECT      0x10
+#define MQTT_CONNACK      0x20
+#define MQTT_PUBLISH      0x30
+#define MQTT_PUBACK       0x40
+#define MQTT_SUBSCRIBE    0x82 //!< includes the reserved flags
+#define MQTT_SUBACK       0x90
+#define MQTT_PINGREQ      0xC0
+#define MQTT_PINGRESP     0xD0
+#define MQTT_DISCONNECT   0xE0
+
+#define MQTT_DUP          0x08 //!< duplicate delivery flag of PUBLISH
+#define MQTT_RETAIN       0x01 //!< retain flag of PUBLISH
+
+MQTTClient::MQTTClient(void)
+{
+    _connected = false;
+    _keepAlive_ms = 0;
+    _pingPending = false;
+    _connack = -1;
+    _suback = -1;
+    _subackId = 0;
+    _id = 0;
+    memset(_inflight, 0, sizeof(_inflight));
+    memset(_subs, 0, sizeof(_subs));
+    _txLen = 0;
+    _rxLen = 0;
+    _rxSkip = 0;
+}
+
+bool MQTTClient::connect(const char* host, int port, const char* clientId,
+                         const char* username /*= NULL*/, const char* password /*= NULL*/,
+                         int keepAlive_s /*= 60*/, bool cleanSession /*= true*/,
+                         bool secure /*= false*/)
+{
+    if (_connected)
+        disconnect();
+    int lid = strlen(clientId);
+    int lus = username ? strlen(username) : 0;
+    int lpw = password ? strlen(password) : 0;
+    // variable header (10) and the length prefixed strings of the payload
+    int rem = 10 + 2 + lid + (username ? 2 + lus : 0) + (password ? 2 + lpw : 0);
+    if (rem + 5 > MAX_PACKET)
+        return false;
+    _socket.set_secure(secure);
+    if (_socket.connect(host, port) < 0)
+        return false;
+    _txLen = 0;
+    _rxLen = 0;
+    _rxSkip = 0;
+    _pingPending = false;
+    _keepAlive_ms = keepAlive_s * 1000;
+    char buf[MAX_PACKET];
+    char* p = buf + _putHeader(buf, MQTT_CONNECT, rem);
+    p = _putStr(p, "MQTT", 4);
+    *p++ = 4; // protocol level 3.1.1
+    *p++ = (username ? 0x80 : 0) | (password ? 0x40 : 0) | (cleanSession ? 0x02 : 0);
+    *p++ = (keepAlive_s >> 8) & 0xFF;
+    *p++ = keepAlive_s & 0xFF;
+    p = _putStr(p, clientId, lid);
+    if (username) p = _putStr(p, username, lus);
+    if (password) p = _putStr(p, password, lpw);
+    _connack = -1;
+    if (!_queue(buf, p - buf) || !flush()) {
+        _socket.close();
+        return false;
+    }
+    Timer timer;
+    timer.start();
+    while ((_connack < 0) && (timer.read_ms() < TIMEOUT_MS)) {
+        if (!_pump(100)) {
+            _socket.close();
+            return false;
+        }
+    }
+    if (_connack != 0) {
+        _socket.close();
+        return false;
+    }
+    _connected = true;
+    _txTimer.reset();
+    _txTimer.start();
+    // a new session forgets the unacknowledged publishes, else send them again
+    for (int i = 0; i < MAX_INFLIGHT; i ++) {
+        if (!_inflight[i].id)
+            continue;
+        if (cleanSession)
+            _inflight[i].id = 0;
+        else {
+            _inflight[i].buf[0] |= MQTT_DUP;
+            if (!_queue(_inflight[i].buf, _inflight[i].len))
+                return _fail();
+        }
+    }
+    return flush() || _fail();
+}
+
+int MQTTClient::publish(const char* topic, const void* payload, int len,
+                        int qos /*= 0*/, bool retain /*= false*/)
+{
+    if (!_connected || (qos < 0) || (qos > 1))
+        return -1;
+    int lt = strlen(topic);
+    int rem = 2 + lt + (qos ? 2 : 0) + len;
+    if (rem + 5 > MAX_PACKET)
+        return -1;
+    char tmp[MAX_PACKET];
+    char* buf = tmp;
+    int slot = -1;
+    if (qos) {
+        // wait for a free slot in the in-flight window, the broker
+        // acknowledges while we receive
+        Timer timer;
+        timer.start();
+        for (;;) {
+            for (int i = 0; (i < MAX_INFLIGHT) && (slot < 0); i ++) {
+                if (!_inflight[i].id)
+                    slot = i;
+            }
+            if (slot >= 0)
+                break;
+            if ((timer.read_ms() > TIMEOUT_MS) || !yield(100))
+                return -1;
+        }
+        // keep the packet to be able to send it again after a reconnect
+        buf = _inflight[slot].buf;
+    }
+    unsigned short id = qos ? _nextId() : 0;
+    char* p = buf + _putHeader(buf, MQTT_PUBLISH | (qos << 1) | (retain ? MQTT_RETAIN : 0), rem);
+    p = _putStr(p, topic, lt);
+    if (qos) {
+        *p++ = id >> 8;
+        *p++ = id & 0xFF;
+    }
+    memcpy(p, payload, len);
+    p += len;
+    if (!_queue(buf, p - buf))
+        return -1;
+    if (qos) {
+        _inflight[slot].len = p - buf;
+        _inflight[slot].id = id;
+    }
+    return id;
+}
+
+bool MQTTClient::flush(void)
+{
+    if (_txLen == 0)
+        return true;
+    int ret = _socket.send(_tx, _txLen);
+    _txLen = 0;
+    if (ret < 0)
+        return false;
+    _txTimer.reset();
+    return true;
+}
+
+bool MQTTClient::subscribe(const char* filter, int qos, _MSGCB cb, void* param /*= NULL*/)
+{
+    int slot = -1;
+    for (int i = 0; (i < MAX_SUBS) && (slot < 0); i ++) {
+        if (!_subs[i].filter)
+            slot = i;
+    }
+    if (!_connected || (slot < 0) || (qos < 0) || (qos > 1))
+        return false;
+    int lf = strlen(filter);
+    int rem = 2 + 2 + lf + 1;
+    if (rem + 5 > MAX_PACKET)
+        return false;
+    char buf[MAX_PACKET];
+    unsigned short id = _nextId();
+    char* p = buf + _putHeader(buf, MQTT_SUBSCRIBE, rem);
+    *p++ = id >> 8;
+    *p++ = id & 0xFF;
+    p = _putStr(p, filter, lf);
+    *p++ = qos;
+    _suback = -1;
+    _subackId = id;
+    // register first, messages may arrive before the SUBACK
+    _subs[slot].filter = filter;
+    _subs[slot].cb = cb;
+    _subs[slot].param = param;
+    if (!_queue(buf, p - buf) || !flush()) {
+        _subs[slot].filter = NULL;
+        return _fail();
+    }
+    Timer timer;
+    timer.start();
+    while ((_suback < 0) && (timer.read_ms() < TIMEOUT_MS)) {
+        if (!yield(100))
+            break;
+    }
+    // 0x80 is the failure return code
+    if ((_suback < 0) || (_suback == 0x80)) {
+        _subs[slot].filter = NULL;
+        return false;
+    }
+    return true;
+}
+
+bool MQTTClient::yield(int timeout_ms /*= 0*/)
+{
+    if (!_connected)
+        return false;
+    if (!flush())
+        return _fail();
+    if (!_pump(timeout_ms))
+        return _fail();
+    if (!_keepAlive())
+        return _fail();
+    // send the acknowledges of received messages
+    if (!flush())
+        return _fail();
+    return _connected;
+}
+
+int MQTTClient::inflight(void)
+{
+    int n = 0;
+    for (int i = 0; i < MAX_INFLIGHT; i ++) {
+        if (_inflight[i].id)
+            n ++;
+    }
+    return n;
+}
+
+void MQTTClient::disconnect(void)
+{
+    if (_connected) {
+        char buf[2];
+        _putHeader(buf, MQTT_DISCONNECT, 0);
+        if (_queue(buf, sizeof(buf)))
+            flush();
+    }
+    _connected = false;
+    _txLen = 0;
+    _socket.close();
+}
+
+// ----------------------------------------------------------------
+
+bool MQTTClient::_queue(const char* buf, int len)
+{
+    if ((_txLen + len > MAX_BATCH) && !flush())
+        return false;
+    memcpy(&_tx[_txLen], buf, len);
+    _txLen += len;
+    return true;
+}
+
+bool MQTTClient::_pump(int timeout_ms)
+{
+    _socket.set_blocking(false, timeout_ms);
+    int n = _socket.receive(&_rx[_rxLen], sizeof(_rx) - _rxLen);
+    if (n < 0)
+        return false;
+    // drop what is left of an oversized packet
+    if (_rxSkip) {
+        int d = (n < _rxSkip) ? n : _rxSkip;
+        memmove(&_rx[_rxLen], &_rx[_rxLen + d], n - d);
+        _rxSkip -= d;
+        n -= d;
+    }
+    _rxLen += n;
+    for (;;) {
+        // fixed header with the variable length encoded remaining length
+        int rem = 0;
+        int mul = 1;
+        int h = 1;
+        char c;
+        do {
+            if (h > 4)
+                return false; // malformed
+            if (h >= _rxLen)
+                return true; // need more data
+            c = _rx[h++];
+            rem += (c & 0x7F) * mul;
+            mul <<= 7;
+        } while (c & 0x80);
+        int total = h + rem;
+        if (total > (int)sizeof(_rx)) {
+            _rxSkip = total - _rxLen;
+            _rxLen = 0;
+            return true;
+        }
+        if (_rxLen < total)
+            return true;
+        _handle(_rx[0] & 0xFF, &_rx[h], rem);
+        _rxLen -= total;
+        memmove(_rx, &_rx[total], _rxLen);
+    }
+}
+
+void MQTTClient::_handle(int type, const char* buf, int len)
+{
+    switch (type & 0xF0) {
+        case MQTT_CONNACK:
+            if (len >= 2)
+                _connack = buf[1] & 0xFF;
+            break;
+        case MQTT_PUBLISH:
+            if (len >= 2) {
+                int qos = (type >> 1) & 3;
+                int lt = ((buf[0] & 0xFF) << 8) | (buf[1] & 0xFF);
+                int o = 2 + lt + (qos ? 2 : 0);
+                if (o > len)
+                    break;
+                const char* topic = &buf[2];
+                for (int i = 0; i < MAX_SUBS; i ++) {
+                    if (_subs[i].filter && _subs[i].cb && _match(_subs[i].filter, topic, lt))
+                        _subs[i].cb(_subs[i].param, topic, lt, &buf[o], len - o);
+                }
+                if (qos == 1) {
+                    // acknowledge with the next batch
+                    char ack[4] = { MQTT_PUBACK, 2, buf[2 + lt], buf[3 + lt] };
+                    _queue(ack, sizeof(ack));
+                }
+            }
+            break;
+        case MQTT_PUBACK:
+            if (len >= 2) {
+                unsigned short id = ((buf[0] & 0xFF) << 8) | (buf[1] & 0xFF);
+                for (int i = 0; i < MAX_INFLIGHT; i ++) {
+                    if (_inflight[i].id == id)
+                        _inflight[i].id = 0;
+                }
+            }
+            break;
+        case MQTT_SUBACK:
+            if ((len >= 3) && ((unsigned short)(((buf[0] & 0xFF) << 8) | (buf[1] & 0xFF)) == _subackId))
+                _suback = buf[2] & 0xFF;
+            break;
+        case MQTT_PINGRESP:
+            _pingPending = false;
+            break;
+        default:
+            break;
+    }
+}
+
+bool MQTTClient::_keepAlive(void)
+{
+    if (!_keepAlive_ms)
+        return true;
+    if (_pingPending)
+        // the broker has to answer within the keep alive interval
+        return (_pingTimer.read_ms() < _keepAlive_ms);
+    // ping when idle for half of the interval, leaving time for the answer
+    if (_txTimer.read_ms() >= _keepAlive_ms / 2) {
+        char buf[2];
+        _putHeader(buf, MQTT_PINGREQ, 0);
+        if (!_queue(buf, sizeof(buf)) || !flush())
+            return false;
+        _pingPending = true;
+        _pingTimer.reset();
+        _pingTimer.start();
+    }
+    return true;
+}
+
+bool MQTTClient::_fail(void)
+{
+    _connected = false;
+    _txLen = 0;
+    _socket.close();
+    return false;
+}
+
+unsigned short MQTTClient::_nextId(void)
+{
+    if (++_id == 0)
+        _id = 1;
+    return _id;
+}
+
+int MQTTClient::_putHeader(char* buf, int type, int rem)
+{
+    int n = 0;
+    buf[n++] = type;
+    do {
+        char c = rem & 0x7F;
+        rem >>= 7;
+        buf[n++] = c | (rem ? 0x80 : 0);
+    } while (rem);
+    return n;
+}
+
+char* MQTTClient::_putStr(char* buf, const char* str, int len)
+{
+    *buf++ = (len >> 8) & 0xFF;
+    *buf++ = len & 0xFF;
+    memcpy(buf, str, len);
+    return buf + len;
+}
+
+bool MQTTClient::_match(const char* filter, const char* topic, int len)
+{
+    const char* end = topic + len;
+    while (*filter) {
+        if (*filter == '#')
+            return true; // matches the rest including the parent level
+        if (*filter == '+') {
+            // matches a single level
+            while ((topic < end) && (*topic != '/'))
+                topic ++;
+            filter ++;
+        } else {
+            if ((topic == end) || (*filter != *topic))
+                // "a/#" also matches "a"
+                return (topic == end) && (filter[0] == '/') &&
+                       (filter[1] == '#') && (filter[2] == '\0');
+            filter ++;
+            topic ++;
+        }
+    }
+    return (topic == end);
+}
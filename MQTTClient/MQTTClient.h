@@ -0,0 +1,158 @@
+#pragma once
+
+#include "mbed.h"
+#include "TCPSocketConnection.h"
+
+/** Minimal MQTT 3.1.1 client on top of a modem TCP socket.
+
+    All packets are built in static buffers, no heap is used. Publishes
+    are collected in a batch that is written to the socket at once (one
+    AT+USOWR), QoS 1 publishes are kept in a small in-flight window so
+    that several of them can be outstanding while waiting for PUBACKs.
+    The batch is sent by #flush or #yield, #yield also receives messages,
+    handles the acknowledges and sends the keep alive pings.
+*/
+class MQTTClient
+{
+public:
+    enum {
+        MAX_PACKET   = 256,   //!< largest packet sent or received
+        MAX_BATCH    = 1024,  //!< size of the batch, the size of one socket write
+        MAX_INFLIGHT = 4,     //!< number of unacknowledged QoS 1 publishes
+        MAX_SUBS     = 4,     //!< number of subscriptions
+        TIMEOUT_MS   = 10000  //!< time to wait for CONNACK and SUBACK
+    };
+
+    /** callback function for received messages
+        \param param the argument passed to #subscribe
+        \param topic the topic of the message (not terminated)
+        \param topicLen the length of the topic
+        \param payload the payload of the message
+        \param len the length of the payload
+    */
+    typedef void (*_MSGCB)(void* param, const char* topic, int topicLen,
+                           const char* payload, int len);
+
+    //! Constructor
+    MQTTClient(void);
+
+    /** Connect to a broker
+        \param host the broker name or ip
+        \param port the broker port
+        \param clientId the client identifier
+        \param username an optional user name
+        \param password an optional password
+        \param keepAlive_s the keep alive interval in s, 0 disables it
+        \param cleanSession start a new session, otherwise the unacknowledged
+               QoS 1 publishes of the last connection are sent again
+        \param secure use TLS on the modem
+        \return true if connected, false otherwise
+    */
+    bool connect(const char* host, int port, const char* clientId,
+                 const char* username = NULL, const char* password = NULL,
+                 int keepAlive_s = 60, bool cleanSession = true, bool secure = false);
+
+    /** Check the connection
+        \return true if connected, false otherwise
+    */
+    bool isConnected(void) { return _connected; }
+
+    /** Publish a message, the message is added to the batch. With QoS 1
+        this call waits for a free slot in the in-flight window.
+        \param topic the topic
+        \param payload the payload
+        \param len the size of the payload
+        \param qos the quality of service (0 or 1)
+        \param retain the broker should retain the message
+        \return the packet identifier for QoS 1, 0 for QoS 0, -1 on failure
+    */
+    int publish(const char* topic, const void* payload, int len,
+                int qos = 0, bool retain = false);
+
+    /** Send the batched packets
+        \return true if successful, false otherwise
+    */
+    bool flush(void);
+
+    /** Subscribe to a topic filter
+        \param filter the topic filter, may contain the wildcards + and #,
+               it is not copied and must remain valid while the client is used
+        \param qos the maximum quality of service (0 or 1)
+        \param cb the callback for the received messages
+        \param param the argument passed to the callback
+        \return true if successful, false otherwise
+    */
+    bool subscribe(const char* filter, int qos, _MSGCB cb, void* param = NULL);
+
+    /** template version of #subscribe, this allows the compiler to do
+        type cheking of the callback argument.
+        \sa subscribe
+    */
+    template<class T>
+    inline bool subscribe(const char* filter, int qos,
+                    void (*cb)(T* param, const char* topic, int topicLen,
+                               const char* payload, int len),
+                    T* param)
+    {
+        return subscribe(filter, qos, (_MSGCB)cb, (void*)param);
+    }
+
+    /** Send the batch, receive and dispatch messages, handle the
+        acknowledges and the keep alive
+        \param timeout_ms the time to wait for incoming data
+        \return true if still connected, false otherwise
+    */
+    bool yield(int timeout_ms = 0);
+
+    /** Get the number of unacknowledged QoS 1 publishes
+        \return the number of publishes in the in-flight window
+    */
+    int inflight(void);
+
+    /** Disconnect from the broker
+    */
+    void disconnect(void);
+
+protected:
+    //! a QoS 1 publish waiting for its acknowledge
+    typedef struct { unsigned short id; int len; char buf[MAX_PACKET]; } Inflight;
+    //! a subscription
+    typedef struct { const char* filter; _MSGCB cb; void* param; } Sub;
+
+    //! add a packet to the batch
+    bool _queue(const char* buf, int len);
+    //! receive data and handle the complete packets
+    bool _pump(int timeout_ms);
+    //! handle a received packet
+    void _handle(int type, const char* buf, int len);
+    //! send pings and check that they are answered
+    bool _keepAlive(void);
+    //! close the connection after an error
+    bool _fail(void);
+    //! get the next packet identifier
+    unsigned short _nextId(void);
+    //! write the fixed header, returns its size
+    static int _putHeader(char* buf, int type, int rem);
+    //! write a length prefixed string
+    static char* _putStr(char* buf, const char* str, int len);
+    //! match a topic against a filter with wildcards
+    static bool _match(const char* filter, const char* topic, int len);
+
+    TCPSocketConnection _socket;  //!< the connection to the broker
+    bool _connected;              //!< connected to the broker
+    int _keepAlive_ms;            //!< the keep alive interval
+    Timer _txTimer;               //!< time since the last packet sent
+    Timer _pingTimer;             //!< time since the ping was sent
+    bool _pingPending;            //!< a PINGRESP is outstanding
+    volatile int _connack;        //!< return code of the CONNACK, -1 if none
+    volatile int _suback;         //!< return code of the SUBACK, -1 if none
+    unsigned short _subackId;     //!< packet identifier of the pending SUBSCRIBE
+    unsigned short _id;           //!< the last packet identifier
+    Inflight _inflight[MAX_INFLIGHT]; //!< the in-flight window, id 0 is free
+    Sub _subs[MAX_SUBS];          //!< the subscriptions
+    char _tx[MAX_BATCH];          //!< the batch
+    int _txLen;                   //!< bytes in the batch
+    char _rx[MAX_PACKET];         //!< the receive buffer
+    int _rxLen;                   //!< bytes in the receive buffer
+    int _rxSkip;                  //!< bytes of an oversized packet to be dropped
+};
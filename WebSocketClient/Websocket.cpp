@@ -2,6 +2,7 @@
 
 #define MAX_TRY_WRITE 20
 #define MAX_TRY_READ 10
+#define WS_COALESCE_DELAY 100 // time the handshake lines are held back in ms
 
 //Debug is disabled by default
 #if 0
@@ -17,6 +18,9 @@
 #define INFO(x, ...) printf("[WebSocket : INFO]"x"\r\n", ##__VA_ARGS__); 
 
 Websocket::Websocket(char * url) {
+    tlsRootCa = NULL;
+    tlsVerify = MDMParser::SEC_VERIFY_URL;
+    tlsProfile = 0;
     fillFields(url);
     socket.set_blocking(false, 400);
 }
@@ -25,19 +29,29 @@ void Websocket::fillFields(char * url) {
   int ret = parseURL(url, scheme, sizeof(scheme), host, sizeof(host), &port, path, sizeof(path));
   if(ret)
   {
-    ERR("URL parsing failed; please use: \"ws://ip-or-domain[:port]/path\"");
+    ERR("URL parsing failed; please use: \"ws[s]://ip-or-domain[:port]/path\"");
     return;
   }
 
-  if(port == 0) //TODO do handle WSS->443
+  // wss uses the tls of the modem
+  bool secure = !strcmp(scheme, "wss");
+  if(port == 0)
   {
-    port = 80;
+    port = secure ? 443 : 80;
   }
   
-  if(strcmp(scheme, "ws"))
+  if(strcmp(scheme, "ws") && !secure)
   {
-    ERR("Wrong scheme, please use \"ws\" instead");
+    ERR("Wrong scheme, please use \"ws\" or \"wss\" instead");
   }
+  socket.set_secure(secure, tlsProfile);
+}
+
+void Websocket::setTls(const char* rootCa, MDMParser::SecVerify verify, int profile) {
+    tlsRootCa = rootCa;
+    tlsVerify = verify;
+    tlsProfile = profile;
+    socket.set_secure(!strcmp(scheme, "wss"), tlsProfile);
 }
 
 int Websocket::parseURL(const char* url, char* scheme, size_t maxSchemeLen, char* host, size_t maxHostLen, uint16_t* port, char* path, size_t maxPathLen) //Parse URL
@@ -116,6 +130,20 @@ int Websocket::parseURL(const char* url, char* scheme, size_t maxSchemeLen, char
 
 bool Websocket::connect() {
     char cmd[200];
+    char hdr[256];
+
+    // wss validates the server unless turned off, the host name goes with sni
+    if (!strcmp(scheme, "wss")) {
+        MDMParser* mdm = MDMParser::getInstance();
+        if ((tlsVerify != MDMParser::SEC_VERIFY_NONE) && !tlsRootCa) {
+            ERR("No root CA to validate (%s), see setTls", host);
+            return false;
+        }
+        if (!mdm || !mdm->secSetProfile(tlsProfile, tlsVerify, tlsRootCa, NULL, NULL, host)) {
+            ERR("Unable to set up the security profile %d", tlsProfile);
+            return false;
+        }
+    }
 
     while (socket.connect(host, port) < 0) {
         ERR("Unable to connect to (%s) on port (%d)", host, port);
@@ -123,7 +151,9 @@ bool Websocket::connect() {
         return false;
     }
 
-    // sent http header to upgrade to the ws protocol
+    // sent http header to upgrade to the ws protocol, the lines are 
+    // coalesced into a single write to the modem
+    socket.set_coalescing(WS_COALESCE_DELAY, hdr, sizeof(hdr));
     sprintf(cmd, "GET %s HTTP/1.1\r\n", path);
     write(cmd, strlen(cmd));
     
@@ -141,7 +171,7 @@ bool Websocket::connect() {
 
     sprintf(cmd, "Sec-WebSocket-Version: 13\r\n\r\n");
     int ret = write(cmd, strlen(cmd));
-    if (ret != strlen(cmd)) {
+    if ((socket.set_coalescing(0) < 0) || (ret != strlen(cmd))) {
         close();
         ERR("Could not send request");
         return false;
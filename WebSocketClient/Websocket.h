@@ -71,7 +71,7 @@ class Websocket
         /**
         * Constructor
         *
-        * @param url The Websocket url in the form "ws://ip_domain[:port]/path" (by default: port = 80)
+        * @param url The Websocket url in the form "ws[s]://ip_domain[:port]/path" (by default: port = 80 for ws, 443 for wss)
         */
         Websocket(char * url);
 
@@ -82,6 +82,19 @@ class Websocket
         */
         bool connect();
 
+        /**
+        * Set up the TLS of wss connections, before connect. The certificate
+        * of the server is validated against a root CA imported into the modem
+        * (see MDMParser::secImportCert) and the host name is sent with SNI.
+        * Without a root CA wss connections fail, unless the validation is
+        * turned off explicitly with MDMParser::SEC_VERIFY_NONE.
+        *
+        * @param rootCa the name of the root CA in the modem
+        * @param verify the validation level
+        * @param profile the security profile of the modem to use
+        */
+        void setTls(const char* rootCa, MDMParser::SecVerify verify = MDMParser::SEC_VERIFY_URL, int profile = 0);
+
         /**
         * Send a string according to the websocket format (see rfc 6455)
         *
@@ -135,6 +148,10 @@ class Websocket
         char host[32];
         char path[64];
         
+        const char* tlsRootCa;
+        MDMParser::SecVerify tlsVerify;
+        int tlsProfile;
+        
         TCPSocketConnection socket;
 
         int read(char * buf, int len, int min_len = -1);
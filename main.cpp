@@ -186,7 +186,8 @@ int main() {
 	const int timeoutMargin = 5; // seconds
 	const int submitPeriod = 60; // 1 minutes in seconds
 	const int targetAccuracy = 1; // meters
-	unsigned int j = submitPeriod * 1000/wait;
+	Timer submitTimer; // time since the last request, independent of the loop delay
+	bool submitNow = true;
 	bool cellLocWait = false;
 	MDMParser::CellLocData loc;
 
@@ -259,6 +260,20 @@ int main() {
 				}
 			}
 		}
+#ifdef CELLOCATE
+		if (cellLocWait && mdm.cellLocGetData(&loc)) {
+			cellLocWait = false;
+			printf("CellLocate Location: %.5f %.5f +/-%dm sensor %d in %dms\r\n", 
+					loc.latitude, loc.longitude, loc.uncertainty, loc.sensor, loc.ttf_ms);
+		}
+		// request a position once per period, the result follows with a URC
+		if (submitNow || (submitTimer.read_ms() >= submitPeriod * 1000)) {
+			submitNow = false;
+			submitTimer.reset();
+			submitTimer.start();
+			cellLocWait = mdm.cellLocRequest(sensorMask, submitPeriod - timeoutMargin, targetAccuracy);
+		}
+#endif
 #ifdef RTOS_H
 		Thread::wait(wait);
 #else
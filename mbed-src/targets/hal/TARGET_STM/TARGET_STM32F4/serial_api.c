@@ -57,7 +57,11 @@ static void init_uart(serial_t *obj)
     UartHandle.Init.WordLength = obj->databits;
     UartHandle.Init.StopBits   = obj->stopbits;
     UartHandle.Init.Parity     = obj->parity;
+#if DEVICE_SERIAL_FC
+    UartHandle.Init.HwFlowCtl  = obj->hw_flow_ctl;
+#else
     UartHandle.Init.HwFlowCtl  = UART_HWCONTROL_NONE;
+#endif
 
     if (obj->pin_rx == NC) {
         UartHandle.Init.Mode = UART_MODE_TX;
@@ -149,6 +153,12 @@ void serial_init(serial_t *obj, PinName tx, PinName rx)
     obj->pin_tx = tx;
     obj->pin_rx = rx;
 
+#if DEVICE_SERIAL_FC
+    obj->hw_flow_ctl = UART_HWCONTROL_NONE;
+    obj->pin_rts = NC;
+    obj->pin_cts = NC;
+#endif
+
     init_uart(obj);
 
     // For stdio management
@@ -218,6 +228,14 @@ void serial_free(serial_t *obj)
     // Configure GPIOs
     pin_function(obj->pin_tx, STM_PIN_DATA(STM_MODE_INPUT, GPIO_NOPULL, 0));
     pin_function(obj->pin_rx, STM_PIN_DATA(STM_MODE_INPUT, GPIO_NOPULL, 0));
+#if DEVICE_SERIAL_FC
+    if (obj->pin_rts != NC) {
+        pin_function(obj->pin_rts, STM_PIN_DATA(STM_MODE_INPUT, GPIO_NOPULL, 0));
+    }
+    if (obj->pin_cts != NC) {
+        pin_function(obj->pin_cts, STM_PIN_DATA(STM_MODE_INPUT, GPIO_NOPULL, 0));
+    }
+#endif
 
     serial_irq_ids[obj->index] = 0;
 }
@@ -259,6 +277,52 @@ void serial_format(serial_t *obj, int data_bits, SerialParity parity, int stop_b
     init_uart(obj);
 }
 
+#if DEVICE_SERIAL_FC
+void serial_set_flow_control(serial_t *obj, FlowControl type, PinName rxflow, PinName txflow)
+{
+    // Check the pins belong to the UART in use
+    if ((type == FlowControlRTS) || (type == FlowControlRTSCTS)) {
+        MBED_ASSERT((UARTName)pinmap_peripheral(rxflow, PinMap_UART_RTS) == obj->uart);
+    }
+    if ((type == FlowControlCTS) || (type == FlowControlRTSCTS)) {
+        MBED_ASSERT((UARTName)pinmap_peripheral(txflow, PinMap_UART_CTS) == obj->uart);
+    }
+
+    // Configure the flow control pins, RTS is driven by the UART (rx side),
+    // CTS is sampled by the UART before each transmitted character (tx side)
+    obj->pin_rts = NC;
+    obj->pin_cts = NC;
+    switch (type) {
+        case FlowControlRTS:
+            obj->hw_flow_ctl = UART_HWCONTROL_RTS;
+            obj->pin_rts = rxflow;
+            break;
+        case FlowControlCTS:
+            obj->hw_flow_ctl = UART_HWCONTROL_CTS;
+            obj->pin_cts = txflow;
+            break;
+        case FlowControlRTSCTS:
+            obj->hw_flow_ctl = UART_HWCONTROL_RTS_CTS;
+            obj->pin_rts = rxflow;
+            obj->pin_cts = txflow;
+            break;
+        default: // FlowControlNone
+            obj->hw_flow_ctl = UART_HWCONTROL_NONE;
+            break;
+    }
+    if (obj->pin_rts != NC) {
+        pinmap_pinout(obj->pin_rts, PinMap_UART_RTS);
+        pin_mode(obj->pin_rts, PullUp);
+    }
+    if (obj->pin_cts != NC) {
+        pinmap_pinout(obj->pin_cts, PinMap_UART_CTS);
+        pin_mode(obj->pin_cts, PullUp);
+    }
+
+    init_uart(obj);
+}
+#endif
+
 /******************************************************************************
  * INTERRUPTS HANDLING
  ******************************************************************************/
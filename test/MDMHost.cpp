@@ -0,0 +1,77 @@
+#include <unistd.h>
+#include <poll.h>
+#include <time.h>
+#include "MDMHost.h"
+
+//! real time in us
+static uint64_t nowUs(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
+}
+
+MDMHost::MDMHost(int fd) : _pipeRx(1024)
+{
+    _fd = fd;
+}
+
+int MDMHost::getLine(char* buffer, int length)
+{
+    _read(0);
+    return _getLine(&_pipeRx, buffer, length);
+}
+
+void MDMHost::purge(void)
+{
+    _read(0);
+    while (_pipeRx.readable())
+        _pipeRx.getc();
+}
+
+int MDMHost::_send(const void* buf, int len)
+{
+    const char* p = (const char*)buf;
+    int n = 0;
+    while (n < len) {
+        int w = write(_fd, p + n, len - n);
+        if (w <= 0)
+            break;
+        n += w;
+    }
+    return n;
+}
+
+void MDMHost::wait_ms(int ms)
+{
+    uint64_t start = nowUs();
+    _read(ms);
+    stub_now_us += (uint32_t)(nowUs() - start);
+}
+
+void MDMHost::_read(int ms)
+{
+    // what is there already is read at once, then the time is waited
+    uint64_t end = nowUs() + ms * 1000;
+    int left = ms;
+    bool got;
+    do {
+        got = false;
+        struct pollfd pfd;
+        pfd.fd = _fd;
+        pfd.events = POLLIN;
+        // a full pipe waits for the parser, the rest stays in the descriptor
+        int n = poll(&pfd, _pipeRx.free() ? 1 : 0, left);
+        if ((n > 0) && (pfd.revents & POLLIN)) {
+            char buf[256];
+            int len = _pipeRx.free();
+            if (len > (int)sizeof(buf))
+                len = sizeof(buf);
+            len = read(_fd, buf, len);
+            if (len > 0)
+                got = (_pipeRx.put(buf, len) > 0);
+        }
+        uint64_t now = nowUs();
+        left = (now < end) ? (int)((end - now + 999) / 1000) : 0;
+    } while ((left > 0) || got);
+}
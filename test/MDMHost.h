@@ -0,0 +1,39 @@
+#pragma once
+
+#include "mbed.h"
+#include "MDM.h"
+
+/** Modem parser on a file descriptor of the host, e.g. the socket pair
+    of a #ModemSim or a pty. It links the unmodified MDM.cpp.
+
+    The simulated time of the stub advances by the real time the parser
+    waits, so the metrics and timeouts of the parser measure the real
+    latency of the peer.
+*/
+class MDMHost : public MDMParser
+{
+public:
+    /** Constructor
+        \param fd the file descriptor, it is not closed by the parser
+    */
+    MDMHost(int fd);
+
+    //! Destructor
+    virtual ~MDMHost(void) { }
+
+    virtual int getLine(char* buffer, int length);
+    virtual void purge(void);
+
+protected:
+    virtual int _send(const void* buf, int len);
+    virtual void _setBaudrate(int baudrate) { }
+    virtual bool _powerSaving(Psv psv, PinName dtr) { return true; }
+    virtual void _powerStats(PowerStats* stats) { memset(stats, 0, sizeof(*stats)); }
+    virtual void wait_ms(int ms);
+
+    //! move what arrives within ms to the rx pipe
+    void _read(int ms);
+
+    int _fd;                //!< the file descriptor
+    Pipe<char> _pipeRx;     //!< the received bytes
+};
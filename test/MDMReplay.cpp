@@ -0,0 +1,64 @@
+#include "MDMReplay.h"
+
+MDMReplay::MDMReplay(const char* script, int len) : _pipeRx(1024)
+{
+    _script = script;
+    _len = len;
+    _pos = 0;
+    _mismatches = 0;
+    _mismatch[0] = '\0';
+    _start = us_ticker_read();
+    // the lines received before the first command are due at once
+    TraceRecord rec;
+    _recStart = traceRead(_script, _len, &rec) ? rec.us : 0;
+}
+
+int MDMReplay::getLine(char* buffer, int length)
+{
+    _release();
+    return _getLine(&_pipeRx, buffer, length);
+}
+
+void MDMReplay::purge(void)
+{
+    _release();
+    while (_pipeRx.readable())
+        _pipeRx.getc();
+}
+
+int MDMReplay::_send(const void* buf, int len)
+{
+    // what is left of the previous answer comes first
+    TraceRecord rec;
+    int n;
+    while ((n = traceRead(_script + _pos, _len - _pos, &rec)) && (rec.dir != '>')) {
+        _pipeRx.put(rec.data, rec.cap);
+        _pos += n;
+    }
+    if (!n || (rec.len != len) || memcmp(rec.data, buf, len)) {
+        if (!_mismatches) {
+            int l = (len < (int)sizeof(_mismatch) - 1) ? len : sizeof(_mismatch) - 1;
+            memcpy(_mismatch, buf, l);
+            _mismatch[l] = '\0';
+        }
+        _mismatches ++;
+    }
+    if (n) {
+        _pos += n;
+        _recStart = rec.us;
+        _start = us_ticker_read();
+    }
+    return len;
+}
+
+void MDMReplay::_release(void)
+{
+    TraceRecord rec;
+    int n;
+    uint32_t now = us_ticker_read() - _start;
+    while ((n = traceRead(_script + _pos, _len - _pos, &rec)) && (rec.dir == '<') &&
+           (rec.us - _recStart <= now) && (_pipeRx.free() >= rec.cap)) {
+        _pipeRx.put(rec.data, rec.cap);
+        _pos += n;
+    }
+}
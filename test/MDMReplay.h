@@ -0,0 +1,59 @@
+#pragma once
+
+#include "mbed.h"
+#include "MDM.h"
+#include "Trace.h"
+
+/** Modem parser that replays a recorded transcript instead of talking 
+    to a modem, it links the unmodified MDM.cpp on the host.
+
+    Every command the parser sends is compared to the next sent record
+    of the transcript, then the received records that follow it are
+    passed to the parser. They become readable at the same time after
+    the command as when they were recorded, the time is simulated and
+    advanced by #wait_ms, so a replay always gives the same result.
+    The transcript must be recorded without a cap (setTranscript(size, 0)).
+*/
+class MDMReplay : public MDMParser
+{
+public:
+    /** Constructor
+        \param script the transcript, it must remain valid while replayed
+        \param len the size of the transcript
+    */
+    MDMReplay(const char* script, int len);
+
+    //! Destructor
+    virtual ~MDMReplay(void) { }
+
+    //! the number of commands that did not match the transcript
+    int mismatches(void) { return _mismatches; }
+
+    //! the first command that did not match, empty if none
+    const char* mismatch(void) { return _mismatch; }
+
+    //! the number of bytes of the transcript not replayed yet
+    int left(void) { return _len - _pos; }
+
+    virtual int getLine(char* buffer, int length);
+    virtual void purge(void);
+
+protected:
+    virtual int _send(const void* buf, int len);
+    virtual void _setBaudrate(int baudrate) { }
+    virtual bool _powerSaving(Psv psv, PinName dtr) { return true; }
+    virtual void _powerStats(PowerStats* stats) { memset(stats, 0, sizeof(*stats)); }
+    virtual void wait_ms(int ms) { stub_now_us += ms * 1000; }
+
+    //! move the received records that are due to the rx pipe
+    void _release(void);
+
+    const char* _script;    //!< the transcript
+    int _len;               //!< the size of the transcript
+    int _pos;               //!< the next record
+    uint32_t _recStart;     //!< time of the last sent record in the transcript
+    uint32_t _start;        //!< simulated time when the parser sent it
+    int _mismatches;        //!< commands that did not match
+    char _mismatch[64];     //!< the first command that did not match
+    Pipe<char> _pipeRx;     //!< the received lines
+};
@@ -0,0 +1,913 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdarg.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <time.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+#include "ModemSim.h"
+
+#define CTRL_Z      0x1A
+#define ESC         0x1B
+#define LAC         "1A2B"
+#define CI          "0001C3D4"
+#define LOCAL_IP    "10.10.0.2"
+
+ModemSim::ModemSim(const Config* cfg /*= NULL*/)
+{
+    if (cfg)
+        _cfg = *cfg;
+    else
+        defaults(&_cfg);
+    pthread_mutex_init(&_mtx, NULL);
+    _running = false;
+    _stop = false;
+    _fd = -1;
+    _peer = -1;
+    _wake[0] = _wake[1] = -1;
+    for (int s = 0; s < NUM_SOCK; s ++)
+        _sock[s].fd = -1;
+    memset(_files, 0, sizeof(_files));
+    memset(_sms, 0, sizeof(_sms));
+    memset(_cnt, 0, sizeof(_cnt));
+    _lines = 0;
+    _smsRef = 0;
+    _smsLast[0] = '\0';
+    _reset();
+}
+
+ModemSim::~ModemSim(void)
+{
+    stop();
+    pthread_mutex_destroy(&_mtx);
+}
+
+void ModemSim::defaults(Config* cfg)
+{
+    cfg->latencyMs = 5;
+    cfg->jitterMs = 0;
+    cfg->regMs = 200;
+    cfg->byteUs = 0;
+    cfg->maxWrite = 1024;
+    cfg->maxRead = 1024;
+    cfg->rssi = 20;
+    cfg->ber = 0;
+    cfg->imsi = "228011234567890";
+    cfg->apn = NULL;
+    cfg->host = "echo.test";
+    cfg->seed = 1;
+}
+
+void ModemSim::_reset(void)
+{
+    _t0 = _ms();
+    _rand = _cfg.seed;
+    _mode = IN_CMD;
+    _skipLf = false;
+    _inLen = 0;
+    _outLen = 0;
+    _urcLen = 0;
+    _creg = 0;
+    _cgreg = 0;
+    _regDone = false;
+    _cmgf = 0;
+    _active = false;
+    memset(_upsd, 0, sizeof(_upsd));
+}
+
+int ModemSim::start(void)
+{
+    int sv[2];
+    if (_running || (socketpair(AF_UNIX, SOCK_STREAM, 0, sv) < 0))
+        return -1;
+    if (pipe(_wake) < 0) {
+        close(sv[0]);
+        close(sv[1]);
+        return -1;
+    }
+    _fd = sv[0];
+    _peer = sv[1];
+    _stop = false;
+    _reset();
+    if (pthread_create(&_tid, NULL, _thread, this) != 0) {
+        stop();
+        return -1;
+    }
+    _running = true;
+    return _peer;
+}
+
+void ModemSim::serve(int fd)
+{
+    if (pipe(_wake) < 0)
+        return;
+    _fd = fd;
+    _stop = false;
+    _reset();
+    _loop();
+}
+
+void ModemSim::stop(void)
+{
+    _stop = true;
+    if (_running) {
+        char c = 0;
+        if (write(_wake[1], &c, 1) < 0)
+            /* the loop also checks _stop on its timeout */;
+        pthread_join(_tid, NULL);
+        _running = false;
+    }
+    int* fds[] = { &_peer, &_wake[0], &_wake[1] };
+    for (int i = 0; i < (int)(sizeof(fds)/sizeof(*fds)); i ++) {
+        if (*fds[i] >= 0)
+            close(*fds[i]);
+        *fds[i] = -1;
+    }
+    if (_fd >= 0)
+        close(_fd);
+    _fd = -1;
+    for (int s = 0; s < NUM_SOCK; s ++) {
+        if (_sock[s].fd >= 0)
+            close(_sock[s].fd);
+        _sock[s].fd = -1;
+    }
+}
+
+void* ModemSim::_thread(void* param)
+{
+    ((ModemSim*)param)->_loop();
+    return NULL;
+}
+
+void ModemSim::_loop(void)
+{
+    while (!_stop) {
+        struct pollfd fds[2 + NUM_SOCK];
+        int sock[2 + NUM_SOCK];
+        int n = 0;
+        fds[n].fd = _fd;
+        fds[n++].events = POLLIN;
+        fds[n].fd = _wake[0];
+        fds[n++].events = POLLIN;
+        pthread_mutex_lock(&_mtx);
+        for (int s = 0; s < NUM_SOCK; s ++) {
+            if ((_sock[s].fd >= 0) && (!_sock[s].tcp || _sock[s].connected)) {
+                sock[n] = s;
+                fds[n].fd = _sock[s].fd;
+                fds[n++].events = POLLIN;
+            }
+        }
+        int timeout = 100;
+        if (!_regDone && (_cfg.regMs >= 0)) {
+            int due = (int)(_t0 + _cfg.regMs - _ms());
+            if (due < timeout)
+                timeout = (due > 0) ? due : 0;
+        }
+        pthread_mutex_unlock(&_mtx);
+        if (poll(fds, n, timeout) < 0)
+            break;
+        pthread_mutex_lock(&_mtx);
+        bool eof = false;
+        if (fds[1].revents & POLLIN) {
+            char tmp[64];
+            if (read(_wake[0], tmp, sizeof(tmp)) < 0)
+                /* nothing to drain */;
+        }
+        if (fds[0].revents & (POLLIN | POLLHUP)) {
+            char buf[512];
+            int len = read(_fd, buf, sizeof(buf));
+            if (len > 0)
+                _input(buf, len);
+            else
+                eof = true;
+        }
+        for (int i = 2; i < n; i ++) {
+            if (fds[i].revents & (POLLIN | POLLHUP | POLLERR))
+                _socket(sock[i]);
+        }
+        _register();
+        if (_mode == IN_CMD) {
+            _raw(_urc, _urcLen);
+            _urcLen = 0;
+            _flush(false);
+        }
+        pthread_mutex_unlock(&_mtx);
+        if (eof)
+            break;
+    }
+}
+
+void ModemSim::urc(const char* line)
+{
+    pthread_mutex_lock(&_mtx);
+    int n = snprintf(&_urc[_urcLen], sizeof(_urc) - _urcLen, "\r\n%s\r\n", line);
+    if ((n > 0) && (_urcLen + n < (int)sizeof(_urc)))
+        _urcLen += n;
+    pthread_mutex_unlock(&_mtx);
+    char c = 0;
+    if ((_wake[1] >= 0) && (write(_wake[1], &c, 1) < 0))
+        /* the loop also sends them on its timeout */;
+}
+
+void ModemSim::sms(const char* num, const char* text)
+{
+    char line[32];
+    line[0] = '\0';
+    pthread_mutex_lock(&_mtx);
+    for (int i = 0; i < NUM_SMS; i ++) {
+        if (!_sms[i].used) {
+            _sms[i].used = true;
+            _sms[i].read = false;
+            snprintf(_sms[i].num, sizeof(_sms[i].num), "%s", num);
+            snprintf(_sms[i].text, sizeof(_sms[i].text), "%s", text);
+            snprintf(line, sizeof(line), "+CMTI: \"SM\",%d", i + 1);
+            break;
+        }
+    }
+    pthread_mutex_unlock(&_mtx);
+    if (*line)
+        urc(line);
+}
+
+int ModemSim::count(const char* cmd)
+{
+    int n = 0;
+    pthread_mutex_lock(&_mtx);
+    for (int i = 0; (i < NUM_CNT) && _cnt[i].name[0]; i ++) {
+        if (0 == strcmp(_cnt[i].name, cmd))
+            n = _cnt[i].n;
+    }
+    pthread_mutex_unlock(&_mtx);
+    return n;
+}
+
+int ModemSim::lines(void)
+{
+    pthread_mutex_lock(&_mtx);
+    int n = _lines;
+    pthread_mutex_unlock(&_mtx);
+    return n;
+}
+
+int ModemSim::file(const char* name, char* buf, int len)
+{
+    int n = -1;
+    pthread_mutex_lock(&_mtx);
+    File* f = _file(name, false);
+    if (f) {
+        n = f->len;
+        memcpy(buf, f->data, (n < len) ? n : len);
+    }
+    pthread_mutex_unlock(&_mtx);
+    return n;
+}
+
+int ModemSim::smsSent(char* buf, int len)
+{
+    pthread_mutex_lock(&_mtx);
+    snprintf(buf, len, "%s", _smsLast);
+    int n = _smsRef;
+    pthread_mutex_unlock(&_mtx);
+    return n;
+}
+
+// ----------------------------------------------------------------
+// input
+
+void ModemSim::_input(const char* buf, int len)
+{
+    for (int i = 0; i < len; i ++) {
+        char c = buf[i];
+        // the line feed of the command comes before any data
+        if (_skipLf) {
+            _skipLf = false;
+            if (c == '\n')
+                continue;
+        }
+        if (_mode == IN_DATA) {
+            if (_inLen < (int)sizeof(_in))
+                _in[_inLen++] = c;
+            if (_inLen == _dataLen)
+                _data();
+        } else if (_mode == IN_SMS) {
+            if (c == ESC) {
+                _mode = IN_CMD;
+                _inLen = 0;
+                _print("\r\nOK\r\n");
+                _flush(true);
+            } else if (c == CTRL_Z) {
+                _in[_inLen] = '\0';
+                _data();
+            } else if (_inLen < (int)sizeof(_in) - 1) {
+                _in[_inLen++] = c;
+            }
+        } else if (c == '\r') {
+            _skipLf = true;
+            _in[_inLen] = '\0';
+            _inLen = 0;
+            _line(_in);
+        } else if ((c == '\n') && (_inLen == 0)) {
+            // an empty line
+        } else if (_inLen < (int)sizeof(_in) - 1) {
+            _in[_inLen++] = c;
+        }
+    }
+}
+
+void ModemSim::_line(char* line)
+{
+    _lines ++;
+    while (*line == ' ')
+        line ++;
+    if (!*line)
+        return; // the wake up preamble of the power saving
+    if (((line[0] != 'A') && (line[0] != 'a')) || ((line[1] != 'T') && (line[1] != 't'))) {
+        _print("\r\nERROR\r\n");
+        _flush(true);
+        return;
+    }
+    char* p = line + 2;
+    Result r = RES_OK;
+    while (*p && (r == RES_OK)) {
+        while (*p == ' ')
+            p ++;
+        // the commands of a line are separated by ';' outside of quotes
+        char* e = p;
+        bool quoted = false;
+        while (*e && (quoted || (*e != ';'))) {
+            if (*e == '"')
+                quoted = !quoted;
+            e ++;
+        }
+        char end = *e;
+        *e = '\0';
+        if (*p)
+            r = _cmd(p);
+        p = end ? e + 1 : e;
+    }
+    if (r == RES_OK)
+        _print("\r\nOK\r\n");
+    else if (r == RES_ERROR)
+        _print("\r\n+CME ERROR: operation not allowed\r\n");
+    _flush(true);
+}
+
+ModemSim::Result ModemSim::_cmd(const char* cmd)
+{
+    char name[16];
+    int n = strcspn(cmd, "=?");
+    if (n >= (int)sizeof(name))
+        n = sizeof(name) - 1;
+    memcpy(name, cmd, n);
+    name[n] = '\0';
+    _count(name);
+    const char* arg = cmd + n;
+    bool query = (0 == strcmp(arg, "?"));
+    bool set = (*arg == '=');
+    if (set)
+        arg ++;
+    int a, b;
+    // general and identification
+    if (!strcmp(name, "E0") || !strcmp(name, "+CMEE") || !strcmp(name, "+IPR") ||
+        !strcmp(name, "+UGPIOC") || !strcmp(name, "+UPSV") || !strcmp(name, "+CNMI") ||
+        !strcmp(name, "+CPWROFF"))
+        return RES_OK;
+    if (!strcmp(name, "I")) {
+        _print("\r\nSARA-U270\r\n");
+        return RES_OK;
+    }
+    if (!strcmp(name, "+CPIN") && query) {
+        _print("\r\n+CPIN: READY\r\n");
+        return RES_OK;
+    }
+    if (!strcmp(name, "+CGMI")) { _print("\r\nu-blox\r\n");           return RES_OK; }
+    if (!strcmp(name, "+CGMM")) { _print("\r\nSARA-U270\r\n");        return RES_OK; }
+    if (!strcmp(name, "+CGMR")) { _print("\r\n23.41\r\n");            return RES_OK; }
+    if (!strcmp(name, "+CGSN")) { _print("\r\n352848000000001\r\n");  return RES_OK; }
+    if (!strcmp(name, "+CIMI")) { _print("\r\n%s\r\n", _cfg.imsi);    return RES_OK; }
+    if (!strcmp(name, "+CCID")) { _print("\r\n+CCID: 8941000000000000001\r\n"); return RES_OK; }
+    // network
+    if (!strcmp(name, "+CREG") || !strcmp(name, "+CGREG")) {
+        int* n = !strcmp(name, "+CREG") ? &_creg : &_cgreg;
+        if (set && (sscanf(arg, "%d", &a) == 1)) {
+            *n = a;
+            return RES_OK;
+        }
+        if (!query)
+            return RES_ERROR;
+        if (!_registered())
+            _print("\r\n%s: %d,2\r\n", name, *n);
+        else if (*n == 2)
+            _print("\r\n%s: %d,1,\"" LAC "\",\"" CI "\",2\r\n", name, *n);
+        else
+            _print("\r\n%s: %d,1\r\n", name, *n);
+        return RES_OK;
+    }
+    if (!strcmp(name, "+COPS") && query) {
+        if (_registered())
+            _print("\r\n+COPS: 0,0,\"SIM NET\",2\r\n");
+        else
+            _print("\r\n+COPS: 0\r\n");
+        return RES_OK;
+    }
+    if (!strcmp(name, "+CNUM")) {
+        _print("\r\n+CNUM: \"My Number\",\"+41790000001\",145\r\n");
+        return RES_OK;
+    }
+    if (!strcmp(name, "+CSQ")) {
+        _print("\r\n+CSQ: %d,%d\r\n", _cfg.rssi, _cfg.ber);
+        return RES_OK;
+    }
+    if (!strcmp(name, "+CGATT"))
+        return _registered() ? RES_OK : RES_ERROR;
+    // packet data profile 0
+    if (!strcmp(name, "+UPSD") && set) {
+        char val[64];
+        if ((sscanf(arg, "%d,%d", &a, &b) != 2) || (a != 0) || (b < 0) || (b >= 8))
+            return RES_ERROR;
+        const char* v = strchr(strchr(arg, ',') + 1, ',');
+        if (!v) {
+            _print("\r\n+UPSD: 0,%d,\"%s\"\r\n", b, _upsd[b]);
+            return RES_OK;
+        }
+        if (sscanf(v + 1, "\"%63[^\"]\"", val) != 1) {
+            if (sscanf(v + 1, "%63s", val) != 1)
+                val[0] = '\0';
+        }
+        strcpy(_upsd[b], val);
+        return RES_OK;
+    }
+    if (!strcmp(name, "+UPSDA") && set && (sscanf(arg, "%d,%d", &a, &b) == 2) && (a == 0)) {
+        if (b == 3) {
+            if (!_registered() || (_cfg.apn && strcmp(_cfg.apn, _upsd[1])))
+                return RES_ERROR;
+            _active = true;
+        } else if (b == 4) {
+            _active = false;
+        }
+        return RES_OK;
+    }
+    if (!strcmp(name, "+UPSND") && set && (sscanf(arg, "%d,%d", &a, &b) == 2) && (a == 0)) {
+        if (b == 8)
+            _print("\r\n+UPSND: 0,8,%d\r\n", _active ? 1 : 0);
+        else if ((b == 0) && _active)
+            _print("\r\n+UPSND: 0,0,\"" LOCAL_IP "\"\r\n");
+        else
+            return RES_ERROR;
+        return RES_OK;
+    }
+    if (!strcmp(name, "+UDNSRN") && set) {
+        char host[64];
+        int c, d;
+        if (sscanf(arg, "0,\"%63[^\"]\"", host) != 1)
+            return RES_ERROR;
+        if (!_active)
+            return RES_ERROR;
+        if (sscanf(host, "%d.%d.%d.%d", &a, &b, &c, &d) == 4)
+            _print("\r\n+UDNSRN: \"%s\"\r\n", host);
+        else if (!strcmp(host, "localhost") || (_cfg.host && !strcmp(host, _cfg.host)))
+            _print("\r\n+UDNSRN: \"127.0.0.1\"\r\n");
+        else
+            return RES_ERROR;
+        return RES_OK;
+    }
+    if (!strncmp(name, "+USO", 4))
+        return _cmdSocket(name, set ? arg : NULL);
+    if (!strncmp(name, "+CMG", 4))
+        return _cmdSms(name, query ? "?" : set ? arg : NULL);
+    if (!strcmp(name, "+UDWNFILE") || !strcmp(name, "+URDFILE") || !strcmp(name, "+URDBLOCK") ||
+        !strcmp(name, "+UDELFILE") || !strcmp(name, "+ULSTFILE"))
+        return set ? _cmdFile(name, arg) : RES_ERROR;
+    return RES_ERROR;
+}
+
+// ----------------------------------------------------------------
+// sockets
+
+ModemSim::Result ModemSim::_cmdSocket(const char* name, const char* arg)
+{
+    int s, a, b;
+    if (!arg)
+        return RES_ERROR;
+    if (!strcmp(name, "+USOCR")) {
+        int proto = 0, port = 0;
+        if ((sscanf(arg, "%d,%d", &proto, &port) < 1) || ((proto != 6) && (proto != 17)))
+            return RES_ERROR;
+        for (s = 0; (s < NUM_SOCK) && (_sock[s].fd >= 0); s ++)
+            /* find a free one */;
+        if (s == NUM_SOCK)
+            return RES_ERROR;
+        Sock* sock = &_sock[s];
+        sock->tcp = (proto == 6);
+        sock->fd = socket(AF_INET, sock->tcp ? SOCK_STREAM : SOCK_DGRAM, 0);
+        if (sock->fd < 0)
+            return RES_ERROR;
+        if (!sock->tcp) {
+            // the requested local port may be in use on the host
+            struct sockaddr_in sa;
+            memset(&sa, 0, sizeof(sa));
+            sa.sin_family = AF_INET;
+            sa.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+            sa.sin_port = htons(port);
+            if (bind(sock->fd, (struct sockaddr*)&sa, sizeof(sa)) < 0) {
+                sa.sin_port = 0;
+                bind(sock->fd, (struct sockaddr*)&sa, sizeof(sa));
+            }
+        }
+        sock->connected = false;
+        sock->rxLen = 0;
+        sock->dgrams = 0;
+        _print("\r\n+USOCR: %d\r\n", s);
+        return RES_OK;
+    }
+    char ip[16];
+    int n = sscanf(arg, "%d,%d", &s, &a);
+    if ((n < 1) || (s < 0) || (s >= NUM_SOCK) || (_sock[s].fd < 0))
+        return RES_ERROR;
+    Sock* sock = &_sock[s];
+    if (!strcmp(name, "+USOCO")) {
+        if (!sock->tcp || sock->connected ||
+            (sscanf(arg, "%*d,\"%15[^\"]\",%d", ip, &b) != 2))
+            return RES_ERROR;
+        struct sockaddr_in sa;
+        memset(&sa, 0, sizeof(sa));
+        sa.sin_family = AF_INET;
+        sa.sin_port = htons(b);
+        if (!_active || !inet_aton(ip, &sa.sin_addr) ||
+            (connect(sock->fd, (struct sockaddr*)&sa, sizeof(sa)) < 0))
+            return RES_ERROR;
+        sock->connected = true;
+        return RES_OK;
+    }
+    if (!strcmp(name, "+USOWR")) {
+        if (!sock->tcp || !sock->connected || (n != 2) || (a <= 0) || (a > _cfg.maxWrite))
+            return RES_ERROR;
+        strcpy(_dataCmd, name);
+        _dataSock = s;
+        _dataLen = a;
+        _mode = IN_DATA;
+        _print("\r\n@");
+        return RES_PROMPT;
+    }
+    if (!strcmp(name, "+USOST")) {
+        if (sock->tcp || (sscanf(arg, "%*d,\"%15[^\"]\",%d,%d", ip, &b, &a) != 3) ||
+            (a <= 0) || (a > _cfg.maxWrite) || !_active)
+            return RES_ERROR;
+        strcpy(_dataCmd, name);
+        strcpy(_dataIp, ip);
+        _dataSock = s;
+        _dataPort = b;
+        _dataLen = a;
+        _mode = IN_DATA;
+        _print("\r\n@");
+        return RES_PROMPT;
+    }
+    if (!strcmp(name, "+USORD")) {
+        if (!sock->tcp || (n != 2) || (a < 0))
+            return RES_ERROR;
+        if (a == 0) {
+            _print("\r\n+USORD: %d,%d\r\n", s, sock->rxLen);
+            return RES_OK;
+        }
+        if (a > _cfg.maxRead) a = _cfg.maxRead;
+        if (a > sock->rxLen)  a = sock->rxLen;
+        _print("\r\n+USORD: %d,%d,\"", s, a);
+        _raw(sock->rx, a);
+        _print("\"\r\n");
+        sock->rxLen -= a;
+        memmove(sock->rx, sock->rx + a, sock->rxLen);
+        return RES_OK;
+    }
+    if (!strcmp(name, "+USORF")) {
+        if (sock->tcp || (n != 2) || (a < 0))
+            return RES_ERROR;
+        if (a == 0) {
+            _print("\r\n+USORF: %d,%d\r\n", s, sock->dgrams ? sock->dgram[0].len : 0);
+            return RES_OK;
+        }
+        if (!sock->dgrams) {
+            _print("\r\n+USORF: %d,\"\",0,0,\"\"\r\n", s);
+            return RES_OK;
+        }
+        // a datagram is read at once, the rest of it is lost
+        Dgram* d = &sock->dgram[0];
+        if (a > _cfg.maxRead) a = _cfg.maxRead;
+        if (a > d->len)       a = d->len;
+        _print("\r\n+USORF: %d,\"%s\",%d,%d,\"", s, d->ip, d->port, a);
+        _raw(d->data, a);
+        _print("\"\r\n");
+        sock->dgrams --;
+        memmove(&sock->dgram[0], &sock->dgram[1], sock->dgrams * sizeof(Dgram));
+        return RES_OK;
+    }
+    if (!strcmp(name, "+USOCL")) {
+        close(sock->fd);
+        sock->fd = -1;
+        return RES_OK;
+    }
+    return RES_ERROR;
+}
+
+void ModemSim::_socket(int s)
+{
+    Sock* sock = &_sock[s];
+    char line[64];
+    if (sock->tcp) {
+        int free = sizeof(sock->rx) - sock->rxLen;
+        if (free == 0)
+            return; // flow control, the parser has to read first
+        int n = recv(sock->fd, sock->rx + sock->rxLen, free, 0);
+        if (n <= 0) {
+            sock->connected = false;
+            snprintf(line, sizeof(line), "\r\n+UUSOCL: %d\r\n", s);
+        } else {
+            sock->rxLen += n;
+            snprintf(line, sizeof(line), "\r\n+UUSORD: %d,%d\r\n", s, sock->rxLen);
+        }
+    } else {
+        Dgram tmp;
+        Dgram* d = (sock->dgrams < NUM_DGRAM) ? &sock->dgram[sock->dgrams] : &tmp;
+        struct sockaddr_in sa;
+        socklen_t sl = sizeof(sa);
+        int n = recvfrom(sock->fd, d->data, sizeof(d->data), 0, (struct sockaddr*)&sa, &sl);
+        if ((n < 0) || (d == &tmp))
+            return; // the queue of the module is full, it is dropped
+        d->len = n;
+        d->port = ntohs(sa.sin_port);
+        snprintf(d->ip, sizeof(d->ip), "%s", inet_ntoa(sa.sin_addr));
+        sock->dgrams ++;
+        snprintf(line, sizeof(line), "\r\n+UUSORF: %d,%d\r\n", s, n);
+    }
+    int n = strlen(line);
+    if (_urcLen + n <= (int)sizeof(_urc)) {
+        memcpy(&_urc[_urcLen], line, n);
+        _urcLen += n;
+    }
+}
+
+// ----------------------------------------------------------------
+// sms
+
+ModemSim::Result ModemSim::_cmdSms(const char* name, const char* arg)
+{
+    int a, b;
+    if (!strcmp(name, "+CMGF")) {
+        if (!arg || (sscanf(arg, "%d", &a) != 1))
+            return RES_ERROR;
+        _cmgf = a;
+        return RES_OK;
+    }
+    if (!arg)
+        return RES_ERROR;
+    if (!strcmp(name, "+CMGS")) {
+        if (_cmgf ? (sscanf(arg, "\"%31[^\"]\"", _dataName) != 1) : (sscanf(arg, "%d", &a) != 1))
+            return RES_ERROR;
+        strcpy(_dataCmd, name);
+        _mode = IN_SMS;
+        _print("\r\n> ");
+        return RES_PROMPT;
+    }
+    if (!strcmp(name, "+CMGL")) {
+        char stat[16];
+        if (sscanf(arg, "\"%15[^\"]\"", stat) != 1)
+            return RES_ERROR;
+        for (int i = 0; i < NUM_SMS; i ++) {
+            Sms* sms = &_sms[i];
+            if (!sms->used || (!strcmp(stat, "REC UNREAD") && sms->read) ||
+                              (!strcmp(stat, "REC READ") && !sms->read))
+                continue;
+            _print("\r\n+CMGL: %d,\"%s\",\"%s\",,\"16/10/18,12:00:00+08\"\r\n%s\r\n", i + 1,
+                   sms->read ? "REC READ" : "REC UNREAD", sms->num, sms->text);
+            sms->read = true;
+        }
+        return RES_OK;
+    }
+    if (!strcmp(name, "+CMGR")) {
+        if ((sscanf(arg, "%d", &a) != 1) || (a < 1) || (a > NUM_SMS) || !_sms[a-1].used)
+            return RES_ERROR;
+        Sms* sms = &_sms[a-1];
+        _print("\r\n+CMGR: \"%s\",\"%s\",,\"16/10/18,12:00:00+08\"\r\n%s\r\n",
+               sms->read ? "REC READ" : "REC UNREAD", sms->num, sms->text);
+        sms->read = true;
+        return RES_OK;
+    }
+    if (!strcmp(name, "+CMGD")) {
+        int n = sscanf(arg, "%d,%d", &a, &b);
+        if ((n == 2) && b) {
+            for (int i = 0; i < NUM_SMS; i ++)
+                _sms[i].used = false;
+            return RES_OK;
+        }
+        if ((n < 1) || (a < 1) || (a > NUM_SMS))
+            return RES_ERROR;
+        _sms[a-1].used = false;
+        return RES_OK;
+    }
+    return RES_ERROR;
+}
+
+// ----------------------------------------------------------------
+// files
+
+ModemSim::File* ModemSim::_file(const char* name, bool create)
+{
+    for (int i = 0; i < NUM_FILE; i ++) {
+        if (_files[i].used && !strcmp(_files[i].name, name))
+            return &_files[i];
+    }
+    for (int i = 0; create && (i < NUM_FILE); i ++) {
+        if (!_files[i].used) {
+            _files[i].used = true;
+            _files[i].len = 0;
+            snprintf(_files[i].name, sizeof(_files[i].name), "%s", name);
+            return &_files[i];
+        }
+    }
+    return NULL;
+}
+
+ModemSim::Result ModemSim::_cmdFile(const char* name, const char* arg)
+{
+    char fn[48];
+    int a = 0, b = 0;
+    int n = sscanf(arg, "\"%47[^\"]\",%d,%d", fn, &a, &b);
+    if (n < 1) {
+        if (strcmp(name, "+ULSTFILE") || (sscanf(arg, "2,\"%47[^\"]\"", fn) != 1))
+            return RES_ERROR;
+    }
+    File* f = _file(fn, false);
+    if (!strcmp(name, "+UDWNFILE")) {
+        // the module appends to an existing file
+        if ((n != 2) || (a <= 0) || (a > FILE_SIZE - (f ? f->len : 0)))
+            return RES_ERROR;
+        strcpy(_dataCmd, name);
+        strcpy(_dataName, fn);
+        _dataLen = a;
+        _mode = IN_DATA;
+        _print("\r\n>");
+        return RES_PROMPT;
+    }
+    if (!f) {
+        _print("\r\n+CME ERROR: FILE NOT FOUND\r\n");
+        return RES_DONE;
+    }
+    if (!strcmp(name, "+URDFILE")) {
+        _print("\r\n+URDFILE: \"%s\",%d,\"", fn, f->len);
+        _raw(f->data, f->len);
+        _print("\"\r\n");
+    } else if (!strcmp(name, "+URDBLOCK")) {
+        if ((n != 3) || (a < 0) || (b < 0))
+            return RES_ERROR;
+        if (a > f->len)     a = f->len;
+        if (b > f->len - a) b = f->len - a;
+        _print("\r\n+URDBLOCK: \"%s\",%d,\"", fn, b);
+        _raw(f->data + a, b);
+        _print("\"\r\n");
+    } else if (!strcmp(name, "+UDELFILE")) {
+        f->used = false;
+    } else if (!strcmp(name, "+ULSTFILE")) {
+        _print("\r\n+ULSTFILE: %d\r\n", f->len);
+    }
+    return RES_OK;
+}
+
+// ----------------------------------------------------------------
+// data after a prompt
+
+void ModemSim::_data(void)
+{
+    _mode = IN_CMD;
+    if (!strcmp(_dataCmd, "+USOWR") || !strcmp(_dataCmd, "+USOST")) {
+        Sock* sock = &_sock[_dataSock];
+        _sleepUs(_cfg.byteUs * _dataLen);
+        int n;
+        if (!strcmp(_dataCmd, "+USOWR"))
+            n = send(sock->fd, _in, _dataLen, MSG_NOSIGNAL);
+        else {
+            struct sockaddr_in sa;
+            memset(&sa, 0, sizeof(sa));
+            sa.sin_family = AF_INET;
+            sa.sin_port = htons(_dataPort);
+            inet_aton(_dataIp, &sa.sin_addr);
+            n = sendto(sock->fd, _in, _dataLen, 0, (struct sockaddr*)&sa, sizeof(sa));
+        }
+        if (n == _dataLen)
+            _print("\r\n%s: %d,%d\r\n\r\nOK\r\n", _dataCmd, _dataSock, n);
+        else
+            _print("\r\n+CME ERROR: operation not allowed\r\n");
+    } else if (!strcmp(_dataCmd, "+UDWNFILE")) {
+        File* f = _file(_dataName, true);
+        if (f) {
+            memcpy(f->data + f->len, _in, _dataLen);
+            f->len += _dataLen;
+            _print("\r\nOK\r\n");
+        } else
+            _print("\r\n+CME ERROR: NOT ENOUGH FREE SPACE\r\n");
+    } else if (!strcmp(_dataCmd, "+CMGS")) {
+        snprintf(_smsLast, sizeof(_smsLast), "%.*s", (int)sizeof(_smsLast) - 1, _in);
+        _smsRef ++;
+        _print("\r\n+CMGS: %d\r\n\r\nOK\r\n", _smsRef);
+    }
+    _inLen = 0;
+    _flush(true);
+}
+
+// ----------------------------------------------------------------
+// network
+
+bool ModemSim::_registered(void)
+{
+    return (_cfg.regMs >= 0) && (_ms() >= _t0 + _cfg.regMs);
+}
+
+void ModemSim::_register(void)
+{
+    if (_regDone || !_registered())
+        return;
+    _regDone = true;
+    const char* fmt[] = { "", "\r\n%s: 1\r\n", "\r\n%s: 1,\"" LAC "\",\"" CI "\",2\r\n" };
+    char line[64];
+    int n[] = { _creg, _cgreg };
+    const char* names[] = { "+CREG", "+CGREG" };
+    for (int i = 0; i < 2; i ++) {
+        if ((n[i] <= 0) || (n[i] > 2))
+            continue;
+        int l = snprintf(line, sizeof(line), fmt[n[i]], names[i]);
+        if (_urcLen + l <= (int)sizeof(_urc)) {
+            memcpy(&_urc[_urcLen], line, l);
+            _urcLen += l;
+        }
+    }
+}
+
+// ----------------------------------------------------------------
+// output
+
+void ModemSim::_print(const char* fmt, ...)
+{
+    va_list args;
+    va_start(args, fmt);
+    int n = vsnprintf(&_out[_outLen], sizeof(_out) - _outLen, fmt, args);
+    va_end(args);
+    if ((n > 0) && (_outLen + n < (int)sizeof(_out)))
+        _outLen += n;
+}
+
+void ModemSim::_raw(const char* buf, int len)
+{
+    if (len > (int)sizeof(_out) - _outLen)
+        len = sizeof(_out) - _outLen;
+    memcpy(&_out[_outLen], buf, len);
+    _outLen += len;
+}
+
+void ModemSim::_flush(bool answer)
+{
+    if (answer) {
+        int ms = _cfg.latencyMs;
+        if (_cfg.jitterMs > 0)
+            ms += rand_r(&_rand) % (_cfg.jitterMs + 1);
+        _sleepUs(ms * 1000);
+    }
+    for (int n = 0; n < _outLen; ) {
+        int w = write(_fd, &_out[n], _outLen - n);
+        if (w <= 0)
+            break;
+        n += w;
+    }
+    _outLen = 0;
+}
+
+void ModemSim::_count(const char* name)
+{
+    int i;
+    for (i = 0; (i < NUM_CNT) && _cnt[i].name[0] && strcmp(_cnt[i].name, name); i ++)
+        /* find it */;
+    if (i == NUM_CNT)
+        return;
+    if (!_cnt[i].name[0])
+        snprintf(_cnt[i].name, sizeof(_cnt[i].name), "%s", name);
+    _cnt[i].n ++;
+}
+
+uint64_t ModemSim::_ms(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000 + ts.tv_nsec / 1000000;
+}
+
+void ModemSim::_sleepUs(int us)
+{
+    if (us <= 0)
+        return;
+    struct timespec ts;
+    ts.tv_sec = us / 1000000;
+    ts.tv_nsec = (us % 1000000) * 1000;
+    while (nanosleep(&ts, &ts) < 0)
+        /* interrupted, sleep the rest */;
+}
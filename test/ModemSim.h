@@ -0,0 +1,206 @@
+#pragma once
+
+#include <pthread.h>
+#include <stdint.h>
+
+/** Simulated u-blox modem for the host tests and the bench.
+
+    It answers the AT commands used by MDMParser: the init, CREG/CGREG,
+    the packet data profile (UPSD/UPSDA/UPSND), the sockets (USOCR/USOCO/
+    USOWR/USORD/USOST/USORF/USOCL), UDNSRN, SMS in text and PDU mode
+    (CMGS/CMGL/CMGR/CMGD) and the file system (UDWNFILE/URDFILE/URDBLOCK/
+    UDELFILE/ULSTFILE). The sockets are real local TCP and UDP sockets,
+    so a parser can talk to a server on the same machine.
+
+    The modem is served on a file descriptor, either one end of a socket
+    pair (#start) or a pty (#serve, see modemsim.cpp). It runs in real
+    time, the latency, jitter, air time and block limits are set with
+    a #Config, unsolicited lines are injected with #urc.
+*/
+class ModemSim
+{
+public:
+    //! the settings of the modem and the network
+    typedef struct {
+        int latencyMs;      //!< time to answer a command line
+        int jitterMs;       //!< random extra time to answer, 0..jitterMs
+        int regMs;          //!< time from the start to the registration, -1 never
+        int byteUs;         //!< air time per byte of socket data
+        int maxWrite;       //!< largest block of +USOWR and +USOST
+        int maxRead;        //!< largest block returned by +USORD and +USORF
+        int rssi;           //!< rssi of +CSQ 0..31, 99 unknown
+        int ber;            //!< quality of +CSQ 0..7, 99 unknown
+        const char* imsi;   //!< the IMSI of the SIM
+        const char* apn;    //!< the only APN that activates, NULL for any
+        const char* host;   //!< name resolved by +UDNSRN to 127.0.0.1
+        unsigned int seed;  //!< seed of the jitter
+    } Config;
+
+    /** Constructor
+        \param cfg the settings, NULL for #defaults
+    */
+    ModemSim(const Config* cfg = NULL);
+
+    //! Destructor, stops the modem
+    ~ModemSim(void);
+
+    /** The default settings: 5 ms latency, no jitter, registered after
+        200 ms, no air time, blocks of 1024 bytes, a good signal, any APN.
+        \param cfg the settings to fill
+    */
+    static void defaults(Config* cfg);
+
+    /** Serve the modem on a socket pair in a thread
+        \return the file descriptor for the parser, -1 on failure
+    */
+    int start(void);
+
+    /** Serve the modem in the calling thread until the peer closes fd
+        \param fd the file descriptor, e.g. the master of a pty
+    */
+    void serve(int fd);
+
+    //! stop the thread of #start and close the sockets
+    void stop(void);
+
+    /** Send an unsolicited line to the parser
+        \param line the line without framing, e.g. "+UUPSDD: 0"
+    */
+    void urc(const char* line);
+
+    /** Receive an SMS, it is reported with +CMTI
+        \param num the originator
+        \param text the content
+    */
+    void sms(const char* num, const char* text);
+
+    /** The number of times a command was received
+        \param cmd the name, e.g. "+USOWR" or "I"
+        \return the count
+    */
+    int count(const char* cmd);
+
+    //! the number of command lines received
+    int lines(void);
+
+    /** The content of a file of the module
+        \param name the file name
+        \param buf the buffer to fill
+        \param len the size of the buffer
+        \return the length of the file, -1 if it does not exist
+    */
+    int file(const char* name, char* buf, int len);
+
+    /** The last SMS sent by the parser
+        \param buf the buffer to fill, the text in text mode, the hex
+               PDU in PDU mode
+        \param len the size of the buffer
+        \return the number of SMS sent
+    */
+    int smsSent(char* buf, int len);
+
+protected:
+    enum { NUM_SOCK = 7, NUM_SMS = 10, NUM_FILE = 8, NUM_CNT = 64, NUM_DGRAM = 8,
+           SOCK_RX = 4096, FILE_SIZE = 4096, IN_SIZE = 4096, OUT_SIZE = 8192 };
+    //! the state of the input
+    typedef enum { IN_CMD, IN_DATA, IN_SMS } InMode;
+    //! a datagram received by a UDP socket
+    typedef struct {
+        char ip[16]; int port; int len; char data[1024];
+    } Dgram;
+    //! a socket of the module
+    typedef struct {
+        int fd;             //!< the local socket, -1 if free
+        bool tcp;           //!< TCP or UDP
+        bool connected;     //!< TCP connected
+        int rxLen;          //!< TCP bytes received
+        char rx[SOCK_RX];   //!< TCP data received
+        int dgrams;         //!< UDP datagrams received
+        Dgram dgram[NUM_DGRAM]; //!< UDP datagrams received
+    } Sock;
+    //! a stored SMS
+    typedef struct {
+        bool used; bool read; char num[32]; char text[161];
+    } Sms;
+    //! a file of the module
+    typedef struct {
+        bool used; char name[48]; int len; char data[FILE_SIZE];
+    } File;
+    //! a command counter
+    typedef struct {
+        char name[16]; int n;
+    } Count;
+    //! the result of a command, RES_DONE if the final result is added already
+    typedef enum { RES_OK, RES_ERROR, RES_PROMPT, RES_DONE } Result;
+
+    //! the loop serving _fd, runs until _stop or the peer closes it
+    void _loop(void);
+    static void* _thread(void* param);
+    //! handle the bytes from the parser
+    void _input(const char* buf, int len);
+    //! handle a command line
+    void _line(char* line);
+    //! handle one command of a line, the answer is added to _out
+    Result _cmd(const char* cmd);
+    Result _cmdSocket(const char* name, const char* arg);
+    Result _cmdSms(const char* name, const char* arg);
+    Result _cmdFile(const char* name, const char* arg);
+    //! the data after a prompt is complete
+    void _data(void);
+    //! read from the local sockets
+    void _socket(int s);
+    //! report the registration once it is due
+    void _register(void);
+    bool _registered(void);
+    //! add to the answer
+    void _print(const char* fmt, ...);
+    void _raw(const char* buf, int len);
+    //! write the answer, after the latency if a command is answered
+    void _flush(bool answer);
+    void _count(const char* name);
+    File* _file(const char* name, bool create);
+    static uint64_t _ms(void);
+    static void _sleepUs(int us);
+    void _reset(void);
+
+    Config _cfg;
+    pthread_mutex_t _mtx;   //!< guards the state against the calls of the test
+    pthread_t _tid;         //!< the thread of #start
+    bool _running;          //!< the thread runs
+    volatile bool _stop;    //!< ask the thread to stop
+    int _fd;                //!< served descriptor
+    int _peer;              //!< the parser end of the socket pair
+    int _wake[2];           //!< wakes the loop for injected lines
+    uint64_t _t0;           //!< start time in ms
+    unsigned int _rand;     //!< state of the jitter
+    // input
+    InMode _mode;
+    bool _skipLf;           //!< the line feed after a carriage return
+    int _inLen;
+    char _in[IN_SIZE];
+    char _dataCmd[16];      //!< the command waiting for the data
+    int _dataSock;
+    char _dataIp[16];
+    int _dataPort;
+    int _dataLen;
+    char _dataName[48];
+    // output
+    int _outLen;
+    char _out[OUT_SIZE];
+    int _urcLen;
+    char _urc[OUT_SIZE];    //!< unsolicited lines waiting for the command mode
+    // modem state
+    int _creg;              //!< +CREG=<n>
+    int _cgreg;             //!< +CGREG=<n>
+    bool _regDone;          //!< registration reported
+    int _cmgf;              //!< +CMGF=<mode>
+    bool _active;           //!< packet data profile active
+    char _upsd[8][64];      //!< profile parameters
+    int _smsRef;
+    char _smsLast[400];
+    Sock _sock[NUM_SOCK];
+    Sms _sms[NUM_SMS];
+    File _files[NUM_FILE];
+    Count _cnt[NUM_CNT];
+    int _lines;
+};
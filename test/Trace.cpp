@@ -0,0 +1,79 @@
+#include <stdio.h>
+#include <string.h>
+#include "Trace.h"
+#include "mbed.h"
+#include "MDM.h"
+
+int traceRead(const char* buf, int len, TraceRecord* rec)
+{
+    const int head = MDMParser::TRACE_HEAD;
+    if (len < head)
+        return 0;
+    rec->dir  = buf[0];
+    rec->type = (buf[1] & 0xFF) << 16;
+    rec->us   = (buf[2] & 0xFF) | ((buf[3] & 0xFF) << 8) |
+                ((buf[4] & 0xFF) << 16) | ((uint32_t)(buf[5] & 0xFF) << 24);
+    rec->len  = (buf[6] & 0xFF) | ((buf[7] & 0xFF) << 8);
+    rec->cap  = (buf[8] & 0xFF) | ((buf[9] & 0xFF) << 8);
+    rec->data = buf + head;
+    if (head + rec->cap > len)
+        return 0;
+    return head + rec->cap;
+}
+
+int traceWrite(char* buf, int size, char dir, int type, uint32_t us,
+               const char* data, int len, int cap /*= 0*/)
+{
+    const int head = MDMParser::TRACE_HEAD;
+    int n = ((cap > 0) && (len > cap)) ? cap : len;
+    if (head + n > size)
+        return 0;
+    buf[0] = dir;
+    buf[1] = type >> 16;
+    buf[2] = us;
+    buf[3] = us >> 8;
+    buf[4] = us >> 16;
+    buf[5] = us >> 24;
+    buf[6] = len;
+    buf[7] = len >> 8;
+    buf[8] = n;
+    buf[9] = n >> 8;
+    memcpy(buf + head, data, n);
+    return head + n;
+}
+
+#define COL(c) "\033[" c
+#define DEF COL("39m")
+#define RED COL("31m")
+#define GRE COL("32m")
+#define YEL COL("33m")
+#define BLU COL("34m")
+#define MAG COL("35m")
+#define CYA COL("36m")
+
+int tracePrint(char* out, int size, const TraceRecord* rec)
+{
+    const char* s = (rec->dir == '>')                     ? "send    " :
+                    (rec->type == MDMParser::TYPE_UNKNOWN)? "read " YEL "UNK" DEF :
+                    (rec->type == MDMParser::TYPE_TEXT)   ? "read " MAG "TXT" DEF :
+                    (rec->type == MDMParser::TYPE_OK   )  ? "read " GRE "OK " DEF :
+                    (rec->type == MDMParser::TYPE_ERROR)  ? "read " RED "ERR" DEF :
+                    (rec->type == MDMParser::TYPE_PLUS)   ? "read " CYA " + " DEF :
+                    (rec->type == MDMParser::TYPE_PROMPT) ? "read " BLU " > " DEF :
+                                                            "read ..." ;
+    // the escaped payload takes up to 4 characters per byte
+    char esc[4 * 1024 + 1];
+    int o = 0;
+    for (int i = 0; (i < rec->cap) && (o < (int)sizeof(esc) - 4); i ++) {
+        char ch = rec->data[i];
+        if      (ch == '"')  o += sprintf(&esc[o], "\\\"");
+        else if (ch == '\\') o += sprintf(&esc[o], "\\\\");
+        else if (ch == '\r') o += sprintf(&esc[o], "\\r");
+        else if (ch == '\n') o += sprintf(&esc[o], "\\n");
+        else if ((ch > 0x1F) && (ch != 0x7F)) esc[o++] = ch; // is printable
+        else o += sprintf(&esc[o], "\\x%02x", (unsigned char)ch);
+    }
+    esc[o] = '\0';
+    return snprintf(out, size, "%10.3f AT %s %3d \"%s%s", rec->us * 0.000001, s,
+                    rec->len, esc, (rec->len > rec->cap) ? "\"...\r\n" : "\"\r\n");
+}
@@ -0,0 +1,49 @@
+#pragma once
+
+#include <stdint.h>
+
+/* ----------------------------------------------------------------
+   Reader and writer of the binary AT transcript recorded by
+   MDMParser::setTranscript and drained with getTranscript.
+---------------------------------------------------------------- */
+
+//! a record of the transcript
+typedef struct {
+    char dir;           //!< '>' sent, '<' received
+    int type;           //!< the line type (MDMParser::TYPE_xxx), 0 if sent
+    uint32_t us;        //!< timestamp in us
+    int len;            //!< length of the line
+    int cap;            //!< number of bytes recorded, less than len if capped
+    const char* data;   //!< the recorded bytes
+} TraceRecord;
+
+/** Read the next record
+    \param buf the transcript
+    \param len the bytes left in the transcript
+    \param rec the record to fill, data points into buf
+    \return the size of the record, 0 if buf ends within the record
+*/
+int traceRead(const char* buf, int len, TraceRecord* rec);
+
+/** Write a record
+    \param buf the buffer to write to
+    \param size the space left in the buffer
+    \param dir '>' sent, '<' received
+    \param type the line type (MDMParser::TYPE_xxx), 0 if sent
+    \param us the timestamp in us
+    \param data the line
+    \param len the length of the line
+    \param cap the number of bytes recorded, 0 records all
+    \return the size of the record, 0 if it does not fit
+*/
+int traceWrite(char* buf, int size, char dir, int type, uint32_t us,
+               const char* data, int len, int cap = 0);
+
+/** Print a record as MDMParser::dumpTranscript does, colored with ANSI
+    escape sequences
+    \param out the buffer to print to
+    \param size the size of the buffer
+    \param rec the record
+    \return the length of the text, as snprintf
+*/
+int tracePrint(char* out, int size, const TraceRecord* rec);
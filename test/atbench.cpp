@@ -0,0 +1,68 @@
+/* ----------------------------------------------------------------
+   Time to build the hot socket commands with MDMParser::AtCmd and
+   with the vsnprintf of sendFormated, on the host:
+     ./atbench [count]
+---------------------------------------------------------------- */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdarg.h>
+#include <time.h>
+#include "mbed.h"
+#include "MDM.h"
+
+typedef MDMParser::IP IP;
+typedef MDMParser::AtCmd AtCmd;
+
+uint32_t stub_now_us = 0;
+
+static volatile int sink;   //!< keeps the compiler from dropping the work
+static volatile int sock = 3;
+static volatile int blk = 1024;
+
+static double nowNs(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1e9 + ts.tv_nsec;
+}
+
+//! what sendFormated does before it sends
+static void formated(const char* format, ...)
+{
+    char buf[128];
+    va_list ap;
+    va_start(ap, format);
+    int len = vsnprintf(buf, sizeof(buf), format, ap);
+    va_end(ap);
+    sink += buf[len - 1];
+}
+
+int main(int argc, char* argv[])
+{
+    int n = (argc > 1) ? atoi(argv[1]) : 5000000;
+    double t = nowNs();
+    for (int i = 0; i < n; i ++)
+        formated("AT+USOWR=%d,%d\r\n", (int)sock, (int)blk);
+    double fmtWr = (nowNs() - t) / n;
+    t = nowNs();
+    for (int i = 0; i < n; i ++) {
+        AtCmd cmd = AtCmd("AT+USOWR=").num(sock).str(",").num(blk).end();
+        sink += cmd.buf()[cmd.len() - 1];
+    }
+    double cmdWr = (nowNs() - t) / n;
+    t = nowNs();
+    for (int i = 0; i < n; i ++)
+        formated("AT+USOST=%d,\"" IPSTR "\",%d,%d\r\n", (int)sock, 10, 0, 0, 1, 5683, (int)blk);
+    double fmtSt = (nowNs() - t) / n;
+    t = nowNs();
+    for (int i = 0; i < n; i ++) {
+        AtCmd cmd = AtCmd("AT+USOST=").num(sock).str(",\"").ip(IPADR(10,0,0,1)).str("\",")
+                        .num(5683).str(",").num(blk).end();
+        sink += cmd.buf()[cmd.len() - 1];
+    }
+    double cmdSt = (nowNs() - t) / n;
+    printf("AT+USOWR  vsnprintf %6.1f ns  AtCmd %6.1f ns\n", fmtWr, cmdWr);
+    printf("AT+USOST  vsnprintf %6.1f ns  AtCmd %6.1f ns\n", fmtSt, cmdSt);
+    return 0;
+}
@@ -0,0 +1,16 @@
+#include "test.h"
+
+int testChecks = 0;
+int testFailures = 0;
+
+int main(void)
+{
+    testApn();
+    testAtCmd();
+    testMqtt();
+    testCoap();
+    testReplay();
+    testSim();
+    printf("%d checks, %d failed\n", testChecks, testFailures);
+    return testFailures ? 1 : 0;
+}
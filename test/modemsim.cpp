@@ -0,0 +1,57 @@
+/* ----------------------------------------------------------------
+   The simulated modem on a pty, for the bench and manual tests:
+     ./modemsim [-l latency_ms] [-j jitter_ms] [-r reg_ms] [-b byte_us]
+                [-w max_write] [-R max_read] [-q rssi]
+   It prints the name of the pty to connect a terminal or a parser to.
+---------------------------------------------------------------- */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <termios.h>
+#include "ModemSim.h"
+
+int main(int argc, char* argv[])
+{
+    ModemSim::Config cfg;
+    ModemSim::defaults(&cfg);
+    int opt;
+    while ((opt = getopt(argc, argv, "l:j:r:b:w:R:q:")) != -1) {
+        switch (opt) {
+            case 'l': cfg.latencyMs = atoi(optarg); break;
+            case 'j': cfg.jitterMs  = atoi(optarg); break;
+            case 'r': cfg.regMs     = atoi(optarg); break;
+            case 'b': cfg.byteUs    = atoi(optarg); break;
+            case 'w': cfg.maxWrite  = atoi(optarg); break;
+            case 'R': cfg.maxRead   = atoi(optarg); break;
+            case 'q': cfg.rssi      = atoi(optarg); break;
+            default:
+                fprintf(stderr, "usage: %s [-l latency_ms] [-j jitter_ms] [-r reg_ms] "
+                                "[-b byte_us] [-w max_write] [-R max_read] [-q rssi]\n", argv[0]);
+                return 2;
+        }
+    }
+    int master = posix_openpt(O_RDWR | O_NOCTTY);
+    if ((master < 0) || (grantpt(master) < 0) || (unlockpt(master) < 0)) {
+        perror("pty");
+        return 1;
+    }
+    // the slave stays open, so the pty survives the clients that come and go
+    const char* name = ptsname(master);
+    int slave = open(name, O_RDWR | O_NOCTTY);
+    if (slave < 0) {
+        perror(name);
+        return 1;
+    }
+    struct termios tio;
+    tcgetattr(slave, &tio);
+    cfmakeraw(&tio);
+    tcsetattr(slave, TCSANOW, &tio);
+    printf("%s\n", name);
+    fflush(stdout);
+    ModemSim sim(&cfg);
+    sim.serve(master);
+    close(slave);
+    return 0;
+}
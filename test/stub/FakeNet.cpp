@@ -0,0 +1,73 @@
+#include "FakeNet.h"
+
+uint32_t stub_now_us = 0;
+
+char FakeNet::tx[MAX_DATA];
+int FakeNet::txLen = 0;
+int FakeNet::txCount = 0;
+char FakeNet::rx[MAX_DATA];
+int FakeNet::rxLen = 0;
+int FakeNet::dgram[MAX_DGRAMS];
+int FakeNet::dgrams = 0;
+bool FakeNet::closed = false;
+void (*FakeNet::onWrite)(const char* buf, int len) = NULL;
+
+void FakeNet::reset(void)
+{
+    txLen = 0;
+    txCount = 0;
+    rxLen = 0;
+    dgrams = 0;
+    closed = false;
+    onWrite = NULL;
+}
+
+void FakeNet::peer(const void* buf, int len)
+{
+    if ((rxLen + len > MAX_DATA) || (dgrams == MAX_DGRAMS))
+        return;
+    memcpy(&rx[rxLen], buf, len);
+    rxLen += len;
+    dgram[dgrams++] = len;
+}
+
+int FakeNet::read(void* buf, int len, int timeout_ms, bool dgram)
+{
+    if (rxLen == 0) {
+        if (closed)
+            return -1;
+        // nothing arrives, time passes
+        stub_now_us += ((timeout_ms > 0) ? timeout_ms : 1) * 1000;
+        return 0;
+    }
+    int n = rxLen;
+    if (dgram) {
+        // the modem hands out the rest of a datagram with the next read
+        n = FakeNet::dgram[0];
+        if (n > len) n = len;
+        FakeNet::dgram[0] -= n;
+        if (FakeNet::dgram[0] == 0) {
+            dgrams --;
+            memmove(&FakeNet::dgram[0], &FakeNet::dgram[1], dgrams * sizeof(*FakeNet::dgram));
+        }
+    } else {
+        if (n > len) n = len;
+        dgrams = 0;
+    }
+    memcpy(buf, rx, n);
+    rxLen -= n;
+    memmove(rx, &rx[n], rxLen);
+    return n;
+}
+
+int FakeNet::write(const void* buf, int len)
+{
+    txCount ++;
+    if (txLen + len <= MAX_DATA) {
+        memcpy(&tx[txLen], buf, len);
+        txLen += len;
+    }
+    if (onWrite)
+        onWrite((const char*)buf, len);
+    return len;
+}
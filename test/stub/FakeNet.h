@@ -0,0 +1,36 @@
+#pragma once
+
+#include "mbed.h"
+
+/* ----------------------------------------------------------------
+   The data exchanged by the fake sockets. The test queues what the
+   peer sends and inspects what the client sent. A read with nothing
+   queued times out at once and advances the simulated time.
+---------------------------------------------------------------- */
+
+class FakeNet
+{
+public:
+    enum { MAX_DATA = 1024, MAX_DGRAMS = 8 };
+
+    //! forget all data
+    static void reset(void);
+    //! queue data (TCP) or a datagram (UDP) sent by the peer
+    static void peer(const void* buf, int len);
+    //! read what the peer sent, whole datagrams if dgram, -1 if closed
+    static int read(void* buf, int len, int timeout_ms, bool dgram);
+    //! record data sent by the client
+    static int write(const void* buf, int len);
+
+    //! called with every send, lets the test answer like a server
+    static void (*onWrite)(const char* buf, int len);
+
+    static char tx[MAX_DATA];   //!< everything the client sent
+    static int txLen;           //!< the length of tx
+    static int txCount;         //!< the number of sends
+    static char rx[MAX_DATA];   //!< the data queued by the peer
+    static int rxLen;           //!< the length of rx
+    static int dgram[MAX_DGRAMS]; //!< the datagram sizes in rx
+    static int dgrams;          //!< the number of datagrams
+    static bool closed;         //!< the peer closed the connection
+};
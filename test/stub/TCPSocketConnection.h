@@ -0,0 +1,22 @@
+#pragma once
+
+#include "FakeNet.h"
+
+//! Host stand-in for the modem TCP socket, talks to FakeNet
+class TCPSocketConnection
+{
+public:
+    TCPSocketConnection() : _open(false), _timeout_ms(-1) {}
+    void set_secure(bool secure, int profile = 0) { (void)secure; (void)profile; }
+    void set_blocking(bool blocking, unsigned int timeout = 1500) { _timeout_ms = blocking ? -1 : (int)timeout; }
+    int connect(const char* host, const int port) { (void)host; (void)port; _open = true; return 0; }
+    bool is_connected(void) { return _open; }
+    int send(char* data, int length) { return _open ? FakeNet::write(data, length) : -1; }
+    int send_all(char* data, int length) { return send(data, length); }
+    int receive(char* data, int length) { return _open ? FakeNet::read(data, length, _timeout_ms, false) : -1; }
+    int receive_all(char* data, int length) { return receive(data, length); }
+    bool close(void) { _open = false; return true; }
+protected:
+    bool _open;
+    int _timeout_ms;
+};
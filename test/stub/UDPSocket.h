@@ -0,0 +1,31 @@
+#pragma once
+
+#include "MDM.h"
+#include "FakeNet.h"
+
+//! Host stand-in for the endpoint of a datagram
+class Endpoint
+{
+public:
+    Endpoint() : _port(0) {}
+    int set_address(const char* host, const int port) { (void)host; _port = port; return 0; }
+    int get_port(void) { return _port; }
+protected:
+    int _port;
+};
+
+//! Host stand-in for the modem UDP socket, talks to FakeNet
+class UDPSocket
+{
+public:
+    UDPSocket() : _open(false), _timeout_ms(-1) {}
+    int init(void) { _open = true; return 0; }
+    int bind(int port) { (void)port; return 0; }
+    void set_blocking(bool blocking, unsigned int timeout = 1500) { _timeout_ms = blocking ? -1 : (int)timeout; }
+    int sendTo(Endpoint &remote, char *packet, int length) { (void)remote; return _open ? FakeNet::write(packet, length) : -1; }
+    int receiveFrom(Endpoint &remote, char *buffer, int length) { (void)remote; return _open ? FakeNet::read(buffer, length, _timeout_ms, true) : -1; }
+    bool close(bool shutdown = true) { (void)shutdown; _open = false; return true; }
+protected:
+    bool _open;
+    int _timeout_ms;
+};
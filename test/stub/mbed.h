@@ -0,0 +1,100 @@
+#pragma once
+
+/* ----------------------------------------------------------------
+   Host stand-in for the parts of mbed used by the modem driver and
+   the protocol clients. Time is simulated, it only advances when the
+   code waits, so the tests run without delays and give the same
+   result every time. There is no hardware, pins and uarts do nothing.
+---------------------------------------------------------------- */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+
+//! the simulated time in microseconds
+extern uint32_t stub_now_us;
+
+inline uint32_t us_ticker_read(void) { return stub_now_us; }
+inline void wait_us(int us) { stub_now_us += us; }
+inline void wait_ms(int ms) { stub_now_us += ms * 1000; }
+inline void wait(float s)   { stub_now_us += (uint32_t)(s * 1000000); }
+
+class Timer
+{
+public:
+    Timer(void) : _running(false), _start(0), _time(0) {}
+    void start(void) { if (!_running) { _start = stub_now_us; _running = true; } }
+    void stop(void)  { _time += _slice(); _running = false; }
+    void reset(void) { _start = stub_now_us; _time = 0; }
+    int read_us(void) { return _time + _slice(); }
+    int read_ms(void) { return read_us() / 1000; }
+    float read(void)  { return read_us() / 1000000.0f; }
+protected:
+    int _slice(void) { return _running ? (int)(stub_now_us - _start) : 0; }
+    bool _running;
+    uint32_t _start;
+    int _time;
+};
+
+//! the pins named by the drivers
+typedef enum {
+    PD_1 = 0x31, PD_2 = 0x32, PD_5 = 0x35, PD_6 = 0x36,
+    USBTX = 0x100, USBRX = 0x101,
+    NC = (int)0xFFFFFFFF
+} PinName;
+
+inline void __disable_irq(void) {}
+inline void __enable_irq(void) {}
+
+class DigitalOut
+{
+public:
+    DigitalOut(PinName pin, int value = 0) : _value(value) { (void)pin; }
+    void write(int value) { _value = value; }
+    int read(void) { return _value; }
+    DigitalOut& operator= (int value) { _value = value; return *this; }
+    operator int() { return _value; }
+protected:
+    int _value;
+};
+
+//! a timeout that never fires, the simulated time does not run by itself
+class Timeout
+{
+public:
+    template<typename T>
+    void attach_us(T* tptr, void (T::*mptr)(void), unsigned int us) { (void)tptr; (void)mptr; (void)us; }
+    void detach(void) {}
+};
+
+class Stream
+{
+public:
+    Stream(const char* name = NULL) { (void)name; }
+    virtual ~Stream() {}
+protected:
+    virtual int _getc() = 0;
+    virtual int _putc(int c) = 0;
+};
+
+//! a uart without a peer, it never has data and takes everything
+class SerialBase
+{
+public:
+    enum IrqType { RxIrq = 0, TxIrq };
+    enum Flow { Disabled = 0, RTS, CTS, RTSCTS };
+    SerialBase(PinName tx, PinName rx) : _baud(9600) { (void)tx; (void)rx; }
+    virtual ~SerialBase() {}
+    void baud(int baudrate) { _baud = baudrate; }
+    int readable(void) { return 0; }
+    int writeable(void) { return 1; }
+    void attach(void (*fptr)(void), IrqType type = RxIrq) { (void)fptr; (void)type; }
+    template<typename T>
+    void attach(T* tptr, void (T::*mptr)(void), IrqType type = RxIrq) { (void)tptr; (void)mptr; (void)type; }
+    void set_flow_control(Flow type, PinName flow1 = NC, PinName flow2 = NC) { (void)type; (void)flow1; (void)flow2; }
+protected:
+    int _base_getc(void) { return EOF; }
+    int _base_putc(int c) { return c; }
+    int _baud;
+};
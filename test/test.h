@@ -0,0 +1,31 @@
+#pragma once
+
+#include <stdio.h>
+
+/* ----------------------------------------------------------------
+   Minimal checks for the host tests, a failed check is reported
+   with its location and the test continues.
+---------------------------------------------------------------- */
+
+extern int testChecks;   //!< the number of checks done
+extern int testFailures; //!< the number of failed checks
+
+#define CHECK(cond) \
+    do { \
+        testChecks ++; \
+        if (!(cond)) { \
+            testFailures ++; \
+            printf("%s:%d: CHECK(%s) failed\n", __FILE__, __LINE__, #cond); \
+        } \
+    } while (0)
+
+#define CHECK_EQ(a, b) CHECK((a) == (b))
+#define CHECK_STR(a, b) CHECK(0 == strcmp((a), (b)))
+#define CHECK_MEM(a, b, n) CHECK(0 == memcmp((a), (b), (n)))
+
+void testApn(void);
+void testAtCmd(void);
+void testMqtt(void);
+void testCoap(void);
+void testReplay(void);
+void testSim(void);
@@ -0,0 +1,61 @@
+#include <string.h>
+#include "test.h"
+#include "MDMAPN.h"
+
+// the fields of a config string, returns the next entry
+static const char* field(const char* cfg, const char** apn, const char** user, const char** pass)
+{
+    *apn  = _APN_GET(cfg);
+    *user = _APN_GET(cfg);
+    *pass = _APN_GET(cfg);
+    return cfg;
+}
+
+void testApn(void)
+{
+    // the lookup is a binary search
+    int n = sizeof(apnlut)/sizeof(*apnlut);
+    for (int i = 1; i < n; i ++) {
+        CHECK((apnlut[i-1].mcc < apnlut[i].mcc) ||
+              ((apnlut[i-1].mcc == apnlut[i].mcc) && (apnlut[i-1].mnc < apnlut[i].mnc)));
+    }
+    for (int i = 0; i < n; i ++)
+        CHECK(_apnfind(apnlut[i].mcc, apnlut[i].mnc) == apnlut[i].cfg);
+    CHECK(_apnfind(0, 0) == NULL);
+    CHECK(_apnfind(262, 2) == NULL);
+    CHECK(_apnfind(999, 99) == NULL);
+
+    // 2 and 3 digit MNC
+    CHECK(apnconfig("262011234567890") == apnDeTMobile);
+    CHECK(apnconfig("222881234567890") == apnItWind);
+    CHECK(apnconfig("310410123456789") == apnUsATT);
+    CHECK(apnconfig("310260123456789") == apnUsTMobile);
+    CHECK(apnconfig("440101234567890") == apnJpDoCoMo);
+    // unknown networks and bad imsi use the default
+    CHECK(apnconfig("901011234567890") == apndef);
+    CHECK(apnconfig("26201") == apndef);
+    CHECK(apnconfig("") == apndef);
+    CHECK(apnconfig(NULL) == apndef);
+
+    // the entries of a config
+    const char *apn, *user, *pass;
+    const char* cfg = field(apnDeTMobile, &apn, &user, &pass);
+    CHECK_STR(apn, "internet.t-mobile");
+    CHECK_STR(user, "t-mobile");
+    CHECK_STR(pass, "tm");
+    CHECK(*cfg == '\0');
+    cfg = field(apndef, &apn, &user, &pass);
+    CHECK_STR(apn, "");
+    CHECK_STR(user, "");
+    CHECK_STR(pass, "");
+    cfg = field(cfg, &apn, &user, &pass);
+    CHECK_STR(apn, "internet");
+    CHECK(*cfg == '\0');
+    // the entries without username and password come first
+    cfg = field(apnUsATT, &apn, &user, &pass);
+    CHECK_STR(apn, "phone");
+    CHECK_STR(user, "");
+    cfg = field(cfg, &apn, &user, &pass);
+    CHECK_STR(apn, "wap.cingular");
+    CHECK_STR(pass, "CINGULAR1");
+}
@@ -0,0 +1,47 @@
+#include <string.h>
+#include <limits.h>
+#include <stdarg.h>
+#include "test.h"
+#include "mbed.h"
+#include "MDM.h"
+
+typedef MDMParser::AtCmd AtCmd;
+typedef MDMParser::IP IP;
+
+//! the builder gives the same command as the format of sendFormated
+static void same(const AtCmd& cmd, const char* format, ...)
+{
+    char buf[AtCmd::SIZE + 1];
+    va_list ap;
+    va_start(ap, format);
+    int len = vsnprintf(buf, sizeof(buf), format, ap);
+    va_end(ap);
+    CHECK_EQ(cmd.len(), len);
+    CHECK_STR(cmd.buf(), buf);
+}
+
+void testAtCmd(void)
+{
+    // the numbers
+    const int nums[] = { 0, 1, 9, 10, 1023, -1, -10, INT_MAX, INT_MIN };
+    for (int i = 0; i < (int)(sizeof(nums)/sizeof(*nums)); i ++)
+        same(AtCmd("AT+USORD=").num(nums[i]).str(",").num(128).end(),
+             "AT+USORD=%d,%d\r\n", nums[i], 128);
+    // the hot socket commands
+    same(AtCmd("AT+USOWR=").num(6).str(",").num(1024).end(), "AT+USOWR=%d,%d\r\n", 6, 1024);
+    same(AtCmd("AT+USOST=").num(0).str(",\"").ip(IPADR(192,168,1,255)).str("\",")
+             .num(5683).str(",").num(64).end(),
+         "AT+USOST=%d,\"" IPSTR "\",%d,%d\r\n", 0, 192, 168, 1, 255, 5683, 64);
+    same(AtCmd("AT+USORF=").num(1).str(",").num(0).end(), "AT+USORF=%d,%d\r\n", 1, 0);
+    same(AtCmd("AT+UDNSRN=0,").ip(NOIP).end(), "AT+UDNSRN=0," IPSTR "\r\n", 0, 0, 0, 0);
+    same(AtCmd("AT+UDNSRN=0,").quoted("echo.test").end(), "AT+UDNSRN=0,\"%s\"\r\n", "echo.test");
+    same(AtCmd("AT").quoted("").end(), "AT\"\"\r\n");
+    // a long command is cut at the size of the buffer, as vsnprintf does
+    char host[200];
+    memset(host, 'h', sizeof(host) - 1);
+    host[sizeof(host) - 1] = '\0';
+    AtCmd cut = AtCmd("AT+UDNSRN=0,").quoted(host).end();
+    CHECK_EQ(cut.len(), (int)AtCmd::SIZE);
+    CHECK_EQ((int)strlen(cut.buf()), (int)AtCmd::SIZE);
+    CHECK(memcmp(cut.buf(), "AT+UDNSRN=0,\"hhh", 16) == 0);
+}
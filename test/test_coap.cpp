@@ -0,0 +1,204 @@
+#include "test.h"
+#include "CoAPClient.h"
+
+//! access to the message helpers
+struct CoAP : public CoAPClient
+{
+    using CoAPClient::Msg;
+    using CoAPClient::_build;
+    using CoAPClient::_parse;
+    using CoAPClient::_putOpt;
+    using CoAPClient::_putUint;
+    using CoAPClient::_tx;
+    using CoAPClient::TYPE_CON;
+    using CoAPClient::TYPE_ACK;
+};
+
+static void testOptions(void)
+{
+    char buf[32];
+    const char* end = buf + sizeof(buf);
+    int last = 0;
+    // the delta to the previous option and the length share one byte
+    char* p = CoAP::_putUint(buf, end, &last, 6, 0);
+    CHECK_EQ(p - buf, 1);
+    CHECK_MEM(buf, "\x60", 1);
+    p = CoAP::_putOpt(buf, end, &last, 11, "a", 1);
+    CHECK_EQ(last, 11);
+    CHECK_MEM(buf, "\x51" "a", 2);
+    p = CoAP::_putUint(buf, end, &last, 11, 0x1234);
+    CHECK_EQ(p - buf, 3);
+    CHECK_MEM(buf, "\x02\x12\x34", 3);
+    // the extended delta and length
+    last = 0;
+    p = CoAP::_putOpt(buf, end, &last, 23, "0123456789abc", 13);
+    CHECK_EQ(p - buf, 3 + 13);
+    CHECK_MEM(buf, "\xDD\x0A\x00" "0", 4);
+    last = 0;
+    p = CoAP::_putUint(buf, end, &last, 300, 1);
+    CHECK_EQ(p - buf, 4);
+    CHECK_MEM(buf, "\xE1\x00\x1F\x01", 4);
+    // no space left
+    CHECK(CoAP::_putOpt(buf, buf + 8, &last, 400, "0123", 4) == NULL);
+    CHECK(CoAP::_putOpt(NULL, end, &last, 400, "0", 1) == NULL);
+}
+
+static void testMessage(void)
+{
+    CoAP coap;
+    int n = coap._build(CoAP::TYPE_CON, CoAPClient::METHOD_POST, 0x1234, "tokn",
+                        "/sensors/temp?unit=C&x=1", 0, CoAPClient::FORMAT_JSON,
+                        0x0B, 2, "pay", 3);
+    static const char msg[] =
+        "\x44\x02\x12\x34" "tokn"
+        "\x60"                      // observe 0
+        "\x57" "sensors" "\x04" "temp" // uri path
+        "\x11\x32"                  // content format 50
+        "\x36" "unit=C" "\x03" "x=1"   // uri query
+        "\x81\x02"                  // block2
+        "\x41\x0B"                  // block1
+        "\xFF" "pay";
+    CHECK_EQ(n, (int)sizeof(msg) - 1);
+    CHECK_MEM(coap._tx, msg, sizeof(msg) - 1);
+
+    CoAP::Msg m;
+    CHECK(CoAP::_parse(msg, sizeof(msg) - 1, &m));
+    CHECK_EQ(m.type, CoAP::TYPE_CON);
+    CHECK_EQ(m.code, CoAPClient::METHOD_POST);
+    CHECK_EQ(m.mid, 0x1234);
+    CHECK_EQ(m.tkl, 4);
+    CHECK_MEM(m.token, "tokn", 4);
+    CHECK_EQ(m.observe, 0);
+    CHECK_EQ(m.block1, 0x0B);
+    CHECK_EQ(m.block2, 2);
+    CHECK_EQ(m.len, 3);
+    CHECK_MEM(m.payload, "pay", 3);
+
+    // malformed messages
+    CHECK(!CoAP::_parse(msg, 3, &m));
+    CHECK(!CoAP::_parse("\x84\x02\x12\x34", 4, &m));   // version 2
+    CHECK(!CoAP::_parse("\x49\x02\x12\x34", 4, &m));   // token too long
+    CHECK(!CoAP::_parse("\x40\x02\x12\x34\x0F", 5, &m)); // reserved length
+    CHECK(!CoAP::_parse("\x40\x02\x12\x34\x03" "ab", 7, &m)); // truncated option
+    // too large for the transmit buffer
+    char big[CoAPClient::MAX_MESSAGE];
+    memset(big, 0, sizeof(big));
+    CHECK(coap._build(CoAP::TYPE_CON, CoAPClient::METHOD_PUT, 1, "tokn", "/", -1, -1,
+                      -1, -1, big, sizeof(big)) < 0);
+}
+
+// a server with a resource of 100 bytes, it answers with piggybacked
+// blocks of up to 64 bytes and takes uploads in blocks of up to 32 bytes
+static char resource[100];
+static char upload[400];
+static int uploadLen;
+static int block1[16];
+static int block2[16];
+static int requests;
+static bool junk;
+
+static void server(const char* buf, int len)
+{
+    CoAP::Msg req;
+    if (!CoAP::_parse(buf, len, &req) || (req.type != CoAP::TYPE_CON))
+        return;
+    if (requests < 16) {
+        block1[requests] = req.block1;
+        block2[requests] = req.block2;
+    }
+    requests ++;
+    if (junk) {
+        // a datagram that does not fit is dropped
+        char big[CoAPClient::MAX_MESSAGE + 44];
+        memset(big, 0x40, sizeof(big));
+        FakeNet::peer(big, sizeof(big));
+        junk = false;
+    }
+    CoAP rsp;
+    int l;
+    if (req.code == CoAPClient::METHOD_GET) {
+        int szx = ((req.block2 >= 0) && ((req.block2 & 7) < 2)) ? (req.block2 & 7) : 2;
+        int num = (req.block2 >= 0) ? (req.block2 >> 4) : 0;
+        int off = num << (4 + szx);
+        int n = (int)sizeof(resource) - off;
+        bool more = (n > (16 << szx));
+        if (more) n = 16 << szx;
+        l = rsp._build(CoAP::TYPE_ACK, CoAPClient::CODE_CONTENT, req.mid, req.token, "",
+                       -1, -1, -1, (num << 4) | (more ? 8 : 0) | szx, &resource[off], n);
+    } else {
+        int szx = (req.block1 >= 0) ? (req.block1 & 7) : 0;
+        int num = (req.block1 >= 0) ? (req.block1 >> 4) : 0;
+        bool more = (req.block1 >= 0) && (req.block1 & 8);
+        int off = num << (4 + szx);
+        if (off + req.len <= (int)sizeof(upload)) {
+            memcpy(&upload[off], req.payload, req.len);
+            uploadLen = off + req.len;
+        }
+        l = rsp._build(CoAP::TYPE_ACK, more ? CoAPClient::CODE_CONTINUE : CoAPClient::CODE_CHANGED,
+                       req.mid, req.token, "", -1, -1,
+                       (req.block1 >= 0) ? ((num << 4) | (more ? 8 : 0) | ((szx < 1) ? szx : 1)) : -1,
+                       -1, NULL, 0);
+    }
+    FakeNet::peer(rsp._tx, l);
+}
+
+static void testRequest(void)
+{
+    for (int i = 0; i < (int)sizeof(resource); i ++)
+        resource[i] = 'A' + i % 26;
+    CoAPClient coap;
+    FakeNet::reset();
+    FakeNet::onWrite = server;
+    requests = 0;
+    junk = false;
+    CHECK(coap.connect("server"));
+    char buf[128];
+    int size = sizeof(buf);
+    // the blocks of the response fit into one modem read
+    junk = true;
+    CHECK_EQ(coap.get("/r", buf, &size), CoAPClient::CODE_CONTENT);
+    CHECK_EQ(size, (int)sizeof(resource));
+    CHECK_MEM(buf, resource, sizeof(resource));
+    CHECK_EQ(requests, 2);
+    CHECK_EQ(block2[0], CoAPClient::RX_BLOCK_SZX);
+    CHECK_EQ(block2[1], 0x10 | CoAPClient::RX_BLOCK_SZX);
+    // the response is cut to the buffer
+    size = 10;
+    CHECK_EQ(coap.get("/r", buf, &size), CoAPClient::CODE_CONTENT);
+    CHECK_EQ(size, 10);
+
+    // a larger payload is uploaded block by block, the client follows
+    // the smaller block size the server asks for
+    char payload[300];
+    for (int i = 0; i < (int)sizeof(payload); i ++)
+        payload[i] = i;
+    requests = 0;
+    uploadLen = 0;
+    CHECK_EQ(coap.post("/log", payload, sizeof(payload)), CoAPClient::CODE_CHANGED);
+    CHECK_EQ(uploadLen, (int)sizeof(payload));
+    CHECK_MEM(upload, payload, sizeof(payload));
+    // one block of 128 bytes, then 32 byte blocks from offset 128 on
+    CHECK_EQ(requests, 1 + (300 - 128 + 31) / 32);
+    CHECK_EQ(block1[0], 0x0B);
+    CHECK_EQ(block1[1], (4 << 4) | 0x08 | 1);
+    CHECK_EQ(block1[requests - 1], (9 << 4) | 1);
+    // a small payload goes in a single request
+    requests = 0;
+    CHECK_EQ(coap.post("/log", payload, 20), CoAPClient::CODE_CHANGED);
+    CHECK_EQ(requests, 1);
+    CHECK_EQ(block1[0], -1);
+    // a non-confirmable request is not answered
+    requests = 0;
+    CHECK_EQ(coap.post("/log", payload, 20, CoAPClient::FORMAT_NONE, false), 0);
+    CHECK_EQ(requests, 0);
+    CHECK_EQ(FakeNet::dgrams, 0);
+    coap.close();
+    FakeNet::reset();
+}
+
+void testCoap(void)
+{
+    testOptions();
+    testMessage();
+    testRequest();
+}
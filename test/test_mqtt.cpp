@@ -0,0 +1,181 @@
+#include "test.h"
+#include "MQTTClient.h"
+
+//! access to the packet helpers
+struct MQTT : public MQTTClient
+{
+    using MQTTClient::_putHeader;
+    using MQTTClient::_putStr;
+    using MQTTClient::_match;
+};
+
+static bool match(const char* filter, const char* topic)
+{
+    return MQTT::_match(filter, topic, strlen(topic));
+}
+
+// the received messages
+static char msgTopic[32];
+static char msgPayload[32];
+static int msgCount;
+
+static void onMessage(void* param, const char* topic, int topicLen, const char* payload, int len)
+{
+    (void)param;
+    memcpy(msgTopic, topic, topicLen);
+    msgTopic[topicLen] = '\0';
+    memcpy(msgPayload, payload, len);
+    msgPayload[len] = '\0';
+    msgCount ++;
+}
+
+static void testHeader(void)
+{
+    // the remaining length takes 1 to 4 bytes with 7 bits each
+    char buf[5];
+    CHECK_EQ(MQTT::_putHeader(buf, 0xE0, 0), 2);
+    CHECK_MEM(buf, "\xE0\x00", 2);
+    CHECK_EQ(MQTT::_putHeader(buf, 0x30, 127), 2);
+    CHECK_MEM(buf, "\x30\x7F", 2);
+    CHECK_EQ(MQTT::_putHeader(buf, 0x30, 128), 3);
+    CHECK_MEM(buf, "\x30\x80\x01", 3);
+    CHECK_EQ(MQTT::_putHeader(buf, 0x30, 16383), 3);
+    CHECK_MEM(buf, "\x30\xFF\x7F", 3);
+    CHECK_EQ(MQTT::_putHeader(buf, 0x30, 16384), 4);
+    CHECK_MEM(buf, "\x30\x80\x80\x01", 4);
+    CHECK_EQ(MQTT::_putHeader(buf, 0x30, 268435455), 5);
+    CHECK_MEM(buf, "\x30\xFF\xFF\xFF\x7F", 5);
+
+    char* p = MQTT::_putStr(buf, "abc", 3);
+    CHECK_EQ(p - buf, 5);
+    CHECK_MEM(buf, "\x00\x03" "abc", 5);
+}
+
+static void testMatch(void)
+{
+    CHECK(match("a/b", "a/b"));
+    CHECK(!match("a/b", "a/c"));
+    CHECK(!match("a/b", "a/b/c"));
+    CHECK(!match("a/b/c", "a/b"));
+    CHECK(match("a/+", "a/b"));
+    CHECK(!match("a/+", "a/b/c"));
+    CHECK(match("a/+/c", "a/b/c"));
+    CHECK(match("a/+/c", "a//c"));
+    CHECK(match("+/+", "a/b"));
+    CHECK(match("#", "a/b/c"));
+    CHECK(match("a/#", "a/b/c"));
+    CHECK(match("a/#", "a"));
+    CHECK(!match("a/#", "ab"));
+    CHECK(!match("a/#", "b/c"));
+    // the topic is not terminated
+    CHECK(MQTT::_match("a/b", "a/bc", 3));
+}
+
+static void testSession(void)
+{
+    MQTT mqtt;
+    FakeNet::reset();
+    FakeNet::peer("\x20\x02\x00\x00", 4);
+    CHECK(mqtt.connect("broker", 1883, "id", NULL, NULL, 60));
+    CHECK_EQ(FakeNet::txLen, 16);
+    CHECK_MEM(FakeNet::tx, "\x10\x0E\x00\x04MQTT\x04\x02\x00\x3C\x00\x02id", 16);
+
+    // QoS 1 publishes stay in flight until acknowledged
+    FakeNet::reset();
+    CHECK_EQ(mqtt.publish("t", "xy", 2, 1), 1);
+    CHECK_EQ(mqtt.inflight(), 1);
+    FakeNet::peer("\x40\x02\x00\x01", 4);
+    CHECK(mqtt.yield(100));
+    CHECK_EQ(FakeNet::txLen, 9);
+    CHECK_MEM(FakeNet::tx, "\x32\x07\x00\x01t\x00\x01xy", 9);
+    CHECK_EQ(mqtt.inflight(), 0);
+
+    // the messages of a subscription arrive while waiting for the SUBACK
+    FakeNet::reset();
+    msgCount = 0;
+    FakeNet::peer("\x30\x07\x00\x03" "a/b" "hi", 9);
+    FakeNet::peer("\x90\x03\x00\x02\x01", 5);
+    CHECK(mqtt.subscribe("a/+", 1, onMessage));
+    CHECK_MEM(FakeNet::tx, "\x82\x08\x00\x02\x00\x03" "a/+\x01", 10);
+    CHECK_EQ(msgCount, 1);
+    CHECK_STR(msgTopic, "a/b");
+    CHECK_STR(msgPayload, "hi");
+
+    // a QoS 1 message is acknowledged
+    FakeNet::reset();
+    FakeNet::peer("\x32\x09\x00\x03" "a/c" "\x12\x34" "ok", 11);
+    CHECK(mqtt.yield(100));
+    CHECK_EQ(msgCount, 2);
+    CHECK_STR(msgPayload, "ok");
+    CHECK_EQ(FakeNet::txLen, 4);
+    CHECK_MEM(FakeNet::tx, "\x40\x02\x12\x34", 4);
+
+    // a packet larger than the receive buffer is dropped, the next one is handled
+    FakeNet::reset();
+    char big[3 + 300 + 4 + 6];
+    memset(big, 'x', sizeof(big));
+    memcpy(big, "\x30\xAF\x02\x00\x03" "a/b", 8);   // 303 bytes remaining
+    memcpy(&big[3 + 303], "\x30\x04\x00\x01" "a/", 4);
+    FakeNet::peer(big, 3 + 303);
+    FakeNet::peer("\x30\x05\x00\x03" "a/d", 7);
+    CHECK(mqtt.yield(100));
+    CHECK(mqtt.yield(100));
+    CHECK_EQ(msgCount, 3);
+    CHECK_STR(msgTopic, "a/d");
+    CHECK_STR(msgPayload, "");
+
+    // a ping when idle for half of the keep alive interval
+    FakeNet::reset();
+    wait_ms(30000);
+    CHECK(mqtt.yield(0));
+    CHECK_EQ(FakeNet::txLen, 2);
+    CHECK_MEM(FakeNet::tx, "\xC0\x00", 2);
+    FakeNet::peer("\xD0\x00", 2);
+    CHECK(mqtt.yield(0));
+    // an unanswered ping drops the connection
+    FakeNet::reset();
+    wait_ms(30000);
+    CHECK(mqtt.yield(0));
+    wait_ms(60000);
+    CHECK(!mqtt.yield(0));
+}
+
+static void testBatch(void)
+{
+    MQTT mqtt;
+    FakeNet::reset();
+    FakeNet::peer("\x20\x02\x00\x00", 4);
+    CHECK(mqtt.connect("broker", 1883, "id", NULL, NULL, 60));
+    // the publishes are collected and go out with one socket write
+    FakeNet::reset();
+    char payload[40];
+    memset(payload, 'p', sizeof(payload));
+    for (int i = 0; i < 8; i ++)
+        CHECK_EQ(mqtt.publish("sensors/t", payload, sizeof(payload)), 0);
+    CHECK_EQ(FakeNet::txCount, 0);
+    CHECK(mqtt.flush());
+    CHECK_EQ(FakeNet::txCount, 1);
+    CHECK_EQ(FakeNet::txLen, 8 * (2 + 2 + 9 + 40));
+    // QoS 1 publishes fill the in-flight window without waiting
+    FakeNet::reset();
+    for (int i = 0; i < MQTTClient::MAX_INFLIGHT; i ++)
+        CHECK(mqtt.publish("sensors/t", payload, sizeof(payload), 1) > 0);
+    CHECK_EQ(mqtt.inflight(), MQTTClient::MAX_INFLIGHT);
+    CHECK(mqtt.flush());
+    CHECK_EQ(FakeNet::txCount, 1);
+    // a full batch is sent before the next packet is added
+    FakeNet::reset();
+    for (int i = 0; i < 20; i ++)
+        mqtt.publish("sensors/t", payload, sizeof(payload));
+    CHECK_EQ(FakeNet::txCount, 1);
+    CHECK_EQ(FakeNet::txLen, (MQTTClient::MAX_BATCH / 53) * 53);
+    mqtt.disconnect();
+}
+
+void testMqtt(void)
+{
+    testHeader();
+    testMatch();
+    testSession();
+    testBatch();
+}
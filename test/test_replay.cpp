@@ -0,0 +1,253 @@
+#include <stdarg.h>
+#include "test.h"
+#include "MDMReplay.h"
+
+//! a transcript written line by line
+struct Script
+{
+    Script(void) : len(0), us(0) {}
+    //! a line sent by the parser
+    void send(const char* line)
+    {
+        len += traceWrite(&buf[len], sizeof(buf) - len, '>', 0, us, line, strlen(line));
+    }
+    //! a line received after the time given in ms
+    void recv(int ms, int type, const char* line)
+    {
+        us += ms * 1000;
+        len += traceWrite(&buf[len], sizeof(buf) - len, '<', type, us, line, strlen(line));
+    }
+    char buf[2048];
+    int len;
+    uint32_t us;
+};
+
+static void testNetStatus(void)
+{
+    Script s;
+    s.send("AT+CREG?;+CGREG?\r\n");
+    s.recv(30, MDMParser::TYPE_PLUS, "\r\n+CREG: 2,1,\"1A2B\",\"0001C3D4\"\r\n");
+    s.recv(0,  MDMParser::TYPE_PLUS, "\r\n+CGREG: 2,5,\"1A2B\",\"0001C3D4\",2\r\n");
+    s.recv(10, MDMParser::TYPE_OK,   "\r\nOK\r\n");
+    s.send("AT+COPS?;+CNUM;+CSQ\r\n");
+    s.recv(120, MDMParser::TYPE_PLUS, "\r\n+COPS: 0,0,\"Swisscom\",2\r\n");
+    s.recv(0,   MDMParser::TYPE_PLUS, "\r\n+CNUM: \"My Number\",\"+41791234567\",145\r\n");
+    s.recv(0,   MDMParser::TYPE_PLUS, "\r\n+CSQ: 20,2\r\n");
+    s.recv(0,   MDMParser::TYPE_OK,   "\r\nOK\r\n");
+
+    MDMReplay mdm(s.buf, s.len);
+    MDMParser::NetStatus net;
+    CHECK(mdm.checkNetStatus(&net));
+    CHECK_EQ(mdm.mismatches(), 0);
+    CHECK_EQ(mdm.left(), 0);
+    CHECK_EQ(net.csd, MDMParser::REG_HOME);
+    CHECK_EQ(net.psd, MDMParser::REG_ROAMING);
+    CHECK_EQ(net.act, MDMParser::ACT_UTRAN);
+    CHECK_EQ(net.lac, 0x1A2B);
+    CHECK_EQ(net.ci, 0x0001C3D4u);
+    CHECK_STR(net.opr, "Swisscom");
+    CHECK_STR(net.num, "+41791234567");
+    CHECK_EQ(net.rssi, -73);
+    CHECK_EQ(net.ber, 37);
+    // the latency of the recording is kept, the parser adds 10 ms per poll
+    // and per line it handles
+    MDMParser::Metrics m;
+    mdm.getMetrics(&m);
+    CHECK_EQ(m.cmd[MDMParser::CMD_REG].count, 1u);
+    CHECK(m.cmd[MDMParser::CMD_REG].totalMs >= 40);
+    CHECK(m.cmd[MDMParser::CMD_REG].totalMs <= 60);
+    CHECK_EQ(m.cmd[MDMParser::CMD_COPS].count, 1u);
+    CHECK(m.cmd[MDMParser::CMD_COPS].totalMs >= 120);
+    CHECK(m.cmd[MDMParser::CMD_COPS].totalMs <= 160);
+}
+
+static void testSocket(void)
+{
+    Script s;
+    s.send("AT+USOCR=6\r\n");
+    s.recv(20, MDMParser::TYPE_PLUS, "\r\n+USOCR: 0\r\n");
+    s.recv(0,  MDMParser::TYPE_OK,   "\r\nOK\r\n");
+    s.send("AT+USOCO=0,\"10.0.0.1\",1883\r\n");
+    s.recv(400, MDMParser::TYPE_OK,  "\r\nOK\r\n");
+    s.send("AT+USOWR=0,5\r\n");
+    s.recv(20, MDMParser::TYPE_PROMPT, "\r\n@");
+    s.send("hello");
+    s.recv(70, MDMParser::TYPE_PLUS, "\r\n+USOWR: 0,5\r\n");
+    s.recv(0,  MDMParser::TYPE_OK,   "\r\nOK\r\n");
+
+    MDMReplay mdm(s.buf, s.len);
+    int sock = mdm.socketSocket(MDMParser::IPPROTO_TCP);
+    CHECK_EQ(sock, 0);
+    CHECK(mdm.socketConnect(sock, "10.0.0.1", 1883));
+    CHECK_EQ(mdm.socketSend(sock, "hello", 5), 5);
+    CHECK_EQ(mdm.mismatches(), 0);
+    CHECK_EQ(mdm.left(), 0);
+    MDMParser::Metrics m;
+    mdm.getMetrics(&m);
+    CHECK_EQ(m.txBytes[0], 5u);
+    CHECK(m.cmd[MDMParser::CMD_USOCO].totalMs >= 400);
+}
+
+//! a text line of a batch
+static int cbText(int type, const char* buf, int len, char* str)
+{
+    if (type == MDMParser::TYPE_UNKNOWN)
+        sscanf(buf, "\r\n%31s\r\n", str);
+    return MDMParser::WAIT;
+}
+
+static void testBatchText(void)
+{
+    // the last batch of init, the set commands answer with nothing
+    Script s;
+    s.send("AT+CREG=2;+CMGF=1;+CNMI=2,1;+CIMI\r\n");
+    s.recv(20, MDMParser::TYPE_UNKNOWN, "\r\n228011234567890\r\n");
+    s.recv(0,  MDMParser::TYPE_OK,      "\r\nOK\r\n");
+
+    MDMReplay mdm(s.buf, s.len);
+    char imsi[32] = "";
+    MDMParser::BatchCmd cmds[] = {
+        _BATCH("+CREG=2",   NULL,   NULL),
+        _BATCH("+CMGF=1",   NULL,   NULL),
+        _BATCH("+CNMI=2,1", NULL,   NULL),
+        _BATCH("+CIMI",     cbText, imsi),
+    };
+    CHECK_EQ(mdm.sendBatch(cmds, 4), MDMParser::RESP_OK);
+    CHECK_STR(imsi, "228011234567890");
+    CHECK_EQ(mdm.mismatches(), 0);
+}
+
+static void testHttp(void)
+{
+    // PUT sends the file without a content type, POST with one
+    Script s;
+    s.send("AT+UHTTPC=0,3,\"/put\",\"resp.txt\",\"data.txt\"\r\n");
+    s.recv(20, MDMParser::TYPE_OK, "\r\nOK\r\n");
+    s.send("AT+UHTTPC=0,4,\"/post\",\"resp.txt\",\"data.txt\",4\r\n");
+    s.recv(20, MDMParser::TYPE_OK, "\r\nOK\r\n");
+
+    MDMReplay mdm(s.buf, s.len);
+    CHECK(mdm.httpCommand(0, MDMParser::HTTP_PUT, "/put", "resp.txt", "data.txt"));
+    CHECK(mdm.httpCommand(0, MDMParser::HTTP_POST_FILE, "/post", "resp.txt", "data.txt",
+                          MDMParser::HTTP_JSON));
+    CHECK_EQ(mdm.mismatches(), 0);
+    CHECK_EQ(mdm.left(), 0);
+}
+
+static void testMismatch(void)
+{
+    // the parser sends a different port, the replay goes on but counts it
+    Script s;
+    s.send("AT+USOCR=17,5683\r\n");
+    s.recv(20, MDMParser::TYPE_PLUS, "\r\n+USOCR: 1\r\n");
+    s.recv(0,  MDMParser::TYPE_OK,   "\r\nOK\r\n");
+
+    MDMReplay mdm(s.buf, s.len);
+    CHECK_EQ(mdm.socketSocket(MDMParser::IPPROTO_UDP, 5684), 1);
+    CHECK_EQ(mdm.mismatches(), 1);
+    CHECK_STR(mdm.mismatch(), "AT+USOCR=17,5684\r\n");
+    CHECK_EQ(mdm.left(), 0);
+    // nothing left to answer, the command times out
+    CHECK_EQ(mdm.socketSocket(MDMParser::IPPROTO_UDP, 5684), SOCKET_ERROR);
+    CHECK_EQ(mdm.mismatches(), 2);
+}
+
+//! the text printed by dumpTranscript
+struct Text
+{
+    Text(void) : len(0) { buf[0] = '\0'; }
+    static int print(Text* t, const char* format, ...)
+    {
+        va_list ap;
+        va_start(ap, format);
+        int n = vsnprintf(&t->buf[t->len], sizeof(t->buf) - t->len, format, ap);
+        va_end(ap);
+        if (n > 0) t->len += n;
+        return n;
+    }
+    char buf[4096];
+    int len;
+};
+
+//! connect and send, the session of the transcript tests
+static void transcriptSession(MDMParser* mdm)
+{
+    int sock = mdm->socketSocket(MDMParser::IPPROTO_TCP);
+    CHECK(mdm->socketConnect(sock, "10.0.0.1", 1883));
+    CHECK_EQ(mdm->socketSend(sock, "hi \"you\"", 8), 8);
+}
+
+static void testTranscript(void)
+{
+    Script s;
+    s.send("AT+USOCR=6\r\n");
+    s.recv(20, MDMParser::TYPE_PLUS, "\r\n+USOCR: 0\r\n");
+    s.recv(0,  MDMParser::TYPE_OK,   "\r\nOK\r\n");
+    s.send("AT+USOCO=0,\"10.0.0.1\",1883\r\n");
+    s.recv(400, MDMParser::TYPE_OK,  "\r\nOK\r\n");
+    s.send("AT+USOWR=0,8\r\n");
+    s.recv(20, MDMParser::TYPE_PROMPT, "\r\n@");
+    s.send("hi \"you\"");
+    s.recv(70, MDMParser::TYPE_PLUS, "\r\n+USOWR: 0,8\r\n");
+    s.recv(0,  MDMParser::TYPE_OK,   "\r\nOK\r\n");
+
+    // the drained records decode to the lines of the session
+    uint32_t t0 = stub_now_us;
+    MDMReplay mdm(s.buf, s.len);
+    CHECK(mdm.setTranscript(4096, 0));
+    transcriptSession(&mdm);
+    CHECK_EQ(mdm.mismatches(), 0);
+    char buf[4096];
+    int len = mdm.getTranscript(buf, sizeof(buf));
+    CHECK_EQ(mdm.getTranscript(buf + len, sizeof(buf) - len), 0);
+    Text text;
+    TraceRecord got, want;
+    int pos = 0, ref = 0, n;
+    while ((n = traceRead(buf + pos, len - pos, &got)) > 0) {
+        pos += n;
+        n = traceRead(s.buf + ref, s.len - ref, &want);
+        CHECK(n > 0);
+        if (n <= 0)
+            break;
+        ref += n;
+        CHECK_EQ(got.dir, want.dir);
+        CHECK_EQ(got.type, want.type);
+        CHECK_EQ(got.len, want.len);
+        CHECK_EQ(got.cap, got.len);
+        CHECK_MEM(got.data, want.data, want.len);
+        text.len += tracePrint(&text.buf[text.len], sizeof(text.buf) - text.len, &got);
+    }
+    CHECK_EQ(pos, len);
+    CHECK_EQ(ref, s.len);
+
+    // the decoder prints what the parser prints, the same session at the
+    // same time is dumped by the parser
+    stub_now_us = t0;
+    MDMReplay dump(s.buf, s.len);
+    CHECK(dump.setTranscript(4096, 0));
+    transcriptSession(&dump);
+    Text printed;
+    dump.dumpTranscript(Text::print, &printed);
+    CHECK_STR(text.buf, printed.buf);
+    CHECK(strstr(text.buf, "send    ") != NULL);
+    CHECK(strstr(text.buf, "\"hi \\\"you\\\"\"") != NULL);
+
+    // a capped record shows that the line was longer
+    char rec[64];
+    char line[80];
+    CHECK(traceWrite(rec, sizeof(rec), '<', MDMParser::TYPE_OK, 1500000,
+                     "\r\nOK\r\n", 6, 2) > 0);
+    CHECK(traceRead(rec, sizeof(rec), &got) > 0);
+    tracePrint(line, sizeof(line), &got);
+    CHECK_STR(line, "     1.500 AT read \033[32mOK \033[39m   6 \"\\r\\n\"...\r\n");
+}
+
+void testReplay(void)
+{
+    testNetStatus();
+    testSocket();
+    testBatchText();
+    testHttp();
+    testMismatch();
+    testTranscript();
+}
@@ -0,0 +1,537 @@
+#include <unistd.h>
+#include <poll.h>
+#include <pthread.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+#include "test.h"
+#include "ModemSim.h"
+#include "MDMHost.h"
+#include "LinkSupervisor.h"
+// the socket of the driver, the other tests use the stand-in of the same
+// name from stub, the namespace keeps the two classes apart
+namespace drv {
+#include "../C027_Support/Socket/TCPSocketConnection.h"
+}
+
+typedef MDMParser::IP IP;
+
+//! TCP and UDP echo server on the loopback, the peer of the simulated sockets
+class Echo
+{
+public:
+    Echo(void) : _stop(false), _conn(-1)
+    {
+        struct sockaddr_in sa;
+        socklen_t sl = sizeof(sa);
+        memset(&sa, 0, sizeof(sa));
+        sa.sin_family = AF_INET;
+        sa.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+        _tcp = socket(AF_INET, SOCK_STREAM, 0);
+        _udp = socket(AF_INET, SOCK_DGRAM, 0);
+        bind(_tcp, (struct sockaddr*)&sa, sizeof(sa));
+        bind(_udp, (struct sockaddr*)&sa, sizeof(sa));
+        listen(_tcp, 1);
+        getsockname(_tcp, (struct sockaddr*)&sa, &sl);
+        tcpPort = ntohs(sa.sin_port);
+        getsockname(_udp, (struct sockaddr*)&sa, &sl);
+        udpPort = ntohs(sa.sin_port);
+        pthread_create(&_tid, NULL, _thread, this);
+    }
+    ~Echo(void)
+    {
+        _stop = true;
+        pthread_join(_tid, NULL);
+        close(_tcp);
+        close(_udp);
+        if (_conn >= 0)
+            close(_conn);
+    }
+    int tcpPort;
+    int udpPort;
+protected:
+    static void* _thread(void* param)
+    {
+        Echo* e = (Echo*)param;
+        char buf[2048];
+        while (!e->_stop) {
+            struct pollfd fds[3] = { { e->_tcp, POLLIN, 0 }, { e->_udp, POLLIN, 0 }, { e->_conn, POLLIN, 0 } };
+            if (poll(fds, (e->_conn >= 0) ? 3 : 2, 20) <= 0)
+                continue;
+            if (fds[0].revents & POLLIN) {
+                if (e->_conn >= 0)
+                    close(e->_conn);
+                e->_conn = accept(e->_tcp, NULL, NULL);
+            }
+            if (fds[1].revents & POLLIN) {
+                struct sockaddr_in sa;
+                socklen_t sl = sizeof(sa);
+                int n = recvfrom(e->_udp, buf, sizeof(buf), 0, (struct sockaddr*)&sa, &sl);
+                if (n > 0)
+                    sendto(e->_udp, buf, n, 0, (struct sockaddr*)&sa, sl);
+            }
+            if ((e->_conn >= 0) && (fds[2].revents & (POLLIN | POLLHUP))) {
+                int n = recv(e->_conn, buf, sizeof(buf), 0);
+                if (n > 0)
+                    send(e->_conn, buf, n, MSG_NOSIGNAL);
+                else {
+                    close(e->_conn);
+                    e->_conn = -1;
+                }
+            }
+        }
+        return NULL;
+    }
+    volatile bool _stop;
+    pthread_t _tid;
+    int _tcp;
+    int _udp;
+    int _conn;
+};
+
+//! init, register and join on the simulated modem
+static bool simConnect(MDMHost* mdm)
+{
+    MDMParser::DevStatus dev;
+    MDMParser::NetStatus net;
+    return mdm->init(NULL, &dev, NC) &&
+           mdm->registerNet(&net, 5000) && (mdm->join() != NOIP);
+}
+
+static void testSimInit(void)
+{
+    ModemSim sim;
+    MDMHost mdm(sim.start());
+    MDMParser::DevStatus dev;
+    CHECK(mdm.init(NULL, &dev, NC));
+    CHECK_EQ(dev.dev, MDMParser::DEV_SARA_U270);
+    CHECK_EQ(dev.sim, MDMParser::SIM_READY);
+    CHECK_STR(dev.manu, "u-blox");
+    CHECK_STR(dev.model, "SARA-U270");
+    CHECK_STR(dev.ver, "23.41");
+    CHECK_STR(dev.ccid, "8941000000000000001");
+    CHECK_STR(dev.imei, "352848000000001");
+    CHECK_STR(dev.imsi, "228011234567890");
+    // the registration is reported by the URCs once it is done
+    MDMParser::NetStatus net;
+    CHECK(mdm.registerNet(&net, 5000));
+    CHECK_EQ(net.csd, MDMParser::REG_HOME);
+    CHECK_EQ(net.psd, MDMParser::REG_HOME);
+    CHECK_EQ(net.act, MDMParser::ACT_UTRAN);
+    CHECK_EQ(net.lac, 0x1A2B);
+    CHECK_STR(net.opr, "SIM NET");
+    CHECK_STR(net.num, "+41790000001");
+    CHECK_EQ(net.rssi, -73);
+    CHECK_EQ(mdm.join(), IPADR(10,10,0,2));
+    CHECK_EQ(sim.count("+UPSDA"), 1);
+    CHECK_EQ(mdm.gethostbyname("echo.test"), IPADR(127,0,0,1));
+    CHECK_EQ(mdm.gethostbyname("unknown.test"), NOIP);
+}
+
+static void testSimSockets(void)
+{
+    Echo echo;
+    ModemSim sim;
+    MDMHost mdm(sim.start());
+    CHECK(simConnect(&mdm));
+    char tx[300], rx[300];
+    for (int i = 0; i < (int)sizeof(tx); i ++)
+        tx[i] = (char)i;
+    // TCP, the answer is read in blocks that fit the line buffer
+    int sock = mdm.socketSocket(MDMParser::IPPROTO_TCP);
+    CHECK(sock >= 0);
+    CHECK(mdm.socketConnect(sock, "echo.test", echo.tcpPort));
+    CHECK_EQ(mdm.socketSend(sock, tx, sizeof(tx)), (int)sizeof(tx));
+    mdm.socketSetBlocking(sock, 2000);
+    CHECK_EQ(mdm.socketRecv(sock, rx, sizeof(rx)), (int)sizeof(rx));
+    CHECK_MEM(rx, tx, sizeof(tx));
+    CHECK(sim.count("+USORD") >= 3);
+    CHECK(mdm.socketClose(sock));
+    CHECK(mdm.socketFree(sock));
+    // UDP
+    sock = mdm.socketSocket(MDMParser::IPPROTO_UDP);
+    CHECK(sock >= 0);
+    CHECK_EQ(mdm.socketSendTo(sock, IPADR(127,0,0,1), echo.udpPort, "ping", 4), 4);
+    mdm.socketSetBlocking(sock, 2000);
+    IP ip = NOIP;
+    int port = 0;
+    CHECK_EQ(mdm.socketRecvFrom(sock, &ip, &port, rx, sizeof(rx)), 4);
+    CHECK_MEM(rx, "ping", 4);
+    CHECK_EQ(ip, IPADR(127,0,0,1));
+    CHECK_EQ(port, echo.udpPort);
+}
+
+static void testSimCoalesce(void)
+{
+    // the six header lines of the Websocket handshake
+    static const char* lines[] = {
+        "GET /ws HTTP/1.1\r\n", "Host: echo.test\r\n", "Upgrade: websocket\r\n",
+        "Connection: Upgrade\r\n", "Sec-WebSocket-Key: L159VM0TWUzyDxwJEIEzjw==\r\n",
+        "Sec-WebSocket-Version: 13\r\n\r\n" };
+    const int num = sizeof(lines) / sizeof(*lines);
+    Echo echo;
+    ModemSim sim;
+    MDMHost mdm(sim.start());
+    CHECK(simConnect(&mdm));
+    // one write per send without coalescing
+    drv::TCPSocketConnection plain;
+    CHECK_EQ(plain.connect("echo.test", echo.tcpPort), 0);
+    int n = sim.count("+USOWR");
+    for (int i = 0; i < num; i ++)
+        CHECK_EQ(plain.send((char*)lines[i], strlen(lines[i])), (int)strlen(lines[i]));
+    CHECK_EQ(sim.count("+USOWR") - n, num);
+    plain.close();
+    // held back and sent with one write, the peer gets the same bytes
+    char buf[drv::TCPSocketConnection::MAX_COALESCE];
+    drv::TCPSocketConnection sock;
+    CHECK_EQ(sock.connect("echo.test", echo.tcpPort), 0);
+    CHECK_EQ(sock.set_coalescing(100, buf, sizeof(buf)), 0);
+    char tx[256];
+    int len = 0;
+    n = sim.count("+USOWR");
+    for (int i = 0; i < num; i ++) {
+        CHECK_EQ(sock.send((char*)lines[i], strlen(lines[i])), (int)strlen(lines[i]));
+        len += sprintf(&tx[len], "%s", lines[i]);
+    }
+    CHECK_EQ(sim.count("+USOWR") - n, 0);
+    CHECK_EQ(sock.flush(), 0);
+    CHECK_EQ(sim.count("+USOWR") - n, 1);
+    char rx[256];
+    sock.set_blocking(false, 2000);
+    int got = 0;
+    for (int r; (got < len) && ((r = sock.receive(rx + got, len - got)) > 0); )
+        got += r;
+    CHECK_EQ(got, len);
+    CHECK_MEM(rx, tx, len);
+    // poll sends once the delay has passed
+    CHECK_EQ(sock.send((char*)lines[0], strlen(lines[0])), (int)strlen(lines[0]));
+    CHECK_EQ(sock.poll(), 0);
+    CHECK_EQ(sim.count("+USOWR") - n, 1);
+    stub_now_us += 100 * 1000;
+    CHECK_EQ(sock.poll(), 0);
+    CHECK_EQ(sim.count("+USOWR") - n, 2);
+    sock.close();
+}
+
+//! records how long the parser holds its lock
+class MDMLockProbe : public MDMHost
+{
+public:
+    MDMLockProbe(int fd) : MDMHost(fd), locks(0), maxHeldMs(0), _depth(0), _since(0) {}
+    int locks;
+    int maxHeldMs;
+protected:
+    virtual void lock(void)
+    {
+        if (_depth++ == 0) {
+            locks ++;
+            _since = us_ticker_read();
+        }
+    }
+    virtual void unlock(void)
+    {
+        if (--_depth == 0) {
+            int ms = (us_ticker_read() - _since) / 1000;
+            if (ms > maxHeldMs)
+                maxHeldMs = ms;
+        }
+    }
+    int _depth;
+    uint32_t _since;
+};
+
+static void testSimRegister(void)
+{
+    // the registration takes 2.5 s, the lock is released every second
+    ModemSim::Config cfg;
+    ModemSim::defaults(&cfg);
+    cfg.regMs = 2500;
+    ModemSim sim(&cfg);
+    MDMLockProbe mdm(sim.start());
+    MDMParser::DevStatus dev;
+    CHECK(mdm.init(NULL, &dev, NC));
+    mdm.maxHeldMs = 0;
+    mdm.locks = 0;
+    int n = sim.count("+CREG");
+    MDMParser::NetStatus net;
+    CHECK(mdm.registerNet(&net, 10000));
+    CHECK_EQ(net.csd, MDMParser::REG_HOME);
+    CHECK(mdm.locks >= 3);
+    CHECK(mdm.maxHeldMs <= 1100);
+    // queried once before the URCs and once more by checkNetStatus
+    CHECK_EQ(sim.count("+CREG") - n, 2);
+}
+
+static void testSimLkg(void)
+{
+    // the second APN of the operator works, it is remembered for this SIM
+    ModemSim::Config cfg;
+    ModemSim::defaults(&cfg);
+    cfg.imsi = "228031234567890";
+    cfg.apn = "click";
+    ModemSim sim(&cfg);
+    MDMHost mdm(sim.start());
+    CHECK(simConnect(&mdm));
+    char lkg[64];
+    CHECK_EQ(sim.file("apn.lkg", lkg, sizeof(lkg)), 26);
+    CHECK_MEM(lkg, "228031234567890\0click\0\0\0" "0", 26);
+    // the next join tries it first
+    mdm.disconnect();
+    int n = sim.count("+UPSDA");
+    CHECK_EQ(mdm.join(), IPADR(10,10,0,2));
+    CHECK_EQ(sim.count("+UPSDA") - n, 1);
+}
+
+static void testSimRejoin(void)
+{
+    ModemSim sim;
+    MDMHost mdm(sim.start());
+    CHECK(simConnect(&mdm));
+    // the active context is kept, checked with a single AT+UPSND=0,0
+    int n = sim.count("+UPSDA");
+    int d = sim.count("+UPSD");
+    int l = sim.lines();
+    CHECK_EQ(mdm.join(), IPADR(10,10,0,2));
+    CHECK_EQ(sim.count("+UPSDA") - n, 0);
+    CHECK_EQ(sim.count("+UPSD") - d, 0);
+    CHECK_EQ(sim.lines() - l, 3);   // +CGATT, +UPSND=0,8 and +UPSND=0,0
+    // another apn tears it down and activates it again
+    CHECK_EQ(mdm.join("other.apn"), IPADR(10,10,0,2));
+    CHECK_EQ(sim.count("+UPSDA") - n, 2);
+    // the same apn keeps it
+    CHECK_EQ(mdm.join("other.apn"), IPADR(10,10,0,2));
+    CHECK_EQ(sim.count("+UPSDA") - n, 2);
+    // a deactivated context is activated again
+    CHECK(mdm.disconnect());
+    n = sim.count("+UPSDA");
+    CHECK_EQ(mdm.join("other.apn"), IPADR(10,10,0,2));
+    CHECK_EQ(sim.count("+UPSDA") - n, 1);
+}
+
+static void testSimLkgNoImsi(void)
+{
+    // without an IMSI the record could be of any SIM, it is not used
+    ModemSim::Config cfg;
+    ModemSim::defaults(&cfg);
+    cfg.imsi = "";
+    ModemSim sim(&cfg);
+    MDMHost mdm(sim.start());
+    CHECK(simConnect(&mdm));
+    char lkg[64];
+    CHECK_EQ(sim.count("+URDFILE"), 0);
+    CHECK_EQ(sim.count("+UDWNFILE"), 0);
+    CHECK_EQ(sim.file("apn.lkg", lkg, sizeof(lkg)), -1);
+}
+
+static void testSimChunks(void)
+{
+    // a module that takes at most 256 bytes per write
+    Echo echo;
+    ModemSim::Config cfg;
+    ModemSim::defaults(&cfg);
+    cfg.maxWrite = 256;
+    ModemSim sim(&cfg);
+    MDMHost mdm(sim.start());
+    CHECK(simConnect(&mdm));
+    char tx[1000];
+    memset(tx, 'x', sizeof(tx));
+    int sock = mdm.socketSocket(MDMParser::IPPROTO_TCP);
+    CHECK(mdm.socketConnect(sock, "127.0.0.1", echo.tcpPort));
+    // the adaptive block starts above the limit of the module
+    CHECK_EQ(mdm.socketSend(sock, tx, sizeof(tx)), SOCKET_ERROR);
+    CHECK(mdm.socketSetChunking(sock, 256));
+    int n = sim.count("+USOWR");
+    CHECK_EQ(mdm.socketSend(sock, tx, sizeof(tx)), (int)sizeof(tx));
+    CHECK_EQ(sim.count("+USOWR") - n, 4);
+}
+
+//! the number of writes and the time in ms to send 1000 bytes at a quality
+static int simChunks(int ber, int* ms)
+{
+    Echo echo;
+    ModemSim::Config cfg;
+    ModemSim::defaults(&cfg);
+    cfg.latencyMs = 1;
+    cfg.rssi = 20;
+    cfg.ber = ber;
+    ModemSim sim(&cfg);
+    MDMHost mdm(sim.start());
+    CHECK(simConnect(&mdm));
+    CHECK(mdm.checkNetStatus());
+    char tx[1000];
+    memset(tx, 'x', sizeof(tx));
+    int sock = mdm.socketSocket(MDMParser::IPPROTO_TCP);
+    CHECK(mdm.socketConnect(sock, "127.0.0.1", echo.tcpPort));
+    int n = sim.count("+USOWR");
+    uint32_t t = us_ticker_read();
+    CHECK_EQ(mdm.socketSend(sock, tx, sizeof(tx)), (int)sizeof(tx));
+    *ms = (us_ticker_read() - t) / 1000;
+    return sim.count("+USOWR") - n;
+}
+
+static void testSimQuality(void)
+{
+    // a good rssi on UTRAN, the bit error rate sets the chunks and pacing
+    int ms;
+    CHECK_EQ(simChunks(0, &ms), 1);     // RXQUAL 0, one block
+    CHECK_EQ(simChunks(3, &ms), 2);     // RXQUAL 3, moderate, 512 bytes
+    CHECK(ms >= 50);
+    CHECK_EQ(simChunks(6, &ms), 8);     // RXQUAL 6, weak, 128 bytes
+    CHECK(ms >= 7 * 200);
+}
+
+static void testSimTiming(void)
+{
+    // the latency and air time of the module show in the metrics
+    Echo echo;
+    ModemSim::Config cfg;
+    ModemSim::defaults(&cfg);
+    cfg.latencyMs = 40;
+    cfg.byteUs = 100;
+    ModemSim sim(&cfg);
+    MDMHost mdm(sim.start());
+    CHECK(simConnect(&mdm));
+    MDMParser::Metrics m;
+    mdm.getMetrics(&m);
+    const MDMParser::CmdMetrics* reg = &m.cmd[MDMParser::CMD_REG];
+    CHECK(reg->count > 0);
+    CHECK(reg->totalMs >= 40 * reg->count);
+    CHECK(reg->totalMs <= 80 * reg->count);
+    int sock = mdm.socketSocket(MDMParser::IPPROTO_TCP);
+    CHECK(mdm.socketConnect(sock, "127.0.0.1", echo.tcpPort));
+    char tx[2000];
+    memset(tx, 'x', sizeof(tx));
+    uint32_t t = us_ticker_read();
+    CHECK_EQ(mdm.socketSend(sock, tx, sizeof(tx)), (int)sizeof(tx));
+    t = (us_ticker_read() - t) / 1000;
+    // 200 ms air time, two chunks with two answers and the prompt pause each
+    CHECK(t >= 200 + 2 * (2 * 40 + 50));
+    CHECK(t < 1000);
+}
+
+static void simLink(void* param, MDMParser::LinkEvent event, int arg)
+{
+    if (event == MDMParser::LINK_REG_CHANGED)
+        *(int*)param = arg;
+}
+
+static void testSimUrc(void)
+{
+    ModemSim sim;
+    MDMHost mdm(sim.start());
+    CHECK(simConnect(&mdm));
+    int reg = MDMParser::REG_UNKNOWN;
+    mdm.setLinkCallback(simLink, &reg);
+    sim.urc("+CGREG: 3");
+    for (int i = 0; (i < 50) && (reg == MDMParser::REG_UNKNOWN); i ++)
+        mdm.processUrc();
+    CHECK_EQ(reg, MDMParser::REG_DENIED);
+}
+
+static void simPdp(void* param, MDMParser::LinkEvent event, int arg)
+{
+    if (event == MDMParser::LINK_PDP_LOST)
+        *(int*)param = arg;
+}
+
+static void testSimPdpLost(void)
+{
+    ModemSim sim;
+    MDMHost mdm(sim.start());
+    CHECK(simConnect(&mdm));
+    int profile = -1;
+    mdm.setLinkCallback(simPdp, &profile);
+    sim.urc("+UUPSDD: 0");
+    for (int i = 0; (i < 50) && (profile == -1); i ++)
+        mdm.processUrc();
+    CHECK_EQ(profile, 0);
+    CHECK(mdm.getIpAddress() == NOIP);
+}
+
+static void testSimSession(void)
+{
+    ModemSim sim;
+    MDMHost mdm(sim.start());
+    CHECK(simConnect(&mdm));
+    LinkSupervisor sup(&mdm);
+    sup.begin();
+    sup.poll();
+    CHECK_EQ(sup.getState(), LinkSupervisor::LINK_CONNECTED);
+    CHECK(sup.sessionReady());
+    sup.sessionFailed();
+    CHECK(!sup.sessionReady());
+    // the back-off expires while the application polls
+    stub_now_us += 10 * 60 * 1000000u;
+    sup.poll();
+    // no failure for longer than the timer can count
+    stub_now_us += 30 * 60 * 1000000u;
+    CHECK(sup.sessionReady());
+    sup.sessionFailed();
+    CHECK(!sup.sessionReady());
+    sup.sessionOk();
+    CHECK(sup.sessionReady());
+}
+
+static void testSimSms(void)
+{
+    ModemSim sim;
+    MDMHost mdm(sim.start());
+    MDMParser::DevStatus dev;
+    CHECK(mdm.init(NULL, &dev, NC));
+    char buf[64];
+    CHECK(mdm.smsSend("+41790000002", "hello"));
+    CHECK_EQ(sim.smsSent(buf, sizeof(buf)), 1);
+    CHECK_STR(buf, "hello");
+    sim.sms("+41790000003", "hi there");
+    int ix[4];
+    CHECK_EQ(mdm.smsList("REC UNREAD", ix, 4), 1);
+    CHECK_EQ(ix[0], 1);
+    char num[32];
+    CHECK(mdm.smsRead(ix[0], num, buf, sizeof(buf)));
+    CHECK_STR(num, "+41790000003");
+    CHECK_STR(buf, "hi there");
+    CHECK(mdm.smsDelete(ix[0]));
+    CHECK_EQ(mdm.smsList("ALL", ix, 4), 0);
+}
+
+static void testSimFiles(void)
+{
+    ModemSim sim;
+    MDMHost mdm(sim.start());
+    MDMParser::DevStatus dev;
+    CHECK(mdm.init(NULL, &dev, NC));
+    char data[1500], buf[1500];
+    for (int i = 0; i < (int)sizeof(data); i ++)
+        data[i] = 'a' + i % 26;
+    // written in blocks of 1024 bytes, read in blocks that fit the line buffer
+    CHECK_EQ(mdm.writeFile("data.bin", data, sizeof(data)), (int)sizeof(data));
+    CHECK_EQ(sim.count("+UDWNFILE"), 2);
+    CHECK_EQ(mdm.fileSize("data.bin"), (int)sizeof(data));
+    CHECK_EQ(mdm.readFileBlock("data.bin", 0, buf, sizeof(buf)), (int)sizeof(buf));
+    CHECK_MEM(buf, data, sizeof(data));
+    CHECK(mdm.delFile("data.bin"));
+    CHECK_EQ(sim.file("data.bin", buf, sizeof(buf)), -1);
+    CHECK_EQ(mdm.writeFile("small.txt", "abc", 3), 3);
+    CHECK_EQ(mdm.readFile("small.txt", buf, sizeof(buf)), 3);
+    CHECK_MEM(buf, "abc", 3);
+    CHECK_EQ(mdm.readFile("missing.txt", buf, sizeof(buf)), -1);
+}
+
+void testSim(void)
+{
+    testSimInit();
+    testSimRegister();
+    testSimLkg();
+    testSimLkgNoImsi();
+    testSimRejoin();
+    testSimSockets();
+    testSimCoalesce();
+    testSimChunks();
+    testSimQuality();
+    testSimTiming();
+    testSimUrc();
+    testSimPdpLost();
+    testSimSession();
+    testSimSms();
+    testSimFiles();
+}
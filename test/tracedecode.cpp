@@ -0,0 +1,47 @@
+/* ----------------------------------------------------------------
+   Decoder of the binary AT transcript drained with
+   MDMParser::getTranscript, prints the colored view:
+     ./tracedecode [file]
+   The transcript is read from the file or from stdin.
+---------------------------------------------------------------- */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include "Trace.h"
+
+int main(int argc, char* argv[])
+{
+    FILE* f = (argc > 1) ? fopen(argv[1], "rb") : stdin;
+    if (!f) {
+        perror(argv[1]);
+        return 1;
+    }
+    int size = 64 * 1024;
+    int len = 0;
+    char* buf = (char*)malloc(size);
+    for (int n; buf && ((n = fread(buf + len, 1, size - len, f)) > 0); ) {
+        len += n;
+        if (len == size)
+            buf = (char*)realloc(buf, size *= 2);
+    }
+    if (f != stdin)
+        fclose(f);
+    if (!buf) {
+        fprintf(stderr, "out of memory\n");
+        return 1;
+    }
+    TraceRecord rec;
+    char out[8 * 1024];
+    int pos = 0;
+    for (int n; (n = traceRead(buf + pos, len - pos, &rec)) > 0; pos += n) {
+        tracePrint(out, sizeof(out), &rec);
+        fputs(out, stdout);
+    }
+    free(buf);
+    // a transcript cut within a record, e.g. copied from a full buffer
+    if (pos < len) {
+        fprintf(stderr, "%d bytes left after the last record\n", len - pos);
+        return 1;
+    }
+    return 0;
+}